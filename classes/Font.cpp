@@ -1,4 +1,5 @@
 #include "Font.hpp"
+#include "gl_state.hpp"
 
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
@@ -17,6 +18,9 @@ Font::Font(std::string fontBMP, std::string fontCSV,float scaleX,float scaleY)
 void Font::initialize(VAOStruct vao) {
     this->vao = vao;
     this->texNumber = GetTexture(this->BMPfilename,true);
+    //The glyphs are magnified without filtering (set once here rather than per character)
+    GLState::BindTexture(GL_TEXTURE_2D,this->texNumber);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
     
     std::ifstream infile(this->CSVfilename.c_str());
     std::string line;
@@ -56,7 +60,7 @@ void Font::initialize(VAOStruct vao) {
 
 //Draw a single character, given a single character, a location (x,y) for the
 // character, a shader program, and a depth (z).
-void Font::DrawCharacter (char letter, glm::vec2 loc, Shader sProgram, float depth_change) {
+void Font::DrawCharacter (char letter, glm::vec2 loc, Shader &sProgram, float depth_change) {
     sProgram.use();
     glm::mat4 mod = glm::mat4(1.0f);
     mod = glm::translate(mod,glm::vec3(loc.x,loc.y,depth_change));
@@ -64,9 +68,8 @@ void Font::DrawCharacter (char letter, glm::vec2 loc, Shader sProgram, float dep
 
 
     sProgram.setMat4("local",mod);
-    glBindTexture(GL_TEXTURE_2D,this->getTexNum());
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glActiveTexture(GL_TEXTURE0);
+    GLState::ActiveTexture(GL_TEXTURE0);
+    GLState::BindTexture(GL_TEXTURE_2D,this->getTexNum());
 
     unsigned char c = static_cast<unsigned char>(letter);
     this->charVAOs[(int)letter].Draw(sProgram);
@@ -77,7 +80,7 @@ void Font::DrawCharacter (char letter, glm::vec2 loc, Shader sProgram, float dep
 }
 
 //Given a string, draw all the characters to the screen.
-void Font::DrawText(std::string s, glm::vec2 start, Shader sProgram) {
+void Font::DrawText(std::string s, glm::vec2 start, Shader &sProgram) {
     float depth = -0.01;
     for (int i = 0; i < s.length(); i++) {
         unsigned char letter = static_cast<unsigned char>(s[i]);
@@ -19,9 +19,9 @@ class Font
         void initialize(VAOStruct vao);
 
         //Draws a single character at a given x and y coordinate (lower left hand)
-        void DrawCharacter (char letter, glm::vec2 loc, Shader sProgram, float depth_change = 0);
+        void DrawCharacter (char letter, glm::vec2 loc, Shader &sProgram, float depth_change = 0);
         // Draws the string starting at a given X/Y coordinate (lower left hand)
-        void DrawText(std::string s, glm::vec2 start, Shader sProgram);
+        void DrawText(std::string s, glm::vec2 start, Shader &sProgram);
 
         //Re-scale the characters.
         void setScale(glm::vec2 newScale);
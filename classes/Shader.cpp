@@ -1,7 +1,17 @@
 #include "Shader.hpp"
+#include "program_cache.hpp"
+#include "gl_state.hpp"
 #include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+#include <string.h>
+#include <chrono>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath) {
+UniformStats Shader::uniform_stats;
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath) : Shader(vertexPath, fragmentPath, "") {
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath, const std::string &defines) {
         // 1. retrieve the vertex/fragment source code from filePath
         std::string vertexCode;
         std::string fragmentCode;
@@ -30,54 +40,227 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath) {
         {
             std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
         }
-        const char* vShaderCode = vertexCode.c_str();
-        const char * fShaderCode = fragmentCode.c_str();
-        // 2. compile shaders
-        unsigned int vertex, fragment;
-        // vertex shader
-        vertex = glCreateShader(GL_VERTEX_SHADER);
-        glShaderSource(vertex, 1, &vShaderCode, NULL);
-        glCompileShader(vertex);
-        checkCompileErrors(vertex, "VERTEX");
-        // fragment Shader
-        fragment = glCreateShader(GL_FRAGMENT_SHADER);
-        glShaderSource(fragment, 1, &fShaderCode, NULL);
-        glCompileShader(fragment);
-        checkCompileErrors(fragment, "FRAGMENT");
-        // shader Program
+        if (!defines.empty()) {
+            vertexCode = insertDefines(vertexCode, defines);
+            fragmentCode = insertDefines(fragmentCode, defines);
+        }
+        auto start = std::chrono::steady_clock::now();
+        // 2. reuse the program the driver linked on a previous run if the sources are unchanged
+        std::string cache_path = ProgramCachePath(vertexCode, fragmentCode);
         ID = glCreateProgram();
-        glAttachShader(ID, vertex);
-        glAttachShader(ID, fragment);
-        glLinkProgram(ID);
-        checkCompileErrors(ID, "PROGRAM");
-        // delete the shaders as they're linked into our program now and no longer necessary
-        glDeleteShader(vertex);
-        glDeleteShader(fragment);
+        bool cached = LoadProgramBinary(ID, cache_path);
+        if (!cached) {
+            const char* vShaderCode = vertexCode.c_str();
+            const char * fShaderCode = fragmentCode.c_str();
+            // 3. compile shaders
+            unsigned int vertex, fragment;
+            // vertex shader
+            vertex = glCreateShader(GL_VERTEX_SHADER);
+            glShaderSource(vertex, 1, &vShaderCode, NULL);
+            glCompileShader(vertex);
+            checkCompileErrors(vertex, "VERTEX");
+            // fragment Shader
+            fragment = glCreateShader(GL_FRAGMENT_SHADER);
+            glShaderSource(fragment, 1, &fShaderCode, NULL);
+            glCompileShader(fragment);
+            checkCompileErrors(fragment, "FRAGMENT");
+            // shader Program
+            glAttachShader(ID, vertex);
+            glAttachShader(ID, fragment);
+            MarkProgramRetrievable(ID);
+            glLinkProgram(ID);
+            checkCompileErrors(ID, "PROGRAM");
+            // delete the shaders as they're linked into our program now and no longer necessary
+            glDetachShader(ID, vertex);
+            glDetachShader(ID, fragment);
+            glDeleteShader(vertex);
+            glDeleteShader(fragment);
+            int linked = 0;
+            glGetProgramiv(ID, GL_LINK_STATUS, &linked);
+            if (linked) {
+                SaveProgramBinary(ID, cache_path);
+            }
+        }
+        // GLSL 3.30 cannot set a block's binding in the shader itself
+        BindUniformBlock("MaterialTable", MATERIAL_TABLE_BINDING);
+        BindUniformBlock("FrameCamera", CAMERA_BLOCK_BINDING);
+        BindUniformBlock("FrameLighting", LIGHTING_BLOCK_BINDING);
+        loadUniforms();
+        std::chrono::duration<double, std::milli> elapsed = std::chrono::steady_clock::now() - start;
+        std::cout << vertexPath << " + " << fragmentPath << (defines.empty() ? "" : " (variant)")
+                  << (cached ? " loaded from cache in " : " compiled in ") << elapsed.count() << " ms" << std::endl;
+}
+
+std::string Shader::insertDefines(const std::string &code, const std::string &defines) {
+    // GLSL requires #version to come before anything but comments and blank lines
+    size_t version = code.find("#version");
+    if (version == std::string::npos) {
+        return defines + code;
+    }
+    size_t line_end = code.find('\n', version);
+    if (line_end == std::string::npos) {
+        return code + "\n" + defines;
+    }
+    return code.substr(0, line_end + 1) + defines + code.substr(line_end + 1);
 }
 
 void Shader::use() {
-    glUseProgram(this->ID);
+    GLState::UseProgram(this->ID);
 }
 
 void Shader::setBool(const std::string &name, bool value) const {
-    glUniform1i(glGetUniformLocation(this->ID,name.c_str()),(int)value);
+    this->setSlot(this->findUniform(name),(int)value);
 }
 
 void Shader::setInt(const std::string &name, int value) const {
-    glUniform1i(glGetUniformLocation(this->ID,name.c_str()),value);
+    this->setSlot(this->findUniform(name),value);
 }
 
 void Shader::setFloat(const std::string &name, float value) const {
-    glUniform1f(glGetUniformLocation(this->ID,name.c_str()),value);
+    this->setSlot(this->findUniform(name),value);
 }
 
 void Shader::setVec4(const std::string &name, glm::vec4 vec) const {
-    glUniform4f(glGetUniformLocation(this->ID,name.c_str()),vec.x, vec.y,vec.z,vec.w);
+    this->setSlot(this->findUniform(name),vec);
 }
 
 void Shader::setMat4 (const std::string &name, glm::mat4 m) const 
 {
-    glUniformMatrix4fv(glGetUniformLocation(this->ID,name.c_str()),1,GL_FALSE,glm::value_ptr(m));
+    this->setSlot(this->findUniform(name),m);
+}
+
+void Shader::BindUniformBlock(const std::string &name, unsigned int binding) {
+    unsigned int block = glGetUniformBlockIndex(this->ID, name.c_str());
+    if (block != GL_INVALID_INDEX) {
+        glUniformBlockBinding(this->ID, block, binding);
+    }
+}
+
+UniformHandle Shader::GetUniform(const std::string &name) const {
+    return UniformHandle(this,this->findUniform(name));
+}
+
+UniformStats Shader::GetUniformStats() {
+    return uniform_stats;
+}
+
+void Shader::ResetUniformStats() {
+    uniform_stats = UniformStats();
+}
+
+void Shader::loadUniforms() {
+    int count = 0;
+    int max_length = 0;
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(this->ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &max_length);
+    std::vector<char> buffer(std::max(max_length, 1) + 1);
+    auto add = [this](const std::string &name) {
+        int location = glGetUniformLocation(this->ID, name.c_str());
+        if (location < 0) {
+            return;
+        }
+        UniformSlot slot;
+        slot.location = location;
+        slot.has_value = false;
+        this->uniform_names.push_back(std::make_pair(name, (int)this->uniform_slots.size()));
+        this->uniform_slots.push_back(slot);
+    };
+    for (int i = 0; i < count; i++) {
+        GLsizei length = 0;
+        GLint size = 0;
+        GLenum type = 0;
+        glGetActiveUniform(this->ID, i, (GLsizei)buffer.size(), &length, &size, &type, buffer.data());
+        std::string name(buffer.data(), length);
+        // Arrays are listed once, as "name[0]"; every element gets a slot of its own
+        size_t bracket = name.find('[');
+        if (size > 1 && bracket != std::string::npos) {
+            std::string base = name.substr(0, bracket);
+            for (int element = 0; element < size; element++) {
+                add(base + "[" + std::to_string(element) + "]");
+            }
+        } else {
+            add(name);
+        }
+    }
+    std::sort(this->uniform_names.begin(), this->uniform_names.end());
+}
+
+int Shader::findUniform(const std::string &name) const {
+    auto found = std::lower_bound(this->uniform_names.begin(), this->uniform_names.end(), name,
+        [](const std::pair<std::string, int> &entry, const std::string &key) {
+            return entry.first < key;
+        });
+    if (found == this->uniform_names.end() || found->first != name) {
+        return -1;
+    }
+    return found->second;
+}
+
+bool Shader::changeValue(int slot, const void *value, size_t bytes) const {
+    if (slot < 0) {
+        return false;
+    }
+    UniformSlot &uniform = this->uniform_slots[slot];
+    if (uniform.has_value && memcmp(uniform.value, value, bytes) == 0) {
+        uniform_stats.skipped++;
+        return false;
+    }
+    memcpy(uniform.value, value, bytes);
+    uniform.has_value = true;
+    uniform_stats.uploads++;
+    return true;
+}
+
+void Shader::setSlot(int slot, int value) const {
+    if (this->changeValue(slot,&value,sizeof(value))) {
+        glUniform1i(this->uniform_slots[slot].location,value);
+    }
+}
+
+void Shader::setSlot(int slot, float value) const {
+    if (this->changeValue(slot,&value,sizeof(value))) {
+        glUniform1f(this->uniform_slots[slot].location,value);
+    }
+}
+
+void Shader::setSlot(int slot, const glm::vec4 &vec) const {
+    if (this->changeValue(slot,&vec,sizeof(vec))) {
+        glUniform4f(this->uniform_slots[slot].location,vec.x, vec.y,vec.z,vec.w);
+    }
+}
+
+void Shader::setSlot(int slot, const glm::mat4 &m) const {
+    if (this->changeValue(slot,&m,sizeof(m))) {
+        glUniformMatrix4fv(this->uniform_slots[slot].location,1,GL_FALSE,glm::value_ptr(m));
+    }
+}
+
+UniformHandle::UniformHandle() : shader(nullptr), slot(-1) {}
+
+UniformHandle::UniformHandle(const Shader *shader, int slot) : shader(shader), slot(slot) {}
+
+bool UniformHandle::IsValid() const {
+    return this->shader != nullptr && this->slot >= 0;
+}
+
+void UniformHandle::Set(bool value) const {
+    if (this->IsValid()) this->shader->setSlot(this->slot,(int)value);
+}
+
+void UniformHandle::Set(int value) const {
+    if (this->IsValid()) this->shader->setSlot(this->slot,value);
+}
+
+void UniformHandle::Set(float value) const {
+    if (this->IsValid()) this->shader->setSlot(this->slot,value);
+}
+
+void UniformHandle::Set(const glm::vec4 &v) const {
+    if (this->IsValid()) this->shader->setSlot(this->slot,v);
+}
+
+void UniformHandle::Set(const glm::mat4 &m) const {
+    if (this->IsValid()) this->shader->setSlot(this->slot,m);
 }
 
 void Shader::checkCompileErrors(unsigned int shader, std::string type) {
@@ -8,10 +8,59 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <utility>
+
+//Uniform buffer binding point of the "MaterialTable" block (see vertex.glsl)
+const unsigned int MATERIAL_TABLE_BINDING = 0;
+//Binding points of the per-frame "FrameCamera" and "FrameLighting" blocks (see FrameUniforms)
+const unsigned int CAMERA_BLOCK_BINDING = 1;
+const unsigned int LIGHTING_BLOCK_BINDING = 2;
+//Binding point of a constant camera block that draws straight to the screen (HUD and font)
+const unsigned int SCREEN_CAMERA_BINDING = 3;
+
+class Shader;
+
+//A uniform of a Shader, resolved once (see Shader::GetUniform) so render code can set it
+// without looking up its name.  Setting a handle whose uniform is not active in the
+// shader does nothing.
+class UniformHandle {
+public:
+    //Constructor for a handle that refers to no uniform
+    UniformHandle();
+
+    //Returns true if the handle refers to an active uniform
+    bool IsValid() const;
+
+    //Sets the uniform (the shader must be in use, as with the Shader::set functions)
+    void Set(bool value) const;
+    void Set(int value) const;
+    void Set(float value) const;
+    void Set(const glm::vec4 &v) const;
+    void Set(const glm::mat4 &m) const;
+
+private:
+    friend class Shader;
+    UniformHandle(const Shader *shader, int slot);
+
+    const Shader *shader;
+    //Index of the uniform in the shader's table (-1 if there is none)
+    int slot;
+};
+
+//Uniform updates made by all shaders since the last ResetUniformStats
+struct UniformStats {
+    //glUniform* calls made
+    int uploads = 0;
+    //Updates skipped because the uniform already held the value
+    int skipped = 0;
+};
 
 //Class is similar to the one defined on www.learnopengl.com.  Primary
 // differences include: 1) separate header and source files; 2) use of the
-// GLM library to easily set vectors of size 4 (1-3 could be added separately).
+// GLM library to easily set vectors of size 4 (1-3 could be added separately);
+// 3) the active uniforms are listed once after linking, so setting a uniform never
+// asks GL for its location, and a uniform is only uploaded when its value changes.
 class Shader {
 public:
     //The ID of the resulting shader program
@@ -20,6 +69,9 @@ public:
     //Constructor for the shader program (takes the path to the
     //vertex and fragment shader GLSL files).
     Shader(const char* vertexPath, const char* fragmentPath);
+    //Constructor for a variant of the shader program: the lines in defines (for example
+    // "#define OBJECT_TYPE 1\n") are inserted after the #version line of both sources.
+    Shader(const char* vertexPath, const char* fragmentPath, const std::string &defines);
 
     //Use the shader program
     void use();
@@ -41,9 +93,58 @@ public:
     // sets the uniform to the matrix.
     void setMat4 (const std::string &name, glm::mat4 m) const;
 
+    //Connects the named uniform block (if the program has it) to a uniform buffer binding point.
+    // The MaterialTable, FrameCamera and FrameLighting blocks are connected to their default
+    // binding points when the program is linked.
+    void BindUniformBlock(const std::string &name, unsigned int binding);
+
+    //Returns a handle to the named uniform (an invalid handle if the uniform is not active).
+    // Elements of arrays are named "name[i]".
+    UniformHandle GetUniform(const std::string &name) const;
+
+    //Returns the uniform updates of all shaders since the last reset (the render loop resets
+    // them every frame)
+    static UniformStats GetUniformStats();
+    static void ResetUniformStats();
+
 private:
+    friend class UniformHandle;
+
+    //An active uniform and the last value uploaded to it
+    struct UniformSlot {
+        int location;
+        bool has_value;
+        unsigned char value[sizeof(glm::mat4)];
+    };
+
+    //The program keeps the values of its uniforms, so a shader is not copied
+    Shader(const Shader&) = delete;
+    Shader& operator=(const Shader&) = delete;
+
+    //Returns the source with the defines inserted after its #version line
+    static std::string insertDefines(const std::string &code, const std::string &defines);
+
     //Internal function used to check for errors during shader compilation.
     void checkCompileErrors(unsigned int shader, std::string type);
+
+    //Lists the active uniforms of the linked program
+    void loadUniforms();
+    //Returns the slot of the named uniform (-1 if it is not active)
+    int findUniform(const std::string &name) const;
+    //Records a new value for the slot.  Returns false (and counts a skipped update) if the
+    // uniform already holds it.
+    bool changeValue(int slot, const void *value, size_t bytes) const;
+
+    void setSlot(int slot, int value) const;
+    void setSlot(int slot, float value) const;
+    void setSlot(int slot, const glm::vec4 &v) const;
+    void setSlot(int slot, const glm::mat4 &m) const;
+
+    //Pairs of uniform names and slots, sorted by name
+    std::vector<std::pair<std::string, int>> uniform_names;
+    mutable std::vector<UniformSlot> uniform_slots;
+
+    static UniformStats uniform_stats;
 };
 
 #endif // SHADER_H_
@@ -0,0 +1,202 @@
+#include "asset_loader.hpp"
+#include "mapped_file.hpp"
+#include "../utilities/build_shapes.hpp"
+
+#include <memory>
+
+// Returns a hash of a decoded image (0 if it could not be decoded)
+static uint64_t ImageHash(const DecodedImage &image) {
+    if (image.pixels == NULL) {
+        return 0;
+    }
+    int size[3] = {image.width, image.height, image.channels};
+    uint64_t hash = HashBytes(size, sizeof(size));
+    return HashBytes(image.pixels, (size_t)image.width * image.height * image.channels, hash);
+}
+
+AssetLoader::AssetLoader(AssetRegistry &registry, int thread_count) : registry(&registry), pool(thread_count) {
+}
+
+void AssetLoader::LoadModel(std::string baseName, VAOStruct vao, MeshHandle *shape,
+                            TextureHandle *textures) {
+    // A model that is already registered is shared without reading it again
+    MeshHandle existing = this->registry->FindMesh(baseName);
+    if (existing) {
+        *shape = existing;
+        if (textures != NULL) {
+            this->LoadModelTextures(this->registry->MeshTexturePaths(baseName), textures);
+        }
+        return;
+    }
+
+    this->RunJob([this, baseName, vao, shape, textures]() {
+        std::shared_ptr<ImportedMesh> mesh = std::make_shared<ImportedMesh>();
+        this->importer.readMesh(baseName, *mesh);
+        // Shapes are only shared between models drawn with the same VAO
+        uint64_t content_hash = mesh->ContentHash();
+        if (content_hash != 0) {
+            content_hash = HashBytes(&vao.id, sizeof(vao.id), content_hash);
+        }
+
+        this->QueueUpload([this, mesh, baseName, vao, shape, textures, content_hash]() {
+            ImportOBJ::printSummary(*mesh);
+            MeshHandle found = this->registry->FindMesh(baseName, content_hash);
+            if (found) {
+                *shape = found;
+            } else {
+                *shape = this->registry->AddMesh(baseName, content_hash, ImportOBJ::genShape(*mesh, vao),
+                                                 mesh->texture_paths);
+            }
+            if (textures != NULL) {
+                this->LoadModelTextures(mesh->texture_paths, textures);
+            }
+        });
+    });
+}
+
+void AssetLoader::LoadModelTextures(const std::vector<std::string> &texture_paths, TextureHandle *textures) {
+    if (texture_paths.empty()) {
+        return;
+    }
+    this->LoadTextureArray(texture_paths, true, textures);
+}
+
+void AssetLoader::LoadTexture(std::string texture_path, bool flipped, TextureHandle *texture) {
+    std::string name = AssetRegistry::TextureName(texture_path, flipped);
+    TextureHandle existing = this->registry->FindTexture(name);
+    if (existing) {
+        *texture = existing;
+        return;
+    }
+
+    this->RunJob([this, texture_path, name, flipped, texture]() {
+        DecodedImage image = DecodeImage(texture_path, flipped);
+        uint64_t content_hash = ImageHash(image);
+        this->QueueUpload([this, image, name, content_hash, texture]() mutable {
+            TextureHandle found = this->registry->FindTexture(name, content_hash);
+            if (found) {
+                FreeImage(image);
+                *texture = found;
+                return;
+            }
+            size_t bytes = TextureBytes(image, true);
+            double decode_ms = image.decode_ms;
+            *texture = this->registry->AddTexture(name, content_hash, UploadTexture(image), bytes,
+                                                  GL_TEXTURE_2D, decode_ms);
+        });
+    });
+}
+
+void AssetLoader::LoadCubeMap(std::vector<std::string> faces, bool flip, TextureHandle *texture) {
+    std::string name = "cubemap:";
+    for (const std::string &face : faces) {
+        name += AssetRegistry::TextureName(face, flip) + ";";
+    }
+    this->LoadImageSet(name, faces, flip, GL_TEXTURE_CUBE_MAP, texture);
+}
+
+void AssetLoader::LoadTextureArray(std::vector<std::string> layers, bool flipped, TextureHandle *texture) {
+    std::string name = "array:";
+    for (const std::string &layer : layers) {
+        name += AssetRegistry::TextureName(layer, flipped) + ";";
+    }
+    this->LoadImageSet(name, layers, flipped, GL_TEXTURE_2D_ARRAY, texture);
+}
+
+void AssetLoader::LoadImageSet(std::string name, std::vector<std::string> paths, bool flip, GLenum target,
+                               TextureHandle *texture) {
+    TextureHandle existing = this->registry->FindTexture(name);
+    if (existing) {
+        *texture = existing;
+        return;
+    }
+
+    // Each image is decoded separately; the last one to finish queues the upload
+    std::shared_ptr<std::vector<DecodedImage>> images = std::make_shared<std::vector<DecodedImage>>(paths.size());
+    std::shared_ptr<int> remaining = std::make_shared<int>(paths.size());
+    for (size_t i = 0; i < paths.size(); i++) {
+        std::string path = paths[i];
+        this->RunJob([this, path, flip, name, target, images, remaining, texture, i]() {
+            (*images)[i] = DecodeImage(path, flip);
+            bool last_image;
+            {
+                std::lock_guard<std::mutex> lock(this->mutex);
+                last_image = (--(*remaining) == 0);
+            }
+            if (last_image) {
+                // Sets with a missing image are not shared by content
+                uint64_t content_hash = HashBytes(&target, sizeof(target));
+                bool decoded = true;
+                size_t bytes = 0;
+                double decode_ms = 0.0;
+                for (const DecodedImage &image : *images) {
+                    uint64_t image_hash = ImageHash(image);
+                    decoded = decoded && image_hash != 0;
+                    content_hash = HashBytes(&image_hash, sizeof(image_hash), content_hash);
+                    bytes += TextureBytes(image, false);
+                    decode_ms += image.decode_ms;
+                }
+                if (!decoded) {
+                    content_hash = 0;
+                }
+                if (target == GL_TEXTURE_2D_ARRAY) {
+                    bytes = TextureArrayBytes(*images);
+                }
+                this->QueueUpload([this, images, name, target, content_hash, bytes, decode_ms, texture]() {
+                    TextureHandle found = this->registry->FindTexture(name, content_hash);
+                    if (found) {
+                        for (DecodedImage &image : *images) {
+                            FreeImage(image);
+                        }
+                        *texture = found;
+                        return;
+                    }
+                    unsigned int id = target == GL_TEXTURE_CUBE_MAP ? UploadCubeMap(*images) : UploadTextureArray(*images);
+                    *texture = this->registry->AddTexture(name, content_hash, id, bytes, target, decode_ms);
+                });
+            }
+        });
+    }
+}
+
+void AssetLoader::Finish() {
+    std::unique_lock<std::mutex> lock(this->mutex);
+    while (true) {
+        this->upload_ready.wait(lock, [this] { return !this->uploads.empty() || this->pending_jobs == 0; });
+        if (this->uploads.empty()) {
+            return;
+        }
+        std::function<void()> upload = std::move(this->uploads.front());
+        this->uploads.pop_front();
+        lock.unlock();
+        upload();
+        lock.lock();
+    }
+}
+
+int AssetLoader::ThreadCount() const {
+    return this->pool.ThreadCount();
+}
+
+void AssetLoader::RunJob(std::function<void()> job) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->pending_jobs++;
+    }
+    this->pool.Submit([this, job]() {
+        job();
+        {
+            std::lock_guard<std::mutex> lock(this->mutex);
+            this->pending_jobs--;
+        }
+        this->upload_ready.notify_all();
+    });
+}
+
+void AssetLoader::QueueUpload(std::function<void()> upload) {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->uploads.push_back(std::move(upload));
+    }
+    this->upload_ready.notify_all();
+}
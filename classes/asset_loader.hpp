@@ -0,0 +1,76 @@
+#ifndef ASSET_LOADER_HPP
+#define ASSET_LOADER_HPP
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+#include "import_object.hpp"
+#include "asset_registry.hpp"
+#include "thread_pool.hpp"
+
+//AssetLoader loads models and textures on a pool of worker threads.  Workers do
+// everything that does not need OpenGL (reading .OBJ/.MTL files or mesh caches,
+// decoding images) and queue the remaining step (creating the buffers/textures)
+// for the thread that owns the OpenGL context, which runs them in Finish().
+// Everything is registered in an AssetRegistry: assets it already has (by name or
+// by content) are shared instead of being uploaded again.
+// Results are written through the pointers passed to the Load* functions, so those
+// must stay valid until Finish() returns.
+class AssetLoader {
+    public:
+        //Creates a loader that adds to the given registry, with the given number of
+        // worker threads (0 loads everything serially on the calling thread)
+        AssetLoader(AssetRegistry &registry, int thread_count = ThreadPool::HardwareThreads());
+
+        //Queues a model (base name without the .OBJ/.MTL extension).  If textures is
+        // not NULL it receives a texture array with one layer per map_Kd entry of the
+        // model (a material's texture index is its layer), or stays empty if the model
+        // has no textures.
+        void LoadModel(std::string name_without_file_extension, VAOStruct vao, MeshHandle *shape,
+                       TextureHandle *textures = NULL);
+        //Queues a 2D texture
+        void LoadTexture(std::string texture_path, bool flipped, TextureHandle *texture);
+        //Queues a cubemap made of six images
+        void LoadCubeMap(std::vector<std::string> faces, bool flip, TextureHandle *texture);
+        //Queues a 2D texture array with one layer per image (see UploadTextureArray)
+        void LoadTextureArray(std::vector<std::string> layers, bool flipped, TextureHandle *texture);
+
+        //Runs the OpenGL uploads on the calling thread as the workers finish, and
+        // returns once everything queued so far has been loaded
+        void Finish();
+
+        //Returns the number of worker threads
+        int ThreadCount() const;
+
+        //Settings used for every model (shared by the workers, so set them before loading)
+        ImportOBJ importer;
+
+    private:
+        AssetLoader(const AssetLoader&) = delete;
+        AssetLoader& operator=(const AssetLoader&) = delete;
+
+        //Runs a job on the pool and keeps count of the jobs still running
+        void RunJob(std::function<void()> job);
+        //Queues work for the OpenGL context thread
+        void QueueUpload(std::function<void()> upload);
+        //Queues the texture array of a model (on the OpenGL context thread)
+        void LoadModelTextures(const std::vector<std::string> &texture_paths, TextureHandle *textures);
+        //Decodes the images on the workers and uploads them as one texture of the target
+        // (GL_TEXTURE_CUBE_MAP or GL_TEXTURE_2D_ARRAY) registered under the name
+        void LoadImageSet(std::string name, std::vector<std::string> paths, bool flipped, GLenum target,
+                          TextureHandle *texture);
+
+        //Only used on the OpenGL context thread
+        AssetRegistry *registry;
+        std::mutex mutex;
+        std::condition_variable upload_ready;
+        std::deque<std::function<void()>> uploads;
+        int pending_jobs = 0;
+        //Declared last so the workers are stopped before the queue they use is destroyed
+        ThreadPool pool;
+};
+
+#endif //ASSET_LOADER_HPP
@@ -0,0 +1,181 @@
+#include "asset_registry.hpp"
+#include "gl_state.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <iterator>
+
+// Keys of assets without a content hash count down from the top, away from real hashes
+static const uint64_t UNHASHED_KEY_BASE = ~(uint64_t)0;
+
+AssetRegistry::AssetRegistry() {
+}
+
+uint64_t AssetRegistry::EntryKey(uint64_t content_hash) {
+    if (content_hash != 0) {
+        return content_hash;
+    }
+    return UNHASHED_KEY_BASE - this->next_unhashed_key++;
+}
+
+MeshHandle AssetRegistry::FindMesh(const std::string &name, uint64_t content_hash) {
+    std::map<std::string, uint64_t>::iterator found = this->mesh_names.find(name);
+    uint64_t key = 0;
+    if (found != this->mesh_names.end()) {
+        key = found->second;
+    } else if (content_hash != 0 && this->meshes.count(content_hash) > 0) {
+        key = content_hash;
+        this->mesh_names[name] = key;
+    } else {
+        return MeshHandle();
+    }
+    MeshEntry &entry = this->meshes[key];
+    this->shared_meshes++;
+    this->shared_bytes += entry.gpu_bytes;
+    return entry.mesh;
+}
+
+MeshHandle AssetRegistry::AddMesh(const std::string &name, uint64_t content_hash, BasicShape shape,
+                                  std::vector<std::string> texture_paths) {
+    uint64_t key = this->EntryKey(content_hash);
+    MeshEntry &entry = this->meshes[key];
+    if (entry.mesh) {
+        // Only reached when the caller skipped FindMesh: keep the existing copy
+        shape.DeallocateShape();
+    } else {
+        entry.mesh = std::make_shared<BasicShape>(shape);
+        entry.gpu_bytes = shape.GetBufferBytes();
+        entry.texture_paths = texture_paths;
+    }
+    this->mesh_names[name] = key;
+    return entry.mesh;
+}
+
+std::vector<std::string> AssetRegistry::MeshTexturePaths(const std::string &name) const {
+    std::map<std::string, uint64_t>::const_iterator found = this->mesh_names.find(name);
+    if (found == this->mesh_names.end()) {
+        return std::vector<std::string>();
+    }
+    return this->meshes.at(found->second).texture_paths;
+}
+
+TextureHandle AssetRegistry::FindTexture(const std::string &name, uint64_t content_hash) {
+    std::map<std::string, uint64_t>::iterator found = this->texture_names.find(name);
+    uint64_t key = 0;
+    if (found != this->texture_names.end()) {
+        key = found->second;
+    } else if (content_hash != 0 && this->textures.count(content_hash) > 0) {
+        key = content_hash;
+        this->texture_names[name] = key;
+    } else {
+        return TextureHandle();
+    }
+    TextureEntry &entry = this->textures[key];
+    this->shared_textures++;
+    this->shared_bytes += entry.gpu_bytes;
+    return entry.texture;
+}
+
+TextureHandle AssetRegistry::AddTexture(const std::string &name, uint64_t content_hash, unsigned int texture,
+                                        size_t gpu_bytes, GLenum target, double decode_ms) {
+    uint64_t key = this->EntryKey(content_hash);
+    TextureEntry &entry = this->textures[key];
+    if (entry.texture) {
+        // Only reached when the caller skipped FindTexture: keep the existing copy
+        if (texture != 0 && texture != entry.texture->id) {
+            GLState::DeleteTextures(1, &texture);
+        }
+    } else {
+        entry.texture = std::make_shared<RegisteredTexture>();
+        entry.texture->id = texture;
+        entry.texture->target = target;
+        entry.gpu_bytes = gpu_bytes;
+        this->added_textures++;
+        this->texture_decode_ms += decode_ms;
+    }
+    this->texture_names[name] = key;
+    return entry.texture;
+}
+
+int AssetRegistry::ReleaseUnused() {
+    int released = 0;
+    for (std::map<uint64_t, MeshEntry>::iterator i = this->meshes.begin(); i != this->meshes.end();) {
+        if (i->second.mesh.use_count() == 1) {
+            i->second.mesh->DeallocateShape();
+            for (std::map<std::string, uint64_t>::iterator n = this->mesh_names.begin(); n != this->mesh_names.end();) {
+                n = (n->second == i->first) ? this->mesh_names.erase(n) : std::next(n);
+            }
+            i = this->meshes.erase(i);
+            released++;
+        } else {
+            i++;
+        }
+    }
+    for (std::map<uint64_t, TextureEntry>::iterator i = this->textures.begin(); i != this->textures.end();) {
+        if (i->second.texture.use_count() == 1) {
+            if (i->second.texture->id != 0) {
+                GLState::DeleteTextures(1, &(i->second.texture->id));
+            }
+            i->second.texture->id = 0;
+            for (std::map<std::string, uint64_t>::iterator n = this->texture_names.begin(); n != this->texture_names.end();) {
+                n = (n->second == i->first) ? this->texture_names.erase(n) : std::next(n);
+            }
+            i = this->textures.erase(i);
+            released++;
+        } else {
+            i++;
+        }
+    }
+    return released;
+}
+
+void AssetRegistry::Clear() {
+    for (std::pair<const uint64_t, MeshEntry> &entry : this->meshes) {
+        entry.second.mesh->DeallocateShape();
+    }
+    for (std::pair<const uint64_t, TextureEntry> &entry : this->textures) {
+        if (entry.second.texture->id != 0) {
+            GLState::DeleteTextures(1, &(entry.second.texture->id));
+        }
+        entry.second.texture->id = 0;
+    }
+    this->meshes.clear();
+    this->mesh_names.clear();
+    this->textures.clear();
+    this->texture_names.clear();
+}
+
+void AssetRegistry::PrintSummary() const {
+    size_t mesh_bytes = 0;
+    for (const std::pair<const uint64_t, MeshEntry> &entry : this->meshes) {
+        mesh_bytes += entry.second.gpu_bytes;
+    }
+    size_t texture_bytes = 0;
+    for (const std::pair<const uint64_t, TextureEntry> &entry : this->textures) {
+        texture_bytes += entry.second.gpu_bytes;
+    }
+    std::ostringstream report;
+    report<<std::fixed<<std::setprecision(1);
+    report<<"Assets: "<<this->meshes.size()<<" meshes ("<<mesh_bytes/1024.0<<" KB), "
+          <<this->textures.size()<<" textures ("<<texture_bytes/1024.0<<" KB); "
+          <<this->shared_meshes<<" mesh and "<<this->shared_textures<<" texture loads shared an existing copy ("
+          <<this->shared_bytes/1024.0<<" KB saved)";
+    std::cout<<report.str()<<std::endl;
+}
+
+TextureCacheStats AssetRegistry::TextureStats() const {
+    TextureCacheStats stats;
+    stats.hits = this->shared_textures;
+    stats.misses = this->added_textures;
+    stats.textures = this->textures.size();
+    for (const std::pair<const uint64_t, TextureEntry> &entry : this->textures) {
+        stats.resident_bytes += entry.second.gpu_bytes;
+    }
+    stats.decode_ms = this->texture_decode_ms;
+    return stats;
+}
+
+std::string AssetRegistry::TextureName(const std::string &path, bool flipped) {
+    return flipped ? path + " (flipped)" : path;
+}
@@ -0,0 +1,108 @@
+#ifndef ASSET_REGISTRY_HPP
+#define ASSET_REGISTRY_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <memory>
+#include <cstdint>
+#include "basic_shape.hpp"
+#include "../utilities/build_shapes.hpp"
+
+//A shape owned by an AssetRegistry.  Every copy of the handle draws the same GPU
+// buffers, which only the registry frees.
+typedef std::shared_ptr<BasicShape> MeshHandle;
+
+//A texture owned by an AssetRegistry
+struct RegisteredTexture {
+    unsigned int id = 0;
+    //GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY or GL_TEXTURE_CUBE_MAP
+    GLenum target = GL_TEXTURE_2D;
+};
+typedef std::shared_ptr<RegisteredTexture> TextureHandle;
+
+/** AssetRegistry owns the GPU meshes and textures of a scene and hands out
+ *  reference-counted handles to them.  Assets are found by name (a model's base
+ *  name or a texture's path) and by a hash of their contents, so loading the same
+ *  file twice, or two files with identical data, shares one GPU copy.  Every asset
+ *  is freed exactly once: by ReleaseUnused() once no handle outside the registry
+ *  uses it, or by Clear().  Only use the registry on the OpenGL context thread.
+ **/
+class AssetRegistry {
+    public:
+        AssetRegistry();
+        //Registries can be moved but not copied (each asset has one owner).  Destroying
+        // a registry does not free anything, since the context may already be gone.
+        AssetRegistry(AssetRegistry&&) = default;
+        AssetRegistry& operator=(AssetRegistry&&) = default;
+
+        //Returns the mesh registered under the name or, failing that, the one with the
+        // same content hash (which is then also registered under the name).  Returns
+        // an empty handle if there is none.  A content_hash of 0 never matches.
+        MeshHandle FindMesh(const std::string &name, uint64_t content_hash = 0);
+        //Registers a new shape (which the registry now owns) under the name and returns
+        // its handle.  texture_paths lists the model's texture files (see MeshTexturePaths).
+        MeshHandle AddMesh(const std::string &name, uint64_t content_hash, BasicShape shape,
+                           std::vector<std::string> texture_paths = std::vector<std::string>());
+        //Returns the texture files of a registered mesh
+        std::vector<std::string> MeshTexturePaths(const std::string &name) const;
+
+        //Same as FindMesh for textures
+        TextureHandle FindTexture(const std::string &name, uint64_t content_hash = 0);
+        //Same as AddMesh for a texture of the given target.  decode_ms is the time
+        // spent decoding its images (reported by TextureStats).
+        TextureHandle AddTexture(const std::string &name, uint64_t content_hash, unsigned int texture,
+                                 size_t gpu_bytes, GLenum target = GL_TEXTURE_2D, double decode_ms = 0.0);
+
+        //Frees every asset that is no longer used outside the registry and returns
+        // how many were freed
+        int ReleaseUnused();
+        //Frees every asset (call before the OpenGL context is destroyed).  Handles
+        // that are still held afterwards refer to empty shapes and texture 0.
+        void Clear();
+
+        //Prints the registered assets, their GPU memory, and how often loads were shared
+        void PrintSummary() const;
+        //Returns how many texture lookups found a registered texture (hits) or had
+        // to add a new one (misses), and the textures that are registered now
+        TextureCacheStats TextureStats() const;
+
+        //Name of a texture file loaded with the given flip setting
+        static std::string TextureName(const std::string &path, bool flipped);
+
+    private:
+        AssetRegistry(const AssetRegistry&) = delete;
+        AssetRegistry& operator=(const AssetRegistry&) = delete;
+
+        struct MeshEntry {
+            MeshHandle mesh;
+            size_t gpu_bytes = 0;
+            std::vector<std::string> texture_paths;
+        };
+        struct TextureEntry {
+            TextureHandle texture;
+            size_t gpu_bytes = 0;
+        };
+
+        //Entries are keyed by content hash (or by a unique number when there is none)
+        // and names refer to those keys
+        std::map<uint64_t, MeshEntry> meshes;
+        std::map<std::string, uint64_t> mesh_names;
+        std::map<uint64_t, TextureEntry> textures;
+        std::map<std::string, uint64_t> texture_names;
+        uint64_t next_unhashed_key = 0;
+
+        //Number of Find calls that were answered with an existing asset
+        int shared_meshes = 0;
+        int shared_textures = 0;
+        //Number of textures added, and the time spent decoding them
+        int added_textures = 0;
+        double texture_decode_ms = 0.0;
+        //GPU memory that loading those assets again would have used
+        size_t shared_bytes = 0;
+
+        //Returns the key used for a content hash (0 gets a unique key)
+        uint64_t EntryKey(uint64_t content_hash);
+};
+
+#endif //ASSET_REGISTRY_HPP
@@ -1,8 +1,7 @@
 #include "avatar.hpp"
-#include <glm/gtc/matrix_transform.hpp>
 
 
-Avatar::Avatar(BasicShape shape, float orientation, glm::vec3 initial_position, int shader_state) {
+Avatar::Avatar(MeshHandle shape, float orientation, glm::vec3 initial_position, int shader_state) {
     this->body = shape;
     this->initial_rotation = orientation;
     this->current_rotation = 0.0;
@@ -57,16 +56,13 @@ void Avatar::Scale(glm::vec3 new_scale) {
     this->scale = new_scale;
 }
 
-void Avatar::Draw(Shader *shader, bool use_shader) {
-    if (use_shader) {
-        shader->use();
-    }
-    glm::mat4 local(1.0);
-    local = glm::translate(local, this->position);
+SceneTransform Avatar::LocalTransform() {
+    SceneTransform local;
+    local.translation = this->position;
     
     // Add vertical offset for jump
     if (is_flipping) {
-        local = glm::translate(local, glm::vec3(0.0f, flip_height, 0.0f));
+        local.translation.y += flip_height;
         
         // Start rotation only after initial rise (20% into animation)
         // Complete rotation before landing (90% of animation)
@@ -74,22 +70,22 @@ void Avatar::Draw(Shader *shader, bool use_shader) {
             // Map 0.2-0.9 range to 0-1 for rotation progress
             float rotation_progress = (flip_progress - 0.2f) / 0.7f;
             // Apply faster rotation in middle of jump
-            local = glm::rotate(local, glm::radians(rotation_progress * 360.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            local.rotation.x = rotation_progress * 360.0f;
         } else if (flip_progress >= 0.9f) {
             // Keep final rotation
-            local = glm::rotate(local, glm::radians(360.0f), glm::vec3(1.0f, 0.0f, 0.0f));
+            local.rotation.x = 360.0f;
         }
     }
     
-    local = glm::rotate(local, glm::radians(this->current_rotation), glm::vec3(0.0, 1.0, 0.0));
-    local = glm::rotate(local, glm::radians(this->initial_rotation), glm::vec3(0.0, 1.0, 0.0));
-    local = glm::scale(local, this->scale);
-    shader->setMat4("local", local);
-    shader->setInt("shader_state", this->shader_state);
-    this->body.Draw();
+    local.rotation.y = this->current_rotation + this->initial_rotation;
+    local.scale = this->scale;
+    return local;
 }
 
+MeshHandle Avatar::GetBody() {
+    return this->body;
+}
 
-Avatar::~Avatar() {
-    this->body.DeallocateShape();
-}
\ No newline at end of file
+int Avatar::GetShaderState() {
+    return this->shader_state;
+}
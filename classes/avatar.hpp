@@ -1,10 +1,13 @@
 #ifndef AVATAR_HPP
 #define AVATAR_HPP
 #include "basic_shape.hpp"
+#include "asset_registry.hpp"
+#include "scene_graph.hpp"
 
 class Avatar {
     protected:
-        BasicShape body;
+        //Shared with every other user of the mesh (the asset registry frees it)
+        MeshHandle body;
         float initial_rotation;
         float current_rotation;
         float speed;
@@ -19,11 +22,15 @@ class Avatar {
         float flip_duration;
     
     public:
-        Avatar(BasicShape shape, float orientation, glm::vec3 initial_position, int shader_state);
+        Avatar(MeshHandle shape, float orientation, glm::vec3 initial_position, int shader_state);
         void ProcessInput (GLFWwindow *window, float time_passed);
         void Scale (glm::vec3 new_scale);
-        void Draw (Shader *shader, bool use_shader=false);
-        ~Avatar();
+        //Returns the placement of the body (the jump and flip included) as a scene graph node's
+        // local transform
+        SceneTransform LocalTransform ();
+        MeshHandle GetBody ();
+        //Returns the object type (ObjectType) the body is drawn as
+        int GetShaderState ();
 };;
 
 
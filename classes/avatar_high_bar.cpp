@@ -1,7 +1,6 @@
 #include "avatar_high_bar.hpp"
-#include <glm/gtc/matrix_transform.hpp>
 
-AvatarHighBar::AvatarHighBar(BasicShape shape, float orientation, 
+AvatarHighBar::AvatarHighBar(MeshHandle shape, float orientation, 
                            glm::vec3 initial_position, int shader_state) 
     : Avatar(shape, orientation, initial_position, shader_state) {
     // Initialize the toggle state variables
@@ -117,24 +116,19 @@ void AvatarHighBar::ProcessInput(GLFWwindow *window, float time_passed) {
     }
 }
 
-void AvatarHighBar::Draw(Shader *shader, bool use_shader) {
-    if (use_shader) {
-        shader->use();
-    }
-    glm::mat4 local(1.0);
-    local = glm::translate(local, this->position);
+SceneTransform AvatarHighBar::LocalTransform() {
+    SceneTransform local;
+    local.translation = this->position;
     
     if (is_rotating_around_bar) {
         // Apply X-axis rotation based on the x_rotation_angle
-        local = glm::rotate(local, glm::radians(x_rotation_angle), glm::vec3(1.0f, 0.0f, 0.0f));
+        local.rotation.x = x_rotation_angle;
     }
 
     // Always apply the initial rotation around Y (from parent class)
-    local = glm::rotate(local, glm::radians(this->initial_rotation), glm::vec3(0.0, 1.0, 0.0));
-    local = glm::scale(local, this->scale);
-    shader->setMat4("local", local);
-    shader->setInt("shader_state", this->shader_state);
-    this->body.Draw();
+    local.rotation.y = this->initial_rotation;
+    local.scale = this->scale;
+    return local;
 }
 
 void AvatarHighBar::GetXRotationAngle(float &angle) {
@@ -19,10 +19,12 @@ class AvatarHighBar : public Avatar {
         
     public:
         // Constructor that passes parameters to the parent Avatar class
-        AvatarHighBar(BasicShape shape, float orientation, glm::vec3 initial_position, int shader_state);
+        AvatarHighBar(MeshHandle shape, float orientation, glm::vec3 initial_position, int shader_state);
         
         void ProcessInput(GLFWwindow *window, float time_passed);
-        void Draw(Shader *shader, bool use_shader);
+        //Returns the placement of the body (including the swing around the bar) as a scene
+        // graph node's local transform
+        SceneTransform LocalTransform();
         void GetXRotationAngle(float &angle);
         void GetPosition(glm::vec3 &pos);
         glm::vec3 GetDefaultPosition();
@@ -1,4 +1,7 @@
 #include "basic_shape.hpp"
+#include "gl_state.hpp"
+#include <algorithm>
+#include <cstddef>
 
 BasicShape::BasicShape()
 {
@@ -7,7 +10,7 @@ BasicShape::BasicShape()
     this->primitive = GL_TRIANGLES;
 }
 
-void BasicShape::Initialize(VAOStruct vao, float* vertices, int vertices_bytes, int num_vertices, GLuint prim)
+void BasicShape::Initialize(VAOStruct vao, const float* vertices, int vertices_bytes, int num_vertices, GLuint prim)
 {
     this->vao = vao;
     this->number_vertices = num_vertices;
@@ -15,22 +18,63 @@ void BasicShape::Initialize(VAOStruct vao, float* vertices, int vertices_bytes,
     glGenBuffers(1,&(this->vbo));
     glBindBuffer(GL_ARRAY_BUFFER,this->vbo);
     glBufferData(GL_ARRAY_BUFFER,vertices_bytes,vertices,GL_STATIC_DRAW);
+    this->buffer_bytes += vertices_bytes;
+    //The attribute pointers are recorded in a vertex array of the shape's own
+    glGenVertexArrays(1,&(this->vao.id));
+    BindVAO(this->vao,this->vbo,GL_ARRAY_BUFFER);
+    GLState::BindVertexArray(0);
+    if (num_vertices > 0) {
+        ComputeBounds(vertices,num_vertices,vertices_bytes/num_vertices,this->bounds,this->bounding_sphere);
+    }
 
 }
 
-void BasicShape::InitializeEBO(unsigned int *ebo_data, int ebo_bytes, 
-                            int num_indices, int primitive)
+void BasicShape::InitializeEBO(const void *ebo_data, int ebo_bytes, 
+                            int num_indices, int primitive, GLenum index_type)
 {
     this->ebo_number_indices = num_indices;
     this->ebo_primitive = primitive;
+    this->ebo_index_type = index_type;
     glGenBuffers(1,&(this->ebo));
+    //The element buffer binding is part of the vertex array's state
+    GLState::BindVertexArray(this->vao.id);
     glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,this->ebo);
     glBufferData(GL_ELEMENT_ARRAY_BUFFER,ebo_bytes,ebo_data,GL_STATIC_DRAW);
+    GLState::BindVertexArray(0);
+    this->buffer_bytes += ebo_bytes;
+}
+
+void BasicShape::InitializeIndices(const void *index_data, int index_bytes,
+                            int num_indices, GLenum index_type)
+{
+    this->InitializeEBO(index_data,index_bytes,num_indices,this->primitive,index_type);
+    this->draw_indexed = true;
+}
+
+void BasicShape::InitializeLODs(const std::vector<ShapeLOD> &levels)
+{
+    this->lods = levels;
+}
+
+void BasicShape::InitializeMaterialTable(const void *table_data, int table_bytes)
+{
+    glGenBuffers(1,&(this->material_ubo));
+    glBindBuffer(GL_UNIFORM_BUFFER,this->material_ubo);
+    glBufferData(GL_UNIFORM_BUFFER,table_bytes,table_data,GL_STATIC_DRAW);
+    this->buffer_bytes += table_bytes;
 }
 
-void BasicShape::Draw (Shader shader)
+void BasicShape::UpdateMaterialTable(const void *table_data, int offset_bytes, int table_bytes)
 {
-    glUseProgram(shader.ID);
+    if (this->material_ubo == 0)
+        return;
+    glBindBuffer(GL_UNIFORM_BUFFER,this->material_ubo);
+    glBufferSubData(GL_UNIFORM_BUFFER,offset_bytes,table_bytes,table_data);
+}
+
+void BasicShape::Draw (Shader &shader)
+{
+    shader.use();
     this->Draw();
 
 }
@@ -42,28 +86,307 @@ void BasicShape::DrawEBO (float line_width)
         std::cout<<"Attempted to draw ebo "<<this->ebo<<std::endl;
         return;
     }
-    BindVAO(this->vao, this->vbo);
-    glLineWidth(line_width);
-    glBindBuffer(GL_ELEMENT_ARRAY_BUFFER,this->ebo);
-    glDrawElements(this->ebo_primitive,this->ebo_number_indices,GL_UNSIGNED_INT,0);
-    glLineWidth(1.0);
+    GLState::BindVertexArray(this->vao.id);
+    GLState::LineWidth(line_width);
+    glDrawElements(this->ebo_primitive,this->ebo_number_indices,this->ebo_index_type,0);
+    GLState::LineWidth(1.0f);
 }
 
 void BasicShape::Draw ()
 {
     //Assumes the shader has already been set (more efficient)
-    BindVAO(this->vao,this->vbo,GL_ARRAY_BUFFER);
+    this->DrawLOD(0);
+}
+
+void BasicShape::DrawLOD (int lod)
+{
+    GLState::BindVertexArray(this->vao.id);
+    if (this->material_ubo > 0) {
+        glBindBufferBase(GL_UNIFORM_BUFFER,MATERIAL_TABLE_BINDING,this->material_ubo);
+    }
+    if (this->draw_indexed) {
+        if (this->lods.empty()) {
+            glDrawElements(this->primitive,this->ebo_number_indices,this->ebo_index_type,0);
+            return;
+        }
+        const ShapeLOD &level = this->lods[std::max(0, std::min(lod, (int)this->lods.size() - 1))];
+        size_t index_bytes = this->ebo_index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+        glDrawElements(this->primitive,level.index_count,this->ebo_index_type,
+                       (const void*)(level.first_index * index_bytes));
+        return;
+    }
     glDrawArrays(this->primitive,0,this->number_vertices);
 
 }
 
+int BasicShape::SelectLOD (const glm::mat4 &transform, const LODView &view)
+{
+    if (!view.enabled || this->lods.size() < 2) {
+        return 0;
+    }
+    //The error grows with the largest scale of the transform and shrinks with the distance
+    //  to the camera (measured to the nearest point of the bounding sphere)
+    float scale = MaxScale(transform);
+    BoundingSphere sphere = TransformSphere(this->bounding_sphere, transform);
+    float distance = glm::length(sphere.center - view.camera_position) - sphere.radius;
+    if (distance <= 0.0f) {
+        return 0;
+    }
+    for (int lod = (int)this->lods.size() - 1; lod > 0; lod--) {
+        if (this->lods[lod].error * scale * view.pixels_per_unit / distance <= view.max_pixel_error) {
+            return lod;
+        }
+    }
+    return 0;
+}
+
+void BasicShape::Draw (const glm::mat4 &transform, LODView &view)
+{
+    int lod = this->SelectLOD(transform, view);
+    view.triangles += this->TriangleCount(lod);
+    view.full_triangles += this->TriangleCount(0);
+    this->DrawLOD(lod);
+}
+
+int BasicShape::DrawInstanced (const std::vector<InstanceData> &instances, LODView &view)
+{
+    if (instances.empty()) {
+        return 0;
+    }
+    //Group the instances by level of detail so each level is one draw
+    int levels = this->LODCount();
+    std::vector<int> counts(levels, 0);
+    std::vector<int> instance_lods(instances.size());
+    for (size_t i = 0; i < instances.size(); i++) {
+        instance_lods[i] = this->SelectLOD(instances[i].transform, view);
+        counts[instance_lods[i]]++;
+    }
+    std::vector<int> firsts(levels, 0);
+    for (int lod = 1; lod < levels; lod++) {
+        firsts[lod] = firsts[lod - 1] + counts[lod - 1];
+    }
+    this->instance_order.resize(instances.size());
+    std::vector<int> next = firsts;
+    for (size_t i = 0; i < instances.size(); i++) {
+        this->instance_order[next[instance_lods[i]]++] = instances[i];
+    }
+
+    //The buffer is orphaned before every upload, so a draw still reading the previous
+    //  instances (the shadow pass's) does not stall it
+    int count = (int)instances.size();
+    if (this->instance_vbo == 0) {
+        this->attachInstanceBuffer();
+    }
+    glBindBuffer(GL_ARRAY_BUFFER,this->instance_vbo);
+    if (count > this->instance_capacity) {
+        this->instance_capacity = std::max(count, this->instance_capacity * 2);
+    }
+    glBufferData(GL_ARRAY_BUFFER,this->instance_capacity * sizeof(InstanceData),NULL,GL_STREAM_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER,0,count * sizeof(InstanceData),this->instance_order.data());
+
+    GLState::BindVertexArray(this->vao.id);
+    if (this->material_ubo > 0) {
+        glBindBufferBase(GL_UNIFORM_BUFFER,MATERIAL_TABLE_BINDING,this->material_ubo);
+    }
+    int draws = 0;
+    for (int lod = 0; lod < levels; lod++) {
+        if (counts[lod] == 0) {
+            continue;
+        }
+        this->pointInstanceAttributes(firsts[lod]);
+        view.triangles += (long long)this->TriangleCount(lod) * counts[lod];
+        view.full_triangles += (long long)this->TriangleCount(0) * counts[lod];
+        if (!this->draw_indexed) {
+            glDrawArraysInstanced(this->primitive,0,this->number_vertices,counts[lod]);
+        } else if (this->lods.empty()) {
+            glDrawElementsInstanced(this->primitive,this->ebo_number_indices,this->ebo_index_type,0,counts[lod]);
+        } else {
+            const ShapeLOD &level = this->lods[lod];
+            size_t index_bytes = this->ebo_index_type == GL_UNSIGNED_SHORT ? sizeof(unsigned short) : sizeof(unsigned int);
+            glDrawElementsInstanced(this->primitive,level.index_count,this->ebo_index_type,
+                                    (const void*)(level.first_index * index_bytes),counts[lod]);
+        }
+        draws++;
+    }
+    return draws;
+}
+
+void BasicShape::attachInstanceBuffer ()
+{
+    glGenBuffers(1,&(this->instance_vbo));
+    //The divisors and enables are vertex array state, so they are set once like the
+    //  shape's other attributes; only the offsets change between draws
+    GLState::BindVertexArray(this->vao.id);
+    for (int location = INSTANCE_ATTRIBUTE_LOCATION; location < INSTANCE_ATTRIBUTE_LOCATION + 5; location++) {
+        glVertexAttribDivisor(location,1);
+        glEnableVertexAttribArray(location);
+    }
+    this->instance_attribute_first = -1;
+}
+
+void BasicShape::pointInstanceAttributes (int first_instance)
+{
+    //Assumes the shape's vertex array and the instance buffer are bound.  Orphaning the
+    //  buffer keeps its name, so pointers set by an earlier draw still read the new data.
+    if (first_instance == this->instance_attribute_first) {
+        return;
+    }
+    size_t base = first_instance * sizeof(InstanceData);
+    for (int column = 0; column < 4; column++) {
+        glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + column,4,GL_FLOAT,GL_FALSE,sizeof(InstanceData),
+                              (void*)(intptr_t)(base + offsetof(InstanceData, transform) + column * sizeof(glm::vec4)));
+    }
+    glVertexAttribPointer(INSTANCE_ATTRIBUTE_LOCATION + 4,4,GL_FLOAT,GL_FALSE,sizeof(InstanceData),
+                          (void*)(intptr_t)(base + offsetof(InstanceData, tint)));
+    this->instance_attribute_first = first_instance;
+}
+
+int BasicShape::LODCount()
+{
+    return std::max(1, (int)this->lods.size());
+}
+
+int BasicShape::TriangleCount(int lod)
+{
+    if (this->primitive != GL_TRIANGLES) {
+        return 0;
+    }
+    if (!this->draw_indexed) {
+        return this->number_vertices / 3;
+    }
+    if (this->lods.empty()) {
+        return this->ebo_number_indices / 3;
+    }
+    return this->lods[std::max(0, std::min(lod, (int)this->lods.size() - 1))].index_count / 3;
+}
+
+const VAOStruct& BasicShape::GetVAOStruct()
+{
+    return this->vao;
+}
+
+GLuint BasicShape::GetPrimitive()
+{
+    return this->primitive;
+}
+
+int BasicShape::VertexCount()
+{
+    return this->number_vertices;
+}
+
+const std::vector<ShapeLOD>& BasicShape::GetLODs()
+{
+    return this->lods;
+}
+
+//Copies a buffer's contents through the copy read binding (which no vertex array keeps)
+static void readBuffer(unsigned int buffer, std::vector<unsigned char> &data)
+{
+    GLint size = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER,buffer);
+    glGetBufferParameteriv(GL_COPY_READ_BUFFER,GL_BUFFER_SIZE,&size);
+    data.resize(size);
+    if (size > 0) {
+        glGetBufferSubData(GL_COPY_READ_BUFFER,0,size,data.data());
+    }
+}
+
+bool BasicShape::ReadGeometry(std::vector<unsigned char> &vertices, std::vector<unsigned int> &indices)
+{
+    indices.clear();
+    if (this->draw_indexed && this->primitive != GL_TRIANGLES) {
+        return false;
+    }
+    if (this->draw_indexed) {
+        std::vector<unsigned char> index_data;
+        readBuffer(this->ebo,index_data);
+        if (this->ebo_index_type == GL_UNSIGNED_SHORT) {
+            const unsigned short *shorts = reinterpret_cast<const unsigned short*>(index_data.data());
+            indices.assign(shorts, shorts + index_data.size() / sizeof(unsigned short));
+        } else {
+            const unsigned int *ints = reinterpret_cast<const unsigned int*>(index_data.data());
+            indices.assign(ints, ints + index_data.size() / sizeof(unsigned int));
+        }
+    } else if (this->primitive == GL_TRIANGLES) {
+        for (int i = 0; i < this->number_vertices; i++) {
+            indices.push_back(i);
+        }
+    } else if (this->primitive == GL_TRIANGLE_FAN) {
+        for (int i = 1; i + 1 < this->number_vertices; i++) {
+            indices.push_back(0);
+            indices.push_back(i);
+            indices.push_back(i + 1);
+        }
+    } else {
+        return false;
+    }
+    readBuffer(this->vbo,vertices);
+    return true;
+}
+
+void BasicShape::ReadMaterialTable(std::vector<unsigned char> &table)
+{
+    table.clear();
+    if (this->material_ubo > 0) {
+        readBuffer(this->material_ubo,table);
+    }
+}
+
 void BasicShape::DeallocateShape()
 {
-    glDeleteBuffers(1,&(this->vbo));
+    //The identifiers are cleared so deallocating twice is harmless
+    if (this->vbo > 0)
+        glDeleteBuffers(1,&(this->vbo));
     if (this->ebo > 0)
         glDeleteBuffers(1,&(this->ebo));
+    if (this->material_ubo > 0)
+        glDeleteBuffers(1,&(this->material_ubo));
+    if (this->instance_vbo > 0)
+        glDeleteBuffers(1,&(this->instance_vbo));
+    if (this->vao.id > 0)
+        GLState::DeleteVertexArrays(1,&(this->vao.id));
+    this->vao.id = 0;
+    this->vbo = 0;
+    this->ebo = 0;
+    this->material_ubo = 0;
+    this->instance_vbo = 0;
+    this->instance_capacity = 0;
+    this->instance_attribute_first = -1;
+    this->number_vertices = 0;
+    this->ebo_number_indices = 0;
+    this->buffer_bytes = 0;
+    this->lods.clear();
+}
+
+BoundingBox BasicShape::GetBounds() {
+    return this->bounds;
+}
+
+BoundingSphere BasicShape::GetBoundingSphere() {
+    return this->bounding_sphere;
+}
+
+BoundingBox BasicShape::GetWorldBounds(const glm::mat4 &transform) {
+    return TransformBox(this->bounds, transform);
+}
+
+BoundingSphere BasicShape::GetWorldSphere(const glm::mat4 &transform) {
+    return TransformSphere(this->bounding_sphere, transform);
+}
+
+void BasicShape::SetCastsShadows(bool casts_shadows) {
+    this->casts_shadows = casts_shadows;
+}
+
+bool BasicShape::CastsShadows() {
+    return this->casts_shadows;
 }
 
 unsigned int BasicShape::GetVBO() {
     return this->vbo;
+}
+
+int BasicShape::GetBufferBytes() {
+    return this->buffer_bytes;
 }
\ No newline at end of file
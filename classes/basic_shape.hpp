@@ -1,18 +1,88 @@
 #ifndef BASIC_SHAPE_HPP
 #define BASIC_SHAPE_HPP
 
+#include <vector>
 #include "vertex_attribute.hpp"
 #include "Shader.hpp"
+#include "bounding_volume.hpp"
+
+//One level of detail of a shape: a range of its index buffer
+struct ShapeLOD {
+    int first_index = 0;
+    int index_count = 0;
+    //Largest distance (in model units) the level's surface is from the full shape's
+    float error = 0.0f;
+};
+
+//Decides which level of detail shapes are drawn with from one viewpoint, and counts
+// the triangles drawn through it
+struct LODView {
+    glm::vec3 camera_position = glm::vec3(0.0f);
+    //Pixels covered by one unit at a distance of one unit: viewport height / (2 tan(fov / 2))
+    float pixels_per_unit = 1.0f;
+    //Largest error (in pixels) a level may show on screen
+    float max_pixel_error = 1.0f;
+    //When false, every shape is drawn at full detail
+    bool enabled = true;
+    //Triangles drawn, and how many the shapes have at full detail
+    long long triangles = 0;
+    long long full_triangles = 0;
+};
+
+//Per-instance data of an instanced draw (see BasicShape::DrawInstanced)
+struct InstanceData {
+    //Product of the instance's model and local matrices
+    glm::mat4 transform = glm::mat4(1.0);
+    //Material override: multiplies the ambient and diffuse colors of the instance's
+    //  materials (imported models only)
+    glm::vec4 tint = glm::vec4(1.0);
+};
+
+//First attribute location of the instance data: the transform takes four locations (one
+//  per column) and the tint the one after them
+const int INSTANCE_ATTRIBUTE_LOCATION = 4;
 
 class BasicShape {
     protected:
+        //Vertex layout of the shape; vao.id is the shape's own vertex array, which Initialize
+        //  configures once so drawing only has to bind it
         VAOStruct vao;
         unsigned int vbo = 0;
         int number_vertices = 0;
         GLuint primitive = GL_TRIANGLES;
-        unsigned int ebo;
-        int ebo_number_indices;
-        int ebo_primitive;
+        unsigned int ebo = 0;
+        int ebo_number_indices = 0;
+        int ebo_primitive = GL_LINE_LOOP;
+        GLenum ebo_index_type = GL_UNSIGNED_INT;
+        //True when Draw() should render the EBO (glDrawElements) instead of the raw vertices
+        bool draw_indexed = false;
+        //Uniform buffer with the shape's material table (0 if it has none)
+        unsigned int material_ubo = 0;
+        //Total size of the shape's buffers
+        int buffer_bytes = 0;
+        //Levels of detail, starting with the full shape (empty when the EBO holds a single level)
+        std::vector<ShapeLOD> lods;
+        //Model space bounds of the vertices (computed by Initialize)
+        BoundingBox bounds;
+        BoundingSphere bounding_sphere;
+        //False for shapes that are never drawn into the shadow map
+        bool casts_shadows = true;
+        //Buffer holding the instance data of instanced draws (created by the first one) and
+        //  the number of instances it has room for
+        unsigned int instance_vbo = 0;
+        int instance_capacity = 0;
+        //Instance the instance attributes currently start at (-1 until they are pointed)
+        int instance_attribute_first = -1;
+        //Instance data of a DrawInstanced call, grouped by level of detail
+        std::vector<InstanceData> instance_order;
+
+        //Creates the instance buffer and enables the instance attributes of the shape's vertex
+        //  array (with a divisor of 1), once per shape
+        void attachInstanceBuffer();
+        //Points the instance attributes of the shape's vertex array at the instance buffer,
+        //  starting first_instance instances into it (OpenGL 3.3 has no base instance).  Does
+        //  nothing if they already start there.
+        void pointInstanceAttributes(int first_instance);
     
     public:
         //Constructor for a BasicShape object (no inputs)
@@ -20,26 +90,101 @@ class BasicShape {
 
         //Initializes a BasicShape object given a VAOStruct, a pointer to vertex data, and integer for the number
         //of bytes in the data, an int for the number of vertices, and an int for the primitive used (default is GL_TRIANGLES) 
-        void Initialize(VAOStruct vao, float* vertices, int vertices_bytes, int num_vertices, GLuint prim = GL_TRIANGLES);
+        //Every vertex must start with its position (three floats), which is used to compute the shape's bounds.
+        void Initialize(VAOStruct vao, const float* vertices, int vertices_bytes, int num_vertices, GLuint prim = GL_TRIANGLES);
         
-        //Initializes a BasicShape's EBO given a pointer to EBO data as an unsigned int array, an int representing the number of 
-        //  bytes in the EBO, an int representing the number of indices, and an int for the primitive used (default is line loop)
-        void InitializeEBO(unsigned int *ebo_data, int ebo_bytes, int num_indices, int primitive=GL_LINE_LOOP);
+        //Initializes a BasicShape's EBO given a pointer to EBO data, an int representing the number of 
+        //  bytes in the EBO, an int representing the number of indices, an int for the primitive used (default is line loop),
+        //  and the type of the indices (GL_UNSIGNED_INT by default, or GL_UNSIGNED_SHORT)
+        void InitializeEBO(const void *ebo_data, int ebo_bytes, int num_indices, int primitive=GL_LINE_LOOP,
+                           GLenum index_type=GL_UNSIGNED_INT);
+
+        //Initializes the EBO as the shape's index buffer: afterwards Draw() uses glDrawElements with the
+        //  shape's own primitive.  Takes the same index data, byte count, index count, and index type as InitializeEBO.
+        void InitializeIndices(const void *index_data, int index_bytes, int num_indices, GLenum index_type=GL_UNSIGNED_INT);
+
+        //Splits the index buffer into levels of detail (level 0 is the full shape, later levels must
+        //  not have a smaller error).  Draw() only draws level 0.
+        void InitializeLODs(const std::vector<ShapeLOD> &levels);
+
+        //Initializes a uniform buffer holding the shape's material table given a pointer to the table
+        //  and its size in bytes.  Draw() binds it to MATERIAL_TABLE_BINDING.
+        void InitializeMaterialTable(const void *table_data, int table_bytes);
+
+        //Replaces part of the material table (starting offset_bytes into it) with the given data, so
+        //  materials can change at runtime without touching the vertices
+        void UpdateMaterialTable(const void *table_data, int offset_bytes, int table_bytes);
         
         //Draws the shape using a given shader program.
-        void Draw (Shader shader);
+        void Draw (Shader &shader);
 
         //Draws a shape without first setting a shader program (assumes a shader program
         // is already in use).
         void Draw ();
 
+        //Draws one level of detail (without first setting a shader program)
+        void DrawLOD(int lod);
+
+        //Draws the coarsest level of detail whose error stays within view.max_pixel_error when
+        //  the shape is drawn with the given transform (the product of the model and local matrices),
+        //  and adds the triangles to the view's counters
+        void Draw (const glm::mat4 &transform, LODView &view);
+
+        //Draws every instance with one glDrawElementsInstanced/glDrawArraysInstanced call per
+        //  level of detail used (each instance gets the level Draw(transform, view) would pick),
+        //  and adds the triangles to the view's counters.  The program must read its transform
+        //  from the instance attributes.  Returns the number of draw calls.
+        int DrawInstanced(const std::vector<InstanceData> &instances, LODView &view);
+
+        //Returns the level of detail Draw(transform, view) would use
+        int SelectLOD(const glm::mat4 &transform, const LODView &view);
+
+        //Returns the number of levels of detail (1 when the shape has no others)
+        int LODCount();
+
+        //Returns the number of triangles of a level of detail
+        int TriangleCount(int lod=0);
+
         //Draws an EBO with a float input representing the desired line_width (default is 1.0)
         void DrawEBO(float line_width=1.0);
 
+        //Returns the model space bounding box and bounding sphere of the shape
+        BoundingBox GetBounds();
+        BoundingSphere GetBoundingSphere();
+
+        //Returns the bounds of the shape once it is drawn with the given transform (the product
+        //  of the model and local matrices)
+        BoundingBox GetWorldBounds(const glm::mat4 &transform);
+        BoundingSphere GetWorldSphere(const glm::mat4 &transform);
+
+        //Sets whether the shape is drawn into the shadow map (shapes that nothing lies under,
+        //  such as the floor, can not shadow anything)
+        void SetCastsShadows(bool casts_shadows);
+        bool CastsShadows();
+
+        //Returns the vertex layout of the shape, its primitive, and its number of vertices
+        const VAOStruct& GetVAOStruct();
+        GLuint GetPrimitive();
+        int VertexCount();
+
+        //Returns the levels of detail (empty when the shape has a single level)
+        const std::vector<ShapeLOD>& GetLODs();
+
+        //Reads the vertices and the triangles Draw() renders back from the GPU.  The indices are
+        //  converted to unsigned ints; shapes without an index buffer get indices for their
+        //  triangles (GL_TRIANGLES) or triangle fan.  Returns false for other primitives.
+        bool ReadGeometry(std::vector<unsigned char> &vertices, std::vector<unsigned int> &indices);
+
+        //Reads the material table back from the GPU (empty when the shape has none)
+        void ReadMaterialTable(std::vector<unsigned char> &table);
+
         //Returns the identifier (unsigned int) of a VBO for the shape.
         unsigned int GetVBO ();
 
-        //Deletes the shape data
+        //Returns the number of bytes in the shape's buffers (vertices, indices, and material table)
+        int GetBufferBytes ();
+
+        //Deletes the shape data (copies of the shape must not be drawn or deallocated afterwards)
         void DeallocateShape();
 };
 
@@ -0,0 +1,103 @@
+#include "bounding_volume.hpp"
+
+#include <algorithm>
+#include <string.h>
+#include <cmath>
+
+void ComputeBounds(const void *vertices, int vertex_count, int stride_bytes,
+                   BoundingBox &box, BoundingSphere &sphere) {
+    box = BoundingBox();
+    sphere = BoundingSphere();
+    if (vertices == NULL || vertex_count <= 0) {
+        return;
+    }
+    // Positions are copied out, since packed vertex layouts may not keep them aligned
+    const char *data = static_cast<const char*>(vertices);
+    auto position = [data, stride_bytes](int i) {
+        glm::vec3 p;
+        memcpy(&p, data + (size_t)i * stride_bytes, sizeof(glm::vec3));
+        return p;
+    };
+    box.min = box.max = position(0);
+    for (int i = 1; i < vertex_count; i++) {
+        glm::vec3 p = position(i);
+        box.min = glm::min(box.min, p);
+        box.max = glm::max(box.max, p);
+    }
+    // A sphere around the box's center that reaches the farthest vertex is never
+    // larger than the box's own bounding sphere
+    sphere.center = box.Center();
+    float radius_squared = 0.0f;
+    for (int i = 0; i < vertex_count; i++) {
+        glm::vec3 offset = position(i) - sphere.center;
+        radius_squared = std::max(radius_squared, glm::dot(offset, offset));
+    }
+    sphere.radius = std::sqrt(radius_squared);
+}
+
+float MaxScale(const glm::mat4 &transform) {
+    return std::max(glm::length(glm::vec3(transform[0])),
+                    std::max(glm::length(glm::vec3(transform[1])), glm::length(glm::vec3(transform[2]))));
+}
+
+BoundingBox TransformBox(const BoundingBox &box, const glm::mat4 &transform) {
+    // Each axis of the new box is reached by the corner that moves farthest along it
+    // (Arvo, "Transforming Axis-Aligned Bounding Boxes", Graphics Gems 1990)
+    glm::vec3 center = glm::vec3(transform * glm::vec4(box.Center(), 1.0f));
+    glm::vec3 extents = box.Extents();
+    glm::vec3 new_extents(0.0f);
+    for (int column = 0; column < 3; column++) {
+        new_extents += glm::abs(glm::vec3(transform[column])) * extents[column];
+    }
+    BoundingBox result;
+    result.min = center - new_extents;
+    result.max = center + new_extents;
+    return result;
+}
+
+BoundingSphere TransformSphere(const BoundingSphere &sphere, const glm::mat4 &transform) {
+    BoundingSphere result;
+    result.center = glm::vec3(transform * glm::vec4(sphere.center, 1.0f));
+    result.radius = sphere.radius * MaxScale(transform);
+    return result;
+}
+
+Frustum::Frustum(const glm::mat4 &view_projection) {
+    // Row i of the matrix is (m[0][i], m[1][i], m[2][i], m[3][i]) since GLM is column-major
+    glm::vec4 rows[4];
+    for (int i = 0; i < 4; i++) {
+        rows[i] = glm::vec4(view_projection[0][i], view_projection[1][i], view_projection[2][i], view_projection[3][i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        this->planes[i * 2] = rows[3] + rows[i];
+        this->planes[i * 2 + 1] = rows[3] - rows[i];
+    }
+    for (glm::vec4 &plane : this->planes) {
+        float length = glm::length(glm::vec3(plane));
+        if (length > 0.0f) {
+            plane = plane / length;
+        }
+    }
+}
+
+bool Frustum::Intersects(const BoundingBox &box) const {
+    // Test the corner of the box that is farthest along each plane's normal
+    for (const glm::vec4 &plane : this->planes) {
+        glm::vec3 corner(plane.x >= 0.0f ? box.max.x : box.min.x,
+                         plane.y >= 0.0f ? box.max.y : box.min.y,
+                         plane.z >= 0.0f ? box.max.z : box.min.z);
+        if (glm::dot(glm::vec3(plane), corner) + plane.w < 0.0f) {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool Frustum::Intersects(const BoundingSphere &sphere) const {
+    for (const glm::vec4 &plane : this->planes) {
+        if (glm::dot(glm::vec3(plane), sphere.center) + plane.w < -sphere.radius) {
+            return false;
+        }
+    }
+    return true;
+}
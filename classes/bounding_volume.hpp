@@ -0,0 +1,50 @@
+#ifndef BOUNDING_VOLUME_HPP
+#define BOUNDING_VOLUME_HPP
+
+#include <glm/glm.hpp>
+
+//Axis-aligned bounding box
+struct BoundingBox {
+    glm::vec3 min = glm::vec3(0.0f);
+    glm::vec3 max = glm::vec3(0.0f);
+
+    glm::vec3 Center() const { return (this->min + this->max) * 0.5f; }
+    //Half the size of the box along each axis
+    glm::vec3 Extents() const { return (this->max - this->min) * 0.5f; }
+};
+
+struct BoundingSphere {
+    glm::vec3 center = glm::vec3(0.0f);
+    float radius = 0.0f;
+};
+
+//The six planes (left, right, bottom, top, near, far) of a view volume.  Each plane is
+// (normal, distance) with the normal pointing into the volume.
+struct Frustum {
+    glm::vec4 planes[6];
+
+    //Extracts the planes of the volume a projection * view matrix maps to clip space
+    // (Gribb and Hartmann, "Fast Extraction of Viewing Frustum Planes", 2001)
+    explicit Frustum(const glm::mat4 &view_projection = glm::mat4(1.0f));
+
+    //Returns false only if the bounds are entirely outside one of the planes
+    bool Intersects(const BoundingBox &box) const;
+    bool Intersects(const BoundingSphere &sphere) const;
+};
+
+//Computes the bounding box and a bounding sphere (centered on the box) of vertex_count
+// vertices that are stride_bytes apart and start with their position (three floats)
+void ComputeBounds(const void *vertices, int vertex_count, int stride_bytes,
+                   BoundingBox &box, BoundingSphere &sphere);
+
+//Returns the largest factor the matrix scales any direction by
+float MaxScale(const glm::mat4 &transform);
+
+//Returns the axis-aligned box that holds a box after it is transformed (for example by the
+// model * local matrices of a shape)
+BoundingBox TransformBox(const BoundingBox &box, const glm::mat4 &transform);
+
+//Returns a sphere that holds a sphere after it is transformed
+BoundingSphere TransformSphere(const BoundingSphere &sphere, const glm::mat4 &transform);
+
+#endif //BOUNDING_VOLUME_HPP
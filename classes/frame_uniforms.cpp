@@ -0,0 +1,51 @@
+#include "frame_uniforms.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+
+FrameUniforms::FrameUniforms() {}
+
+void FrameUniforms::Initialize() {
+    glGenBuffers(1, &(this->camera_ubo));
+    glBindBuffer(GL_UNIFORM_BUFFER, this->camera_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), &this->camera, GL_DYNAMIC_DRAW);
+
+    glGenBuffers(1, &(this->lighting_ubo));
+    glBindBuffer(GL_UNIFORM_BUFFER, this->lighting_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightingBlock), &this->lighting, GL_DYNAMIC_DRAW);
+
+    // The screen camera never changes: positions are already in normalized device coordinates
+    CameraBlock screen_camera;
+    screen_camera.projection = glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f);
+    glGenBuffers(1, &(this->screen_camera_ubo));
+    glBindBuffer(GL_UNIFORM_BUFFER, this->screen_camera_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), &screen_camera, GL_STATIC_DRAW);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, this->camera_ubo);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTING_BLOCK_BINDING, this->lighting_ubo);
+    glBindBufferBase(GL_UNIFORM_BUFFER, SCREEN_CAMERA_BINDING, this->screen_camera_ubo);
+}
+
+void FrameUniforms::Upload() {
+    // Orphaning the storage first lets the driver hand out fresh memory instead of waiting
+    // for the previous frame's draws to finish reading the buffer
+    glBindBuffer(GL_UNIFORM_BUFFER, this->camera_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(CameraBlock), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(CameraBlock), &this->camera);
+    glBindBuffer(GL_UNIFORM_BUFFER, this->lighting_ubo);
+    glBufferData(GL_UNIFORM_BUFFER, sizeof(LightingBlock), NULL, GL_DYNAMIC_DRAW);
+    glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(LightingBlock), &this->lighting);
+
+    glBindBufferBase(GL_UNIFORM_BUFFER, CAMERA_BLOCK_BINDING, this->camera_ubo);
+    glBindBufferBase(GL_UNIFORM_BUFFER, LIGHTING_BLOCK_BINDING, this->lighting_ubo);
+}
+
+void FrameUniforms::DeallocateBuffers() {
+    unsigned int buffers[] = {this->camera_ubo, this->lighting_ubo, this->screen_camera_ubo};
+    for (unsigned int buffer : buffers) {
+        if (buffer > 0) {
+            glDeleteBuffers(1, &buffer);
+        }
+    }
+    this->camera_ubo = 0;
+    this->lighting_ubo = 0;
+    this->screen_camera_ubo = 0;
+}
@@ -0,0 +1,86 @@
+#ifndef FRAME_UNIFORMS_HPP
+#define FRAME_UNIFORMS_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <cstdint>
+
+#include "Shader.hpp"
+
+//Layout (std140) of the FrameCamera block declared by the shaders in shaders/
+struct CameraBlock {
+    glm::mat4 projection = glm::mat4(1.0f);
+    glm::mat4 view = glm::mat4(1.0f);
+    //lightProjection * lightView of the shadow map
+    glm::mat4 light_space_matrix = glm::mat4(1.0f);
+    glm::vec4 view_position = glm::vec4(0.0f);
+};
+
+//Layout (std140) of the DirectionalLight struct in fragment.glsl
+struct DirectionalLightBlock {
+    glm::vec4 direction = glm::vec4(0.0f);
+    glm::vec4 ambient = glm::vec4(0.0f);
+    glm::vec4 diffuse = glm::vec4(0.0f);
+    glm::vec4 specular = glm::vec4(0.0f);
+    //A GLSL bool is four bytes in a uniform block
+    int32_t on = 0;
+    int32_t padding[3] = {0, 0, 0};
+};
+
+//Layout (std140) of the SpotLight struct in fragment.glsl
+struct SpotLightBlock {
+    glm::vec4 position = glm::vec4(0.0f);
+    glm::vec4 direction = glm::vec4(0.0f);
+    glm::vec4 ambient = glm::vec4(0.0f);
+    glm::vec4 diffuse = glm::vec4(0.0f);
+    glm::vec4 specular = glm::vec4(0.0f);
+    //Cosines of the inner and outer cutoff angles
+    float cut_off = 0.0f;
+    float outer_cut_off = 0.0f;
+    //Attenuation terms
+    float constant = 0.0f;
+    float linear = 0.0f;
+    float quadratic = 0.0f;
+    int32_t on = 0;
+    int32_t padding[2] = {0, 0};
+};
+
+//Layout (std140) of the FrameLighting block in fragment.glsl
+struct LightingBlock {
+    DirectionalLightBlock directional_light;
+    SpotLightBlock spot_light;
+};
+
+static_assert(sizeof(CameraBlock) == 208, "CameraBlock must match the std140 FrameCamera block");
+static_assert(sizeof(LightingBlock) == 192, "LightingBlock must match the std140 FrameLighting block");
+
+//FrameUniforms owns the uniform buffers behind the FrameCamera and FrameLighting blocks.
+// The values are filled in on the CPU and uploaded once per frame, and every program
+// reads them from the same binding points (see CAMERA_BLOCK_BINDING in Shader.hpp)
+// instead of receiving them as separate uniforms.  A third, constant camera block maps
+// positions straight to the screen for the HUD (SCREEN_CAMERA_BINDING).
+class FrameUniforms {
+    public:
+        //Values copied to the buffers by the next Upload
+        CameraBlock camera;
+        LightingBlock lighting;
+
+        //Constructor for FrameUniforms (the buffers are created by Initialize)
+        FrameUniforms();
+
+        //Creates the buffers and binds them to their binding points (needs a GL context)
+        void Initialize();
+
+        //Copies camera and lighting into their buffers and binds them (once per frame)
+        void Upload();
+
+        //Deletes the buffers
+        void DeallocateBuffers();
+
+    private:
+        unsigned int camera_ubo = 0;
+        unsigned int lighting_ubo = 0;
+        unsigned int screen_camera_ubo = 0;
+};
+
+#endif //FRAME_UNIFORMS_HPP
@@ -0,0 +1,187 @@
+#include "gl_state.hpp"
+
+unsigned int GLState::program = 0;
+unsigned int GLState::vertex_array = 0;
+int GLState::active_unit = 0;
+unsigned int GLState::textures[GL_STATE_TEXTURE_UNITS][3] = {{0}};
+unsigned int GLState::framebuffer = 0;
+bool GLState::capabilities[3] = {false, false, false};
+GLenum GLState::depth_function = GL_LESS;
+GLenum GLState::blend_source = GL_ONE;
+GLenum GLState::blend_destination = GL_ZERO;
+int GLState::viewport[4] = {0, 0, -1, -1};
+float GLState::line_width = 1.0f;
+GLStateStats GLState::frame_stats;
+
+int GLState::targetIndex(GLenum target) {
+    switch (target) {
+        case GL_TEXTURE_2D: return 0;
+        case GL_TEXTURE_2D_ARRAY: return 1;
+        case GL_TEXTURE_CUBE_MAP: return 2;
+    }
+    return -1;
+}
+
+int GLState::capabilityIndex(GLenum capability) {
+    switch (capability) {
+        case GL_DEPTH_TEST: return 0;
+        case GL_BLEND: return 1;
+        case GL_CULL_FACE: return 2;
+    }
+    return -1;
+}
+
+bool GLState::changed(bool differs) {
+    if (differs) {
+        frame_stats.issued++;
+    } else {
+        frame_stats.elided++;
+    }
+    return differs;
+}
+
+void GLState::UseProgram(unsigned int program) {
+    if (changed(GLState::program != program)) {
+        glUseProgram(program);
+        GLState::program = program;
+    }
+}
+
+void GLState::BindVertexArray(unsigned int vertex_array) {
+    if (changed(GLState::vertex_array != vertex_array)) {
+        glBindVertexArray(vertex_array);
+        GLState::vertex_array = vertex_array;
+    }
+}
+
+void GLState::ActiveTexture(GLenum unit) {
+    int index = (int)(unit - GL_TEXTURE0);
+    if (changed(active_unit != index)) {
+        glActiveTexture(unit);
+        active_unit = index;
+    }
+}
+
+void GLState::BindTexture(GLenum target, unsigned int texture) {
+    int index = targetIndex(target);
+    if (index < 0 || active_unit < 0 || active_unit >= GL_STATE_TEXTURE_UNITS) {
+        changed(true);
+        glBindTexture(target, texture);
+        return;
+    }
+    if (changed(textures[active_unit][index] != texture)) {
+        glBindTexture(target, texture);
+        textures[active_unit][index] = texture;
+    }
+}
+
+void GLState::BindFramebuffer(GLenum target, unsigned int framebuffer) {
+    if (target != GL_FRAMEBUFFER) {
+        changed(true);
+        glBindFramebuffer(target, framebuffer);
+        return;
+    }
+    if (changed(GLState::framebuffer != framebuffer)) {
+        glBindFramebuffer(target, framebuffer);
+        GLState::framebuffer = framebuffer;
+    }
+}
+
+void GLState::Enable(GLenum capability) {
+    int index = capabilityIndex(capability);
+    if (changed(index < 0 || !capabilities[index])) {
+        glEnable(capability);
+        if (index >= 0) {
+            capabilities[index] = true;
+        }
+    }
+}
+
+void GLState::Disable(GLenum capability) {
+    int index = capabilityIndex(capability);
+    if (changed(index < 0 || capabilities[index])) {
+        glDisable(capability);
+        if (index >= 0) {
+            capabilities[index] = false;
+        }
+    }
+}
+
+bool GLState::IsEnabled(GLenum capability) {
+    int index = capabilityIndex(capability);
+    if (index < 0) {
+        return glIsEnabled(capability) == GL_TRUE;
+    }
+    frame_stats.queries++;
+    return capabilities[index];
+}
+
+void GLState::DepthFunc(GLenum function) {
+    if (changed(depth_function != function)) {
+        glDepthFunc(function);
+        depth_function = function;
+    }
+}
+
+GLenum GLState::GetDepthFunc() {
+    frame_stats.queries++;
+    return depth_function;
+}
+
+void GLState::BlendFunc(GLenum source, GLenum destination) {
+    if (changed(blend_source != source || blend_destination != destination)) {
+        glBlendFunc(source, destination);
+        blend_source = source;
+        blend_destination = destination;
+    }
+}
+
+void GLState::Viewport(int x, int y, int width, int height) {
+    if (changed(viewport[0] != x || viewport[1] != y || viewport[2] != width || viewport[3] != height)) {
+        glViewport(x, y, width, height);
+        viewport[0] = x;
+        viewport[1] = y;
+        viewport[2] = width;
+        viewport[3] = height;
+    }
+}
+
+void GLState::LineWidth(float width) {
+    if (changed(line_width != width)) {
+        glLineWidth(width);
+        line_width = width;
+    }
+}
+
+void GLState::DeleteTextures(int count, const unsigned int *textures) {
+    for (int i = 0; i < count; i++) {
+        if (textures[i] == 0) {
+            continue;
+        }
+        for (int unit = 0; unit < GL_STATE_TEXTURE_UNITS; unit++) {
+            for (int target = 0; target < 3; target++) {
+                if (GLState::textures[unit][target] == textures[i]) {
+                    GLState::textures[unit][target] = 0;
+                }
+            }
+        }
+    }
+    glDeleteTextures(count, textures);
+}
+
+void GLState::DeleteVertexArrays(int count, const unsigned int *vertex_arrays) {
+    for (int i = 0; i < count; i++) {
+        if (vertex_arrays[i] != 0 && vertex_arrays[i] == vertex_array) {
+            vertex_array = 0;
+        }
+    }
+    glDeleteVertexArrays(count, vertex_arrays);
+}
+
+GLStateStats GLState::GetFrameStats() {
+    return frame_stats;
+}
+
+void GLState::ResetFrameStats() {
+    frame_stats = GLStateStats();
+}
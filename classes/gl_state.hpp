@@ -0,0 +1,82 @@
+#ifndef GL_STATE_HPP
+#define GL_STATE_HPP
+
+#include <glad/glad.h>
+
+//Number of texture units whose bindings GLState keeps track of
+const int GL_STATE_TEXTURE_UNITS = 16;
+
+//Calls made through GLState since the last ResetFrameStats
+struct GLStateStats {
+    //State changes passed on to OpenGL
+    int issued = 0;
+    //State changes dropped because the state was already set
+    int elided = 0;
+    //State queries answered from the shadowed state instead of glGet
+    int queries = 0;
+};
+
+//GLState shadows the OpenGL state the renderer changes (program, vertex array, texture
+// bindings, framebuffer, capabilities, depth and blend functions, viewport, line width).
+// A change that matches the shadowed value is dropped, and queries are answered without
+// asking the driver.  Every change of this state must go through GLState, and objects
+// must be deleted through it, so the shadowed values stay in step with the context.  The
+// shadowed values start at OpenGL's defaults for a new context.
+class GLState {
+    public:
+        static void UseProgram(unsigned int program);
+        static void BindVertexArray(unsigned int vertex_array);
+        //unit is GL_TEXTURE0 + n, as for glActiveTexture
+        static void ActiveTexture(GLenum unit);
+        //Binds to the active unit.  Targets other than GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY, and
+        // GL_TEXTURE_CUBE_MAP are always passed on.
+        static void BindTexture(GLenum target, unsigned int texture);
+        //Only GL_FRAMEBUFFER is shadowed; other targets are always passed on
+        static void BindFramebuffer(GLenum target, unsigned int framebuffer);
+
+        //GL_DEPTH_TEST, GL_BLEND, and GL_CULL_FACE are shadowed; other capabilities are
+        // always passed on (and IsEnabled asks the driver for them)
+        static void Enable(GLenum capability);
+        static void Disable(GLenum capability);
+        static bool IsEnabled(GLenum capability);
+
+        static void DepthFunc(GLenum function);
+        static GLenum GetDepthFunc();
+        static void BlendFunc(GLenum source, GLenum destination);
+        static void Viewport(int x, int y, int width, int height);
+        static void LineWidth(float width);
+
+        //Delete the objects and clear the bindings that named them, since OpenGL unbinds
+        // deleted objects and may hand their names out again
+        static void DeleteTextures(int count, const unsigned int *textures);
+        static void DeleteVertexArrays(int count, const unsigned int *vertex_arrays);
+
+        //Returns the calls made since the last reset (the render loop resets them every frame)
+        static GLStateStats GetFrameStats();
+        static void ResetFrameStats();
+
+    private:
+        //Position of a shadowed texture target in the bindings, or -1
+        static int targetIndex(GLenum target);
+        //Position of a shadowed capability in the capabilities, or -1
+        static int capabilityIndex(GLenum capability);
+        //Counts a change and reports whether it has to be issued
+        static bool changed(bool differs);
+
+        static unsigned int program;
+        static unsigned int vertex_array;
+        static int active_unit;
+        static unsigned int textures[GL_STATE_TEXTURE_UNITS][3];
+        static unsigned int framebuffer;
+        static bool capabilities[3];
+        static GLenum depth_function;
+        static GLenum blend_source;
+        static GLenum blend_destination;
+        //The viewport is unknown (width -1) until it is first set
+        static int viewport[4];
+        static float line_width;
+
+        static GLStateStats frame_stats;
+};
+
+#endif //GL_STATE_HPP
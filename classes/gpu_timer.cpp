@@ -0,0 +1,64 @@
+#include "gpu_timer.hpp"
+
+GpuTimer::GpuTimer() {
+    for (int i = 0; i < GPU_TIMER_QUERIES; i++) {
+        this->queries[i] = 0;
+        this->pending[i] = false;
+    }
+}
+
+void GpuTimer::Begin() {
+    if (!this->initialized) {
+        glGenQueries(GPU_TIMER_QUERIES, this->queries);
+        this->initialized = true;
+    }
+    // Read the results the GPU has finished before a query is reused
+    this->Milliseconds();
+    if (this->pending[this->next]) {
+        // The oldest measurement is still running; wait for it rather than lose it
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(this->queries[this->next], GL_QUERY_RESULT, &nanoseconds);
+        this->milliseconds = nanoseconds / 1.0e6f;
+        this->pending[this->next] = false;
+    }
+    glBeginQuery(GL_TIME_ELAPSED, this->queries[this->next]);
+}
+
+void GpuTimer::End() {
+    if (!this->initialized) {
+        return;
+    }
+    glEndQuery(GL_TIME_ELAPSED);
+    this->pending[this->next] = true;
+    this->next = (this->next + 1) % GPU_TIMER_QUERIES;
+}
+
+float GpuTimer::Milliseconds() {
+    // Queries finish in the order they were issued, so read from the oldest one
+    for (int i = 0; i < GPU_TIMER_QUERIES; i++) {
+        int query = (this->next + i) % GPU_TIMER_QUERIES;
+        if (!this->pending[query]) {
+            continue;
+        }
+        GLint available = 0;
+        glGetQueryObjectiv(this->queries[query], GL_QUERY_RESULT_AVAILABLE, &available);
+        if (!available) {
+            break;
+        }
+        GLuint64 nanoseconds = 0;
+        glGetQueryObjectui64v(this->queries[query], GL_QUERY_RESULT, &nanoseconds);
+        this->milliseconds = nanoseconds / 1.0e6f;
+        this->pending[query] = false;
+    }
+    return this->milliseconds;
+}
+
+void GpuTimer::DeallocateTimer() {
+    if (this->initialized) {
+        glDeleteQueries(GPU_TIMER_QUERIES, this->queries);
+        this->initialized = false;
+    }
+    for (int i = 0; i < GPU_TIMER_QUERIES; i++) {
+        this->pending[i] = false;
+    }
+}
@@ -0,0 +1,39 @@
+#ifndef GPU_TIMER_HPP
+#define GPU_TIMER_HPP
+
+#include <glad/glad.h>
+
+//Number of frames a GpuTimer can have in flight before it reuses a query
+const int GPU_TIMER_QUERIES = 4;
+
+//GpuTimer measures how long the GPU spends on the commands issued between Begin() and
+// End() with GL_TIME_ELAPSED queries.  Results are read a few frames later, once the GPU
+// has finished them, so measuring never stalls the pipeline.  Only one GpuTimer can be
+// measuring at a time.
+class GpuTimer {
+    public:
+        //Constructor for a GpuTimer (queries are created on the first Begin, once a GL context exists)
+        GpuTimer();
+
+        //Starts measuring the commands issued from now on
+        void Begin();
+        //Stops measuring; the time becomes available from Milliseconds() a few frames later
+        void End();
+
+        //Returns the most recent measurement that the GPU has finished (0 until there is one)
+        float Milliseconds();
+
+        //Deletes the queries
+        void DeallocateTimer();
+
+    private:
+        unsigned int queries[GPU_TIMER_QUERIES];
+        //Whether each query holds a measurement that has not been read yet
+        bool pending[GPU_TIMER_QUERIES];
+        //Query used by the next Begin
+        int next = 0;
+        bool initialized = false;
+        float milliseconds = 0.0f;
+};
+
+#endif //GPU_TIMER_HPP
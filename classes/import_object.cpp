@@ -1,104 +1,679 @@
 #include "import_object.hpp"
+#include "mapped_file.hpp"
+#include "mesh_cache.hpp"
 #include "../utilities/build_shapes.hpp"
+#include "../utilities/mesh_optimizer.hpp"
+#include "../utilities/mesh_simplifier.hpp"
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
 #include <iostream>
 #include <sstream>
-#include <fstream>
+#include <iomanip>
+#include <chrono>
+#include <algorithm>
 
 #include <glad/glad.h>
 #include <GLFW/glfw3.h>
 
 
+// Tokenizer helpers for the .OBJ/.MTL readers.  They walk a cursor through the
+// mapped file (which is not null terminated) and never allocate.
+static inline bool IsBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+static inline bool IsDigit(char c) {
+    return c >= '0' && c <= '9';
+}
+
+static inline const char* SkipBlanks(const char *p, const char *end) {
+    while (p < end && IsBlank(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static inline const char* TokenEnd(const char *p, const char *end) {
+    while (p < end && !IsBlank(*p)) {
+        p++;
+    }
+    return p;
+}
+
+static inline const char* LineEnd(const char *p, const char *end) {
+    const char *newline = static_cast<const char*>(memchr(p, '\n', end - p));
+    return newline ? newline : end;
+}
+
+static inline bool TokenIs(const char *begin, const char *end, const char *word) {
+    size_t length = strlen(word);
+    return (size_t)(end - begin) == length && memcmp(begin, word, length) == 0;
+}
+
+// Returns the remainder of the line (used for material names and texture paths)
+// without the trailing whitespace / carriage return.
+static std::string RestOfLine(const char *p, const char *line_end) {
+    p = SkipBlanks(p, line_end);
+    const char *last = line_end;
+    while (last > p && IsBlank(*(last - 1))) {
+        last--;
+    }
+    return std::string(p, last);
+}
+
+// Exact powers of ten (every value up to 1e22 is representable in a double)
+static const double kPowersOfTen[] = {
+    1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+
+// Parses a decimal float at the cursor and advances past it.  Numbers written the
+// way Blender exports them (at most 15 significant digits) are converted with one
+// exact integer-to-double conversion and one exact power of ten; anything else is
+// handed to strtof.  Leaves the cursor unchanged and returns 0 if there is no number.
+static float ParseFloat(const char *&p, const char *end) {
+    const char *start = p;
+    const char *c = p;
+    bool negative = false;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = (*c == '-');
+        c++;
+    }
+
+    uint64_t mantissa = 0;
+    int significant_digits = 0;
+    int exponent = 0;
+    bool any_digits = false;
+    while (c < end && IsDigit(*c)) {
+        any_digits = true;
+        if (mantissa != 0 || *c != '0') {
+            if (significant_digits < 19) {
+                mantissa = mantissa * 10 + (*c - '0');
+            } else {
+                exponent++;
+            }
+            significant_digits++;
+        }
+        c++;
+    }
+    if (c < end && *c == '.') {
+        c++;
+        while (c < end && IsDigit(*c)) {
+            any_digits = true;
+            if (mantissa != 0 || *c != '0') {
+                if (significant_digits < 19) {
+                    mantissa = mantissa * 10 + (*c - '0');
+                    exponent--;
+                }
+                significant_digits++;
+            } else {
+                exponent--;
+            }
+            c++;
+        }
+    }
+    if (!any_digits) {
+        return 0.0f;
+    }
+    if (c < end && (*c == 'e' || *c == 'E')) {
+        const char *e = c + 1;
+        bool negative_exponent = false;
+        if (e < end && (*e == '-' || *e == '+')) {
+            negative_exponent = (*e == '-');
+            e++;
+        }
+        if (e < end && IsDigit(*e)) {
+            int value = 0;
+            while (e < end && IsDigit(*e)) {
+                if (value < 10000) {
+                    value = value * 10 + (*e - '0');
+                }
+                e++;
+            }
+            exponent += negative_exponent ? -value : value;
+            c = e;
+        }
+    }
+    p = c;
+
+    if (significant_digits <= 15 && exponent >= -22 && exponent <= 22) {
+        double value = (double)mantissa;
+        if (exponent < 0) {
+            value /= kPowersOfTen[-exponent];
+        } else {
+            value *= kPowersOfTen[exponent];
+        }
+        return (float)(negative ? -value : value);
+    }
+
+    // Slow path for unusually long or large numbers
+    char buffer[64];
+    size_t length = (size_t)(c - start) < sizeof(buffer) - 1 ? (size_t)(c - start) : sizeof(buffer) - 1;
+    memcpy(buffer, start, length);
+    buffer[length] = '\0';
+    return strtof(buffer, NULL);
+}
+
+// Skips the blanks before a float and parses it
+static inline float NextFloat(const char *&p, const char *end) {
+    p = SkipBlanks(p, end);
+    return ParseFloat(p, end);
+}
+
+// Parses a (possibly negative) integer at the cursor and advances past it.
+// Returns 0 (the placeholder index) if there is no number.
+static int ParseInt(const char *&p, const char *end) {
+    bool negative = false;
+    const char *c = p;
+    if (c < end && (*c == '-' || *c == '+')) {
+        negative = (*c == '-');
+        c++;
+    }
+    if (c >= end || !IsDigit(*c)) {
+        return 0;
+    }
+    int value = 0;
+    while (c < end && IsDigit(*c)) {
+        value = value * 10 + (*c - '0');
+        c++;
+    }
+    p = c;
+    return negative ? -value : value;
+}
+
+// Converts an OBJ index into a position in one of the importer's arrays.  Index 0
+// of each array is a placeholder, so positive indices map directly and negative
+// (relative) indices count back from the most recently read element.  Anything
+// out of range falls back to the placeholder.
+static inline int ResolveIndex(int index, size_t count) {
+    if (index < 0) {
+        index = (int)count + index;
+    }
+    if (index < 0 || (size_t)index >= count) {
+        return 0;
+    }
+    return index;
+}
+
+uint32_t PackNormal(glm::vec3 normal) {
+    uint32_t packed = 0;
+    for (int i = 0; i < 3; i++) {
+        float value = std::min(std::max(normal[i], -1.0f), 1.0f);
+        int32_t component = (int32_t)lroundf(value * 511.0f);
+        packed |= ((uint32_t)component & 0x3FF) << (10 * i);
+    }
+    return packed;
+}
+
+glm::vec3 UnpackNormal(uint32_t packed) {
+    glm::vec3 normal;
+    for (int i = 0; i < 3; i++) {
+        // Sign-extend the 10-bit field
+        int32_t component = (int32_t)((packed >> (10 * i)) & 0x3FF);
+        if (component & 0x200) {
+            component -= 0x400;
+        }
+        normal[i] = std::max(component / 511.0f, -1.0f);
+    }
+    return normal;
+}
+
+// Converts a float to an IEEE half float (rounded to nearest even)
+static uint16_t FloatToHalf(float value) {
+    uint32_t bits;
+    memcpy(&bits, &value, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    int32_t exponent = (int32_t)((bits >> 23) & 0xFF) - 127 + 15;
+    uint32_t mantissa = bits & 0x7FFFFF;
+
+    if (((bits >> 23) & 0xFF) == 0xFF) {
+        // Infinity or NaN
+        return sign | 0x7C00 | (mantissa ? 0x200 : 0);
+    }
+    if (exponent >= 31) {
+        return sign | 0x7C00;
+    }
+    if (exponent <= 0) {
+        // Subnormal half (or zero)
+        if (exponent < -10) {
+            return sign;
+        }
+        mantissa |= 0x800000;
+        int shift = 14 - exponent;
+        uint32_t half = mantissa >> shift;
+        uint32_t remainder = mantissa & ((1u << shift) - 1);
+        uint32_t halfway = 1u << (shift - 1);
+        if (remainder > halfway || (remainder == halfway && (half & 1))) {
+            half++;
+        }
+        return sign | (uint16_t)half;
+    }
+    uint32_t half = ((uint32_t)exponent << 10) | (mantissa >> 13);
+    uint32_t remainder = mantissa & 0x1FFF;
+    // A carry out of the mantissa correctly moves on to the next exponent
+    if (remainder > 0x1000 || (remainder == 0x1000 && (half & 1))) {
+        half++;
+    }
+    return sign | (uint16_t)half;
+}
+
+const void* ImportedMesh::Vertices() const {
+    if (this->cache) {
+        return this->cache->Vertices();
+    }
+    if (this->compact_vertices) {
+        return this->compact_vertex_storage.data();
+    }
+    return this->vertex_storage.data();
+}
+
+const void* ImportedMesh::Indices() const {
+    if (this->cache) {
+        return this->cache->Indices();
+    }
+    if (this->index_size == sizeof(unsigned short)) {
+        return this->short_index_storage.data();
+    }
+    return this->index_storage.data();
+}
+
+std::vector<MaterialTableEntry> ImportedMesh::MaterialTable() const {
+    std::vector<MaterialTableEntry> table;
+    for (const MeshCacheMaterial &material : this->materials) {
+        MaterialTableEntry entry = {};
+        entry.ambient = glm::vec4(material.ambient[0], material.ambient[1], material.ambient[2], 1.0f);
+        entry.diffuse = glm::vec4(material.diffuse[0], material.diffuse[1], material.diffuse[2], material.opacity);
+        entry.specular = glm::vec4(material.specular[0], material.specular[1], material.specular[2], 1.0f);
+        entry.texture_index = material.texture_index >= 0 ? material.texture_index : 99;
+        table.push_back(entry);
+    }
+    return table;
+}
+
+uint64_t ImportedMesh::ContentHash() const {
+    if (!this->loaded || this->vertex_count == 0) {
+        return 0;
+    }
+    std::vector<MaterialTableEntry> table = this->MaterialTable();
+    uint64_t hash = HashBytes(&this->vertex_stride, sizeof(this->vertex_stride));
+    hash = HashBytes(&this->index_size, sizeof(this->index_size), hash);
+    hash = HashBytes(this->Vertices(), (size_t)this->vertex_count * this->vertex_stride, hash);
+    hash = HashBytes(this->Indices(), (size_t)this->index_count * this->index_size, hash);
+    hash = HashBytes(this->lods.data(), this->lods.size() * sizeof(MeshCacheLOD), hash);
+    return HashBytes(table.data(), table.size() * sizeof(MaterialTableEntry), hash);
+}
+
 ImportOBJ::ImportOBJ() {
 }
 
-BasicShape ImportOBJ::loadFiles(std::string baseName, VAOStruct vao) {
-    this->reset();
+size_t ImportOBJ::VertexKeyHash::operator()(const VertexKey &key) const {
+    uint64_t h = (uint64_t)(uint32_t)key.position_index * 0x9E3779B97F4A7C15ULL;
+    h ^= (uint64_t)(uint32_t)key.texture_index * 0xC2B2AE3D27D4EB4FULL + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uint32_t)key.normal_index * 0x165667B19E3779F9ULL + (h << 6) + (h >> 2);
+    h ^= (uint64_t)(uintptr_t)key.material + (h << 6) + (h >> 2);
+    return (size_t)h;
+}
+
+BasicShape ImportOBJ::loadFiles(std::string baseName, VAOStruct vao, std::vector<unsigned int> *textures) const {
+    ImportedMesh mesh;
+    if (this->readMesh(baseName, mesh)) {
+        printSummary(mesh);
+    }
+    if (textures != NULL) {
+        textures->clear();
+        for (const std::string &texture_path : mesh.texture_paths) {
+            textures->push_back(GetTexture(texture_path, true));
+        }
+    }
+    return genShape(mesh, vao);
+}
+
+bool ImportOBJ::readMesh(std::string baseName, ImportedMesh &mesh) const {
+    auto start = std::chrono::steady_clock::now();
+    if (this->useCache && this->readCacheFile(baseName, mesh)) {
+        mesh.load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        return true;
+    }
+    if (!this->parseFiles(baseName, mesh)) {
+        return false;
+    }
+    if (this->useCache) {
+        this->writeCacheFile(baseName, mesh);
+    }
+    mesh.load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+// Appends simplified levels of detail to indices (which holds the full mesh) and
+// records the range of every level in lods.  Each level is simplified from the
+// previous one, so their errors add up; the vertices a level moves are appended to
+// vertices.  lods is left empty if the mesh cannot be simplified.
+template <typename Vertex>
+static void BuildLODs(std::vector<Vertex> &vertices, std::vector<unsigned int> &indices,
+                      std::vector<MeshCacheLOD> &lods) {
+    lods.clear();
+    if (vertices.empty()) {
+        return;
+    }
+    std::vector<glm::vec3> positions;
+    positions.reserve(vertices.size());
+    for (const Vertex &vertex : vertices) {
+        positions.push_back(vertex.Position);
+    }
+    BoundingBox box;
+    BoundingSphere sphere;
+    ComputeBounds(vertices.data(), vertices.size(), sizeof(Vertex), box, sphere);
+    float max_error = LOD_MAX_ERROR * sphere.radius;
+
+    MeshCacheLOD full = {0, (uint32_t)indices.size(), 0.0f, 0};
+    lods.push_back(full);
+    std::vector<unsigned int> previous(indices);
+    float error = 0.0f;
+    while (lods.size() < (size_t)MAX_MESH_LODS && previous.size() / 3 >= (size_t)LOD_MIN_TRIANGLES) {
+        size_t target = (size_t)(previous.size() / 3 * LOD_TRIANGLE_RATIO) * 3;
+        SimplifiedMesh simplified = SimplifyMesh(previous, positions, target, max_error - error, vertices.size());
+        // A level that keeps most of the triangles is not worth switching to
+        if (simplified.indices.size() > previous.size() * 4 / 5) {
+            break;
+        }
+        for (const std::pair<unsigned int, unsigned int> &new_vertex : simplified.new_vertices) {
+            Vertex vertex = vertices[new_vertex.first];
+            vertex.Position = positions[new_vertex.second];
+            vertices.push_back(vertex);
+            positions.push_back(vertex.Position);
+        }
+        error += simplified.error;
+        std::vector<unsigned int> level = OptimizeVertexCache(simplified.indices, vertices.size());
+        MeshCacheLOD lod = {(uint32_t)indices.size(), (uint32_t)level.size(), error, 0};
+        lods.push_back(lod);
+        indices.insert(indices.end(), level.begin(), level.end());
+        previous.swap(level);
+    }
+    if (lods.size() < 2) {
+        lods.clear();
+    }
+}
+
+bool ImportOBJ::parseFiles(std::string baseName, ImportedMesh &mesh) const {
+    auto start = std::chrono::steady_clock::now();
+    mesh = ImportedMesh();
+    mesh.name = baseName;
+
+    ParseState state;
     std::string matName = baseName + ".mtl";
     std::string objName = baseName + ".obj";
-    this->readMTLFile(matName);
-    std::cout<<"Read MTL File:"<<matName<< std::endl;
-    this->readOBJFile(objName);
-    std::cout<<"Read OBJ File"<<objName<<std::endl;
+    this->readMTLFile(matName, state);
+    // The textures are kept even when the .OBJ file is missing
+    mesh.texture_paths = state.texture_paths;
 
-    return this->genShape(vao);
+    // The material table lists the .MTL materials in name order, then the default one
+    int table_index = 0;
+    for (std::pair<const std::string, Material> &entry : state.material_map) {
+        entry.second.table_index = std::min(table_index++, MAX_TABLE_MATERIALS - 1);
+    }
+    state.default_material.material_name = "(default)";
+    state.default_material.table_index = std::min(table_index++, MAX_TABLE_MATERIALS - 1);
+    if (table_index > MAX_TABLE_MATERIALS) {
+        std::cout<<"WARNING: "<<baseName<<" has "<<table_index<<" materials; only "
+                 <<MAX_TABLE_MATERIALS<<" fit in the material table"<<std::endl;
+    }
+    state.compact_vertices = this->compactVertices;
+    if (!this->readOBJFile(objName, state)) {
+        return false;
+    }
+    if (this->printAll) {
+        this->PrintMaterials(state);
+    }
+
+    // Reorder the triangles and vertices for the post-transform cache, overdraw, and fetches
+    if (this->optimizeMeshes) {
+        std::vector<glm::vec3> positions;
+        positions.reserve(state.combinedData.size() + state.compactData.size());
+        for (const CompleteVertex &vertex : state.combinedData) {
+            positions.push_back(vertex.Position);
+        }
+        for (const CompactVertex &vertex : state.compactData) {
+            positions.push_back(vertex.Position);
+        }
+        std::vector<unsigned int> order = OptimizeMesh(state.indices, positions);
+        if (state.compact_vertices) {
+            RemapVertices(state.compactData, order);
+        } else {
+            RemapVertices(state.combinedData, order);
+        }
+    }
+
+    // The levels of detail share the vertex buffer and follow the full mesh in the index buffer
+    if (this->generateLODs) {
+        if (state.compact_vertices) {
+            BuildLODs(state.compactData, state.indices, mesh.lods);
+        } else {
+            BuildLODs(state.combinedData, state.indices, mesh.lods);
+        }
+    }
+
+    // Use 16-bit indices whenever every vertex can be addressed with them
+    mesh.compact_vertices = state.compact_vertices;
+    mesh.vertex_stride = state.compact_vertices ? sizeof(CompactVertex) : sizeof(CompleteVertex);
+    mesh.vertex_count = state.compact_vertices ? state.compactData.size() : state.combinedData.size();
+    mesh.index_count = state.indices.size();
+    if (mesh.vertex_count <= 0xFFFF) {
+        mesh.index_size = sizeof(unsigned short);
+        mesh.short_index_storage.assign(state.indices.begin(), state.indices.end());
+    } else {
+        mesh.index_size = sizeof(unsigned int);
+        mesh.index_storage = std::move(state.indices);
+    }
+
+    BoundingBox box;
+    BoundingSphere sphere;
+    if (state.compact_vertices) {
+        ComputeBounds(state.compactData.data(), state.compactData.size(), sizeof(CompactVertex), box, sphere);
+    } else {
+        ComputeBounds(state.combinedData.data(), state.combinedData.size(), sizeof(CompleteVertex), box, sphere);
+    }
+    mesh.bounds_min = box.min;
+    mesh.bounds_max = box.max;
+    mesh.vertex_storage = std::move(state.combinedData);
+    mesh.compact_vertex_storage = std::move(state.compactData);
+
+    std::vector<const Material*> table;
+    for (const std::pair<const std::string, Material> &entry : state.material_map) {
+        table.push_back(&entry.second);
+    }
+    table.push_back(&state.default_material);
+    for (const Material *material_pointer : table) {
+        const Material &material = *material_pointer;
+        MeshCacheMaterial table_entry;
+        memset(&table_entry, 0, sizeof(table_entry));
+        for (int i = 0; i < 3; i++) {
+            table_entry.ambient[i] = material.ambient[i];
+            table_entry.diffuse[i] = material.diffuse[i];
+            table_entry.specular[i] = material.specular[i];
+        }
+        table_entry.opacity = material.opacity;
+        table_entry.texture_index = material.textured ? material.texture_index : -1;
+        strncpy(table_entry.name, material.material_name.c_str(), sizeof(table_entry.name) - 1);
+        mesh.materials.push_back(table_entry);
+    }
+    mesh.loaded = true;
+    mesh.parse_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return true;
 }
 
-unsigned int ImportOBJ::getTexture(int index) {
-    unsigned int texture = 99;
-   try {
-    texture = this->textures[index];
-    return texture;
-   } catch (std::out_of_range &e) {
-    std::cerr<<"Error getting texture "<<index <<std::endl;
-    return 99;
-   }
+bool ImportOBJ::readCacheFile(std::string baseName, ImportedMesh &mesh) const {
+    std::shared_ptr<MeshCacheFile> cache = std::make_shared<MeshCacheFile>();
+    // A cache written with the other vertex layout or other import settings is rebuilt
+    uint32_t vertex_stride = this->compactVertices ? sizeof(CompactVertex) : sizeof(CompleteVertex);
+    if (!cache->Open(baseName + MESH_CACHE_EXTENSION, baseName + ".obj", baseName + ".mtl", vertex_stride,
+                     this->cacheFlags())) {
+        return false;
+    }
+
+    // The vertex and index blobs stay in the mapped file until they are uploaded
+    mesh = ImportedMesh();
+    mesh.name = baseName;
+    mesh.loaded = true;
+    mesh.from_cache = true;
+    mesh.compact_vertices = this->compactVertices;
+    mesh.vertex_stride = vertex_stride;
+    mesh.vertex_count = cache->VertexCount();
+    mesh.index_count = cache->IndexCount();
+    mesh.index_size = cache->IndexSize();
+    mesh.lods = cache->LODs();
+    mesh.materials.assign(cache->Materials(), cache->Materials() + cache->MaterialCount());
+    mesh.texture_paths = cache->TexturePaths();
+    mesh.bounds_min = cache->BoundsMin();
+    mesh.bounds_max = cache->BoundsMax();
+    mesh.parse_ms = cache->ParseMilliseconds();
+    mesh.cache = cache;
+    return true;
 }
 
-std::vector<unsigned int> ImportOBJ::getAllTextures() {
-    return this->textures;
+uint32_t ImportOBJ::cacheFlags() const {
+    uint32_t flags = 0;
+    if (this->compactVertices) {
+        flags |= MESH_CACHE_COMPACT_VERTICES;
+    }
+    if (this->optimizeMeshes) {
+        flags |= MESH_CACHE_OPTIMIZED;
+    }
+    if (this->generateLODs) {
+        flags |= MESH_CACHE_LODS;
+    }
+    return flags;
 }
 
-void ImportOBJ::readMTLFile(std::string fName) {
-    std::ifstream infile(fName.c_str());
-    if (infile.fail()) {
-        std::cout << "ERROR: File " << fName << " does not exist.\n";
+void ImportOBJ::writeCacheFile(std::string baseName, const ImportedMesh &mesh) const {
+    MeshCacheContents contents;
+    contents.vertices = mesh.Vertices();
+    contents.vertex_count = mesh.vertex_count;
+    contents.vertex_stride = mesh.vertex_stride;
+    contents.import_flags = this->cacheFlags();
+    contents.indices = mesh.Indices();
+    contents.index_count = mesh.index_count;
+    contents.index_size = mesh.index_size;
+    contents.lods = mesh.lods;
+    contents.materials = mesh.materials;
+    contents.texture_paths = mesh.texture_paths;
+    contents.bounds_min = mesh.bounds_min;
+    contents.bounds_max = mesh.bounds_max;
+    contents.parse_ms = mesh.parse_ms;
+
+    if (!MeshCacheFile::Write(baseName + MESH_CACHE_EXTENSION, baseName + ".obj", baseName + ".mtl", contents)) {
+        std::cout<<"WARNING: Could not write mesh cache "<<baseName<<MESH_CACHE_EXTENSION<<std::endl;
+    }
+}
+
+void ImportOBJ::printSummary(const ImportedMesh &mesh) {
+    if (!mesh.loaded) {
         return;
     }
+    if (mesh.from_cache) {
+        std::cout<<"Read mesh cache:"<<mesh.name<<MESH_CACHE_EXTENSION<<" ("<<mesh.vertex_count<<" vertices) in "
+                 <<mesh.load_ms<<" ms (text import took "<<mesh.parse_ms<<" ms)"<<std::endl;
+    } else {
+        // Report how much the vertex de-duplication saved (for the full mesh)
+        uint32_t full_index_count = mesh.lods.empty() ? mesh.index_count : mesh.lods[0].index_count;
+        double before_kb = full_index_count * mesh.vertex_stride / 1024.0;
+        double after_kb = (mesh.vertex_count * mesh.vertex_stride + mesh.index_count * mesh.index_size) / 1024.0;
+        std::cout<<"Read MTL/OBJ Files:"<<mesh.name<<" ("<<full_index_count<<" -> "
+                 <<mesh.vertex_count<<" vertices, "<<(int)before_kb<<" KB -> "<<(int)after_kb<<" KB) in "
+                 <<mesh.parse_ms<<" ms"<<std::endl;
+    }
+
+    // GPU memory used by the mesh (compact meshes are compared with the full vertex layout)
+    double vertex_kb = mesh.vertex_count * mesh.vertex_stride / 1024.0;
+    double index_kb = mesh.index_count * mesh.index_size / 1024.0;
+    double table_kb = mesh.materials.size() * sizeof(MaterialTableEntry) / 1024.0;
+    std::ostringstream report;
+    report<<std::fixed<<std::setprecision(1);
+    report<<"  GPU memory: "<<vertex_kb<<" KB vertices ("<<mesh.vertex_stride<<" bytes each) + "
+          <<index_kb<<" KB indices + "<<table_kb<<" KB material table = "<<(vertex_kb + index_kb + table_kb)<<" KB";
+    if (mesh.compact_vertices) {
+        double full_kb = mesh.vertex_count * sizeof(CompleteVertex) / 1024.0 + index_kb + table_kb;
+        report<<" (full vertices would use "<<full_kb<<" KB)";
+    }
+    std::cout<<report.str()<<std::endl;
+
+    if (!mesh.lods.empty()) {
+        std::ostringstream levels;
+        levels<<std::fixed<<std::setprecision(3);
+        levels<<"  LODs:";
+        for (const MeshCacheLOD &lod : mesh.lods) {
+            levels<<" "<<lod.index_count / 3;
+            if (&lod != &mesh.lods[0]) {
+                levels<<" (error "<<lod.error<<")";
+            }
+        }
+        levels<<" triangles";
+        std::cout<<levels.str()<<std::endl;
+    }
+}
 
-    std::string curLine;
-    //int matCount = 0;   // Index of next material to be added
-    std::string current_material_name;
-    while (std::getline(infile, curLine)) {
-        Material* current_material = NULL;
-        std::string linePrefix;
-        std::istringstream iss(curLine, std::istringstream::in);
-        iss >> linePrefix;
+bool ImportOBJ::readMTLFile(std::string fName, ParseState &state) const {
+    MappedFile file;
+    if (!file.Open(fName)) {
+        std::cout << "ERROR: File " << fName << " does not exist.\n";
+        return false;
+    }
 
+    const char *cursor = file.Data();
+    const char *end = cursor + file.Size();
+    Material *current_material = NULL;
+    while (cursor < end) {
+        const char *line_end = LineEnd(cursor, end);
+        const char *prefix = SkipBlanks(cursor, line_end);
+        const char *prefix_end = TokenEnd(prefix, line_end);
+        const char *p = prefix_end;
 
-        if (linePrefix == "newmtl") {
-            current_material_name = curLine.substr(7);
+        if (TokenIs(prefix, prefix_end, "newmtl")) {
             Material new_mat;
-            new_mat.material_name = current_material_name;
-            this->material_map.insert(std::pair<std::string, 
-                                      Material>(current_material_name, new_mat));
+            new_mat.material_name = RestOfLine(p, line_end);
+            current_material = &(state.material_map.insert(std::pair<std::string,
+                                      Material>(new_mat.material_name, new_mat)).first->second);
+        }
+        //Properties that appear before the first newmtl have nowhere to go
+        else if (current_material == NULL) {
         }
         //Ambient Color
-        else if (linePrefix == "Ka") {
-            current_material = &(this->material_map.find(current_material_name)->second);
-            glm::vec3 color = getVec3(curLine);
-            current_material->ambient = color;
+        else if (TokenIs(prefix, prefix_end, "Ka")) {
+            current_material->ambient.x = NextFloat(p, line_end);
+            current_material->ambient.y = NextFloat(p, line_end);
+            current_material->ambient.z = NextFloat(p, line_end);
         }
 
         // Diffuse color
-        else if (linePrefix == "Kd") {
-            current_material = &(this->material_map.find(current_material_name)->second);
-            glm::vec3 color = getVec3(curLine);
-            current_material->diffuse = color;
+        else if (TokenIs(prefix, prefix_end, "Kd")) {
+            current_material->diffuse.x = NextFloat(p, line_end);
+            current_material->diffuse.y = NextFloat(p, line_end);
+            current_material->diffuse.z = NextFloat(p, line_end);
         }
 
         //Specular Color
-        else if (linePrefix == "Ks") {
-            current_material = &(this->material_map.find(current_material_name)->second);
-            glm::vec3 color = getVec3(curLine);
-            current_material->specular = color;
+        else if (TokenIs(prefix, prefix_end, "Ks")) {
+            current_material->specular.x = NextFloat(p, line_end);
+            current_material->specular.y = NextFloat(p, line_end);
+            current_material->specular.z = NextFloat(p, line_end);
         }
 
         //Opacity
-        else if (linePrefix == "d") {
-            current_material = &(this->material_map.find(current_material_name)->second);
-            float opacity_setting = getFloat(curLine);
-            current_material->opacity = opacity_setting;
+        else if (TokenIs(prefix, prefix_end, "d")) {
+            current_material->opacity = NextFloat(p, line_end);
         }
 
         //Texture
-        else if (linePrefix == "map_Kd") {
-            current_material = &(this->material_map.find(current_material_name)->second);
-            this->textures.push_back(GetTexture(curLine.substr(7),true));
+        else if (TokenIs(prefix, prefix_end, "map_Kd")) {
+            state.texture_paths.push_back(RestOfLine(p, line_end));
             current_material->textured = true;
-            current_material->texture_index = textures.size()-1;
+            current_material->texture_index = state.texture_paths.size()-1;
         }
+
+        cursor = (line_end < end) ? line_end + 1 : end;
     }
+    return true;
 }
 
 std::string GetVecStr (glm::vec3 v) {
@@ -109,10 +684,10 @@ std::string GetVecStr (glm::vec3 v) {
         return s;
 }
 
-void ImportOBJ::PrintMaterials() {
-    std::map<std::string,Material>::iterator i;
+void ImportOBJ::PrintMaterials(const ParseState &state) const {
+    std::map<std::string,Material>::const_iterator i;
 
-    for (i = this->material_map.begin(); i != this->material_map.end(); i++) {
+    for (i = state.material_map.begin(); i != state.material_map.end(); i++) {
         std::string name = i->first;
         Material material = i->second;
         std::cout<<"Material: "<<name<<std::endl;
@@ -125,167 +700,374 @@ void ImportOBJ::PrintMaterials() {
 
 }
 
-/** Loads .OBJ file into the ImportOBJ data structures */
-void ImportOBJ::readOBJFile(std::string fName) {
-    std::ifstream infile(fName.c_str());
-    if (infile.fail()) {
+/** Loads .OBJ file into the parse state.  Large files are split into line-aligned
+ *  chunks that are parsed on several threads:
+ *   1. count the v/vt/vn lines and find the last usemtl of each chunk, so every chunk
+ *      knows how many elements come before it and which material it starts with
+ *   2. parse each chunk: elements go into per-chunk arrays and face corners are
+ *      de-duplicated within the chunk
+ *   3. find where each unique corner first appears in the file and number the corners
+ *      in that order (the same numbers a serial parse gives them), then fill the
+ *      vertex and index buffers
+ **/
+bool ImportOBJ::readOBJFile(std::string fName, ParseState &state) const {
+    MappedFile file;
+    if (!file.Open(fName)) {
         std::cout << "ERROR: File " << fName << " does not exist.\n";
-        return;
+        return false;
     }
 
-    std::string curLine;
-
     // Push placeholder vec3s to our data structures
     // Allows index numbers to directly align with vertex# or
     // normal# in the OBJ file (OBJ vertex numbers start at 1)
-    this->vertices.push_back(glm::vec3(-1.0, -1.0, -1.0));
-    this->normals.push_back(glm::vec3(-1.0, -1.0, -1.0));
-    this->textCoords.push_back(glm::vec2(-1.0, -1.0));
-
+    state.vertices.push_back(glm::vec3(-1.0, -1.0, -1.0));
+    state.normals.push_back(glm::vec3(-1.0, -1.0, -1.0));
+    state.textCoords.push_back(glm::vec2(-1.0, -1.0));
 
-    while (std::getline(infile, curLine)) {
-        
-        // .OBJ lines are prefixed to indicate what information they contain
-        // Designate an input string stream to capture it
-        std::string linePrefix;
-        std::istringstream iss(curLine, std::istringstream::in);
-        iss >> linePrefix;
+    const char *data = file.Data();
+    const char *end = data + file.Size();
+    int chunk_count = 1;
+    if (this->parseThreads > 1 && file.Size() >= PARALLEL_PARSE_MIN_BYTES) {
+        chunk_count = this->parseThreads;
+    }
 
-        // Standard vertex coordinate
-        if (linePrefix == "v") {
-            this->vertices.push_back(this->getVec3(curLine));
+    std::vector<ParseChunk> chunks(chunk_count);
+    const char *cursor = data;
+    for (int i = 0; i < chunk_count; i++) {
+        ParseChunk &chunk = chunks[i];
+        chunk.begin = cursor;
+        chunk.end = end;
+        if (i < chunk_count - 1) {
+            // Move the split point to the start of the next line
+            const char *split = data + file.Size() * (i + 1) / chunk_count;
+            if (split < cursor) {
+                split = cursor;
+            }
+            split = LineEnd(split, end);
+            chunk.end = (split < end) ? split + 1 : end;
         }
+        chunk.default_material = &state.default_material;
+        cursor = chunk.end;
+    }
 
-        // Vertex normal
-        else if (linePrefix == "vn") {
-            this->normals.push_back(this->getVec3(curLine));
-        }
+    // Pass 1: only the chunks before the last one need to be counted
+    ParallelFor(chunk_count - 1, this->parseThreads, [&](int i) {
+        countChunk(state, chunks[i]);
+    });
+    chunks[0].vertex_base = state.vertices.size();
+    chunks[0].normal_base = state.normals.size();
+    chunks[0].texture_base = state.textCoords.size();
+    for (int i = 1; i < chunk_count; i++) {
+        const ParseChunk &previous = chunks[i - 1];
+        chunks[i].vertex_base = previous.vertex_base + previous.vertex_count;
+        chunks[i].normal_base = previous.normal_base + previous.normal_count;
+        chunks[i].texture_base = previous.texture_base + previous.texture_count;
+        chunks[i].curMat = previous.changes_material ? previous.last_material : previous.curMat;
+    }
 
-        // Vertex texture
-        else if (linePrefix == "vt") {
-            this->textCoords.push_back(this->getVec2(curLine));
-        }
+    // Pass 2
+    ParallelFor(chunk_count, this->parseThreads, [&](int i) {
+        parseChunk(state, chunks[i]);
+    });
 
-        // Changes the material being used
-        else if (linePrefix == "usemtl") {
-            std::string matName = curLine.substr(7);
-            this->curMat = &(this->material_map.find(matName)->second);
-        }
+    // Pass 3: number every unique corner the first time it appears in the file.  A
+    // single chunk's keys are already unique and in that order.  Otherwise the keys
+    // are split into partitions by hash, so each partition can find the first
+    // occurrence of its keys on its own thread.
+    std::vector<VertexKey> keys;
+    std::vector<std::vector<unsigned int>> key_numbers(chunk_count);
+    if (chunk_count == 1) {
+        keys.swap(chunks[0].keys);
+    } else {
+        const int partition_count = chunk_count;
+        const uint64_t FIRST_OCCURRENCE = ~(uint64_t)0;
+        std::vector<std::vector<std::vector<unsigned int>>> partitions(chunk_count);
+        std::vector<std::vector<uint64_t>> first_seen(chunk_count);
+        ParallelFor(chunk_count, this->parseThreads, [&](int i) {
+            partitions[i].resize(partition_count);
+            first_seen[i].resize(chunks[i].keys.size());
+            VertexKeyHash hash;
+            for (size_t k = 0; k < chunks[i].keys.size(); k++) {
+                partitions[i][hash(chunks[i].keys[k]) % partition_count].push_back(k);
+            }
+            // The per-chunk lookups are no longer needed
+            std::unordered_map<VertexKey,unsigned int,VertexKeyHash>().swap(chunks[i].key_lookup);
+        });
 
-        // Face
-        else if (linePrefix == "f") {
-            this->readLineFace(curLine);
+        // For each key: FIRST_OCCURRENCE, or the (chunk, key) where it first appeared
+        ParallelFor(partition_count, this->parseThreads, [&](int partition) {
+            std::unordered_map<VertexKey,uint64_t,VertexKeyHash> first_occurrence;
+            size_t partition_size = 0;
+            for (int i = 0; i < chunk_count; i++) {
+                partition_size += partitions[i][partition].size();
+            }
+            first_occurrence.reserve(partition_size);
+            for (int i = 0; i < chunk_count; i++) {
+                for (unsigned int k : partitions[i][partition]) {
+                    uint64_t location = ((uint64_t)i << 32) | k;
+                    std::pair<std::unordered_map<VertexKey,uint64_t,VertexKeyHash>::iterator, bool> inserted =
+                        first_occurrence.insert(std::make_pair(chunks[i].keys[k], location));
+                    first_seen[i][k] = inserted.second ? FIRST_OCCURRENCE : inserted.first->second;
+                }
+            }
+        });
+
+        // First occurrences are numbered in file order
+        std::vector<size_t> number_offsets(chunk_count, 0);
+        size_t key_count = 0;
+        for (int i = 0; i < chunk_count; i++) {
+            number_offsets[i] = key_count;
+            key_count += std::count(first_seen[i].begin(), first_seen[i].end(), FIRST_OCCURRENCE);
         }
+        keys.resize(key_count);
+        ParallelFor(chunk_count, this->parseThreads, [&](int i) {
+            size_t number = number_offsets[i];
+            key_numbers[i].resize(chunks[i].keys.size());
+            for (size_t k = 0; k < chunks[i].keys.size(); k++) {
+                if (first_seen[i][k] == FIRST_OCCURRENCE) {
+                    keys[number] = chunks[i].keys[k];
+                    key_numbers[i][k] = number++;
+                }
+            }
+        });
+        // Repeats take the number of their first occurrence (always in an earlier chunk)
+        ParallelFor(chunk_count, this->parseThreads, [&](int i) {
+            for (size_t k = 0; k < chunks[i].keys.size(); k++) {
+                if (first_seen[i][k] != FIRST_OCCURRENCE) {
+                    key_numbers[i][k] = key_numbers[first_seen[i][k] >> 32][first_seen[i][k] & 0xFFFFFFFF];
+                }
+            }
+        });
     }
 
-    if (debugOutput) {
-        std::cout << fName << " file parsed.\n";
-        std::cout << vertices.size() << " vertices parsed.\n";
-        std::cout << normals.size() << " normals parsed.\n";
-        std::cout << textCoords.size() << " texture coordinates parsed.\n";
-        std::cout << combinedData.size() << " combined points.\n";
+    // Copy the elements (in file order) and fill the vertex and index buffers
+    std::vector<size_t> index_offsets(chunk_count, 0);
+    size_t index_count = 0;
+    for (int i = 0; i < chunk_count; i++) {
+        index_offsets[i] = index_count;
+        index_count += chunks[i].indices.size();
+    }
+    const ParseChunk &last_chunk = chunks[chunk_count - 1];
+    state.vertices.resize(last_chunk.vertex_base + last_chunk.vertices.size());
+    state.normals.resize(last_chunk.normal_base + last_chunk.normals.size());
+    state.textCoords.resize(last_chunk.texture_base + last_chunk.textCoords.size());
+    ParallelFor(chunk_count, this->parseThreads, [&](int i) {
+        std::copy(chunks[i].vertices.begin(), chunks[i].vertices.end(), state.vertices.begin() + chunks[i].vertex_base);
+        std::copy(chunks[i].normals.begin(), chunks[i].normals.end(), state.normals.begin() + chunks[i].normal_base);
+        std::copy(chunks[i].textCoords.begin(), chunks[i].textCoords.end(), state.textCoords.begin() + chunks[i].texture_base);
+    });
+    if (state.compact_vertices) {
+        state.compactData.resize(keys.size());
+    } else {
+        state.combinedData.resize(keys.size());
+    }
+    state.indices.resize(index_count);
+    ParallelFor(chunk_count, this->parseThreads, [&](int i) {
+        // Each thread builds one slice of the vertices and copies one chunk's indices
+        size_t first = keys.size() * i / chunk_count;
+        size_t last = keys.size() * (i + 1) / chunk_count;
+        for (size_t k = first; k < last; k++) {
+            if (state.compact_vertices) {
+                state.compactData[k] = buildCompactVertex(state, keys[k]);
+            } else {
+                state.combinedData[k] = buildVertex(state, keys[k]);
+            }
+        }
+        const std::vector<unsigned int> &indices = chunks[i].indices;
+        unsigned int *destination = state.indices.data() + index_offsets[i];
+        if (chunk_count == 1) {
+            std::copy(indices.begin(), indices.end(), destination);
+        } else {
+            for (size_t k = 0; k < indices.size(); k++) {
+                destination[k] = key_numbers[i][indices[k]];
+            }
+        }
+    });
 
-        infile.close();
+    if (debugOutput) {
+        std::cout << fName << " file parsed in " << chunk_count << " chunks.\n";
+        std::cout << state.vertices.size() << " vertices parsed.\n";
+        std::cout << state.normals.size() << " normals parsed.\n";
+        std::cout << state.textCoords.size() << " texture coordinates parsed.\n";
+        std::cout << keys.size() << " combined points.\n";
+        std::cout << state.indices.size() << " indices.\n";
     }
+    return true;
 }
 
-int ImportOBJ::getNumCombined() {
-    return this->combinedData.size();
+void ImportOBJ::countChunk(const ParseState &state, ParseChunk &chunk) {
+    const char *cursor = chunk.begin;
+    while (cursor < chunk.end) {
+        const char *line_end = LineEnd(cursor, chunk.end);
+        const char *prefix = SkipBlanks(cursor, line_end);
+        const char *prefix_end = TokenEnd(prefix, line_end);
+        size_t prefix_length = prefix_end - prefix;
+
+        if (prefix_length == 1 && prefix[0] == 'v') {
+            chunk.vertex_count++;
+        } else if (prefix_length == 2 && prefix[0] == 'v' && prefix[1] == 'n') {
+            chunk.normal_count++;
+        } else if (prefix_length == 2 && prefix[0] == 'v' && prefix[1] == 't') {
+            chunk.texture_count++;
+        } else if (TokenIs(prefix, prefix_end, "usemtl")) {
+            std::map<std::string,Material>::const_iterator found = state.material_map.find(RestOfLine(prefix_end, line_end));
+            chunk.last_material = (found != state.material_map.end()) ? &(found->second) : NULL;
+            chunk.changes_material = true;
+        }
+
+        cursor = (line_end < chunk.end) ? line_end + 1 : chunk.end;
+    }
 }
 
-/** Generates a BasicShape from stored vertices and texture coordinates. */
-BasicShape ImportOBJ::genShape(VAOStruct vao) {
-    BasicShape new_shape;
-    
-    new_shape.Initialize(vao,(float*)&this->combinedData[0],
-                         this->combinedData.size()*sizeof(CompleteVertex),
-                         this->combinedData.size(),GL_TRIANGLES);
+void ImportOBJ::parseChunk(const ParseState &state, ParseChunk &chunk) {
+    const char *cursor = chunk.begin;
+    const char *end = chunk.end;
+    while (cursor < end) {
+        // .OBJ lines are prefixed to indicate what information they contain
+        const char *line_end = LineEnd(cursor, end);
+        const char *prefix = SkipBlanks(cursor, line_end);
+        const char *prefix_end = TokenEnd(prefix, line_end);
+        const char *p = prefix_end;
+        size_t prefix_length = prefix_end - prefix;
 
+        // Standard vertex coordinate
+        if (prefix_length == 1 && prefix[0] == 'v') {
+            glm::vec3 vertex;
+            vertex.x = NextFloat(p, line_end);
+            vertex.y = NextFloat(p, line_end);
+            vertex.z = NextFloat(p, line_end);
+            chunk.vertices.push_back(vertex);
+        }
 
-    return new_shape;
+        // Face
+        else if (prefix_length == 1 && prefix[0] == 'f') {
+            readLineFace(chunk, p, line_end);
+        }
 
-}
+        // Vertex normal
+        else if (prefix_length == 2 && prefix[0] == 'v' && prefix[1] == 'n') {
+            glm::vec3 normal;
+            normal.x = NextFloat(p, line_end);
+            normal.y = NextFloat(p, line_end);
+            normal.z = NextFloat(p, line_end);
+            chunk.normals.push_back(normal);
+        }
 
-/** Clears all internal data structures */
-void ImportOBJ::reset() {
-    this->vertices.clear();
-    this->normals.clear();
-    this->textCoords.clear();
-    this->combinedData.clear();
-    this->material_map.clear();
-    this->textures.clear();
-}
-
-/** Only works with faces broken down into triangles */
-void ImportOBJ::readLineFace(std::string line) {
-    int firstVertexStart = 2;
-    int secondVertexStart = line.find(" ", firstVertexStart) + 1;
-    int thirdVertexStart = line.find(" ", secondVertexStart) + 1;
-    this->readFace(line.substr(firstVertexStart, secondVertexStart - 1));
-    this->readFace(line.substr(secondVertexStart, thirdVertexStart - 1));
-    this->readFace(line.substr(thirdVertexStart));
-    
-}
-
-// Given a string in the format:
-// xx/yy/zz returns a ivec3 of (xx, yy, zz)
-void ImportOBJ::readFace(std::string lineSegment) {
-    // std::cout<<"Line: "<<lineSegment<<std::endl;
-    int indexY = lineSegment.find("/", 0) + 1;
-    int indexZ = lineSegment.find("/", indexY) + 1;
-    int x = strtol(lineSegment.substr(0, indexY - 1).c_str(), NULL, 10);
-    int y = strtol(lineSegment.substr(indexY, indexZ - 1).c_str(), NULL, 10);
-    int z = strtol(lineSegment.substr(indexZ).c_str(), NULL, 10);
-    // std::cout<<"  Line Parsed: "<<x<<","<<y<<","<<z<<std::endl;
-    CompleteVertex newVert;
-    newVert.Position = this->vertices.at(x);
-    newVert.TexCoords = this->textCoords.at(y);
-    newVert.Normal = this->normals.at(z);
-    newVert.aColor = this->curMat->ambient;
-    newVert.Color = this->curMat->diffuse;
-    newVert.sColor = this->curMat->specular;
-    newVert.opacity = this->curMat->opacity;
-    if (this->curMat->textured) {
-        newVert.texture_index = 1.0f*this->curMat->texture_index;
-    }
-    this->combinedData.push_back(newVert);
+        // Vertex texture
+        else if (prefix_length == 2 && prefix[0] == 'v' && prefix[1] == 't') {
+            glm::vec2 coordinates;
+            coordinates.x = NextFloat(p, line_end);
+            coordinates.y = NextFloat(p, line_end);
+            chunk.textCoords.push_back(coordinates);
+        }
 
+        // Changes the material being used
+        else if (TokenIs(prefix, prefix_end, "usemtl")) {
+            std::map<std::string,Material>::const_iterator found = state.material_map.find(RestOfLine(p, line_end));
+            chunk.curMat = (found != state.material_map.end()) ? &(found->second) : NULL;
+        }
+
+        cursor = (line_end < end) ? line_end + 1 : end;
+    }
 }
 
-float ImportOBJ::getFloat (std::string line) {
-    int indexD = line.find(" ",0)+1;
-    return strtof(line.substr(indexD,line.find(".",0)+4).c_str(),NULL);
+CompleteVertex ImportOBJ::buildVertex(const ParseState &state, const VertexKey &key) {
+    CompleteVertex newVert;
+    newVert.Position = state.vertices[key.position_index];
+    newVert.TexCoords = state.textCoords[key.texture_index];
+    newVert.Normal = state.normals[key.normal_index];
+    newVert.material_index = key.material->table_index;
+    return newVert;
 }
 
-glm::vec3 ImportOBJ::getVec3(std::string line) {
-    // Line format, where _ is a space and XX designates the info on the line
-    // mtllib = file name for materials
-    // v = vertex coordinate
-    // vn = vertex normal
-    // vt = vertex texture coordinate
-    // <x>, <y>, <z> are the x, y, and z coordinates
+CompactVertex ImportOBJ::buildCompactVertex(const ParseState &state, const VertexKey &key) {
+    CompactVertex newVert;
+    newVert.Position = state.vertices[key.position_index];
+    newVert.Normal = PackNormal(state.normals[key.normal_index]);
+    newVert.TexCoords[0] = FloatToHalf(state.textCoords[key.texture_index].x);
+    newVert.TexCoords[1] = FloatToHalf(state.textCoords[key.texture_index].y);
+    newVert.material_index = key.material->table_index;
+    return newVert;
+}
 
-    // XX_<x>_<y>_<z>
+/** Generates a BasicShape (with its material table) from an imported mesh. */
+BasicShape ImportOBJ::genShape(const ImportedMesh &mesh, VAOStruct vao) {
+    BasicShape new_shape;
+    if (!mesh.loaded || mesh.vertex_count == 0) {
+        return new_shape;
+    }
 
-    // Finds index of start of x, y, and z coordinates
-    int indexX = line.find(" ", 0) + 1;
-    int indexY = line.find(" ", indexX) + 1;
-    int indexZ = line.find(" ", indexY) + 1;
-    float x = strtof(line.substr(indexX, indexY-1).c_str(), NULL);
-    float y = strtof(line.substr(indexY, indexZ-1).c_str(), NULL);
-    float z = strtof(line.substr(indexZ).c_str(), NULL);
-    return glm::vec3(x, y, z);
-}
+    new_shape.Initialize(vao,(const float*)mesh.Vertices(),
+                         mesh.vertex_count*mesh.vertex_stride,
+                         mesh.vertex_count,GL_TRIANGLES);
+    new_shape.InitializeIndices(mesh.Indices(), mesh.index_count*mesh.index_size, mesh.index_count,
+                                mesh.index_size == sizeof(unsigned short) ? GL_UNSIGNED_SHORT : GL_UNSIGNED_INT);
+    std::vector<ShapeLOD> lods;
+    for (const MeshCacheLOD &lod : mesh.lods) {
+        ShapeLOD level;
+        level.first_index = lod.index_offset;
+        level.index_count = lod.index_count;
+        level.error = lod.error;
+        lods.push_back(level);
+    }
+    new_shape.InitializeLODs(lods);
+    std::vector<MaterialTableEntry> table = mesh.MaterialTable();
+    table.resize(std::min((int)table.size(), MAX_TABLE_MATERIALS));
+    new_shape.InitializeMaterialTable(table.data(), table.size()*sizeof(MaterialTableEntry));
+    return new_shape;
 
-glm::vec2 ImportOBJ::getVec2(std::string line) {
-    // As getVec3, except only gets x and y
-    // Used primarily for vt coordinates
-    int indexX = line.find(" ", 0) + 1;
-    int indexY = line.find(" ", indexX) + 1;
-    float x = strtof(line.substr(indexX, indexY-1).c_str(), NULL);
-    float y = strtof(line.substr(indexY).c_str(), NULL);
-    return glm::vec2(x, y);
 }
 
+/** Faces with more than three corners are emitted as a triangle fan */
+void ImportOBJ::readLineFace(ParseChunk &chunk, const char *cursor, const char *line_end) {
+    int first[3] = {0, 0, 0};
+    int previous[3] = {0, 0, 0};
+    int corner_count = 0;
+    const char *p = SkipBlanks(cursor, line_end);
+    while (p < line_end) {
+        // Each corner has the format v, v/vt, v//vn or v/vt/vn
+        int corner[3] = {0, 0, 0};
+        const char *corner_start = p;
+        corner[0] = ParseInt(p, line_end);
+        if (p < line_end && *p == '/') {
+            p++;
+            corner[1] = ParseInt(p, line_end);
+            if (p < line_end && *p == '/') {
+                p++;
+                corner[2] = ParseInt(p, line_end);
+            }
+        }
+        // Skip anything unexpected so a malformed token cannot stall the loop
+        if (p == corner_start) {
+            p = TokenEnd(p, line_end);
+        }
+        p = SkipBlanks(p, line_end);
 
+        // Indices are resolved against everything read so far in the whole file
+        corner[0] = ResolveIndex(corner[0], chunk.vertex_base + chunk.vertices.size());
+        corner[1] = ResolveIndex(corner[1], chunk.texture_base + chunk.textCoords.size());
+        corner[2] = ResolveIndex(corner[2], chunk.normal_base + chunk.normals.size());
+        if (corner_count == 0) {
+            memcpy(first, corner, sizeof(first));
+        } else if (corner_count >= 2) {
+            readFace(chunk, first[0], first[1], first[2]);
+            readFace(chunk, previous[0], previous[1], previous[2]);
+            readFace(chunk, corner[0], corner[1], corner[2]);
+        }
+        memcpy(previous, corner, sizeof(previous));
+        corner_count++;
+    }
+}
 
+// Adds the index for one face corner, recording its key the first time the
+// corner is seen
+void ImportOBJ::readFace(ParseChunk &chunk, int position_index, int texture_index, int normal_index) {
+    const Material *material = chunk.curMat ? chunk.curMat : chunk.default_material;
+    VertexKey key = {position_index, texture_index, normal_index, material};
+    std::pair<std::unordered_map<VertexKey,unsigned int,VertexKeyHash>::iterator, bool> inserted =
+        chunk.key_lookup.insert(std::make_pair(key, (unsigned int)chunk.keys.size()));
+    chunk.indices.push_back(inserted.first->second);
+    if (inserted.second) {
+        chunk.keys.push_back(key);
+    }
+}
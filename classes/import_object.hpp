@@ -4,12 +4,125 @@
 #include <string>
 #include <vector>
 #include <map>
+#include <unordered_map>
+#include <memory>
+#include <cstdint>
 #include <glm/glm.hpp>
 #include "basic_shape.hpp"
+#include "mesh_cache.hpp"
+#include "thread_pool.hpp"
+
+//.OBJ files smaller than this are always parsed on a single thread
+const size_t PARALLEL_PARSE_MIN_BYTES = 1024 * 1024;
+
+//One vertex of an imported model as it is stored in the vertex buffer.  The colors,
+// opacity, and texture index of its material come from the model's material table.
+struct CompleteVertex {
+    glm::vec3 Position;
+    glm::vec3 Normal;
+    glm::vec2 TexCoords;
+    //Row of the model's material table
+    uint32_t material_index = 0;
+};
+
+//Each level of detail aims for this fraction of the previous level's triangles
+const float LOD_TRIANGLE_RATIO = 0.5f;
+//Levels with fewer triangles are not simplified any further
+const int LOD_MIN_TRIANGLES = 256;
+//Largest error of any level of detail, as a fraction of the mesh's bounding radius
+const float LOD_MAX_ERROR = 0.05f;
+
+//Smaller vertex layout (24 bytes) used when ImportOBJ::compactVertices is set
+struct CompactVertex {
+    glm::vec3 Position;
+    //Signed normalized x, y, z in 10 bits each (GL_INT_2_10_10_10_REV)
+    uint32_t Normal;
+    //Half floats
+    uint16_t TexCoords[2];
+    //Row of the model's material table
+    uint16_t material_index;
+    uint16_t padding = 0;
+};
+static_assert(sizeof(CompactVertex) == 24, "CompactVertex must stay 24 bytes");
+
+//Packs a normal into the signed 10-bit x, y, z fields of a GL_INT_2_10_10_10_REV value,
+// and unpacks one (as the GPU does for a normalized attribute)
+uint32_t PackNormal(glm::vec3 normal);
+glm::vec3 UnpackNormal(uint32_t packed);
+
+//Largest material table a model can have (must match MAX_MATERIALS in vertex.glsl)
+const int MAX_TABLE_MATERIALS = 128;
+
+//One row of a material table as it is laid out in the uniform buffer (std140)
+struct MaterialTableEntry {
+    glm::vec4 ambient;
+    //rgb = diffuse color, a = opacity
+    glm::vec4 diffuse;
+    glm::vec4 specular;
+    //99 if the material is not textured
+    int32_t texture_index;
+    int32_t padding[3];
+};
+
+/** ImportedMesh is the CPU-side result of importing one model: the de-duplicated
+ *  vertices, the index buffer, the material table, and the texture files it uses.
+ *  It is produced by ImportOBJ::readMesh (on any thread) and turned into a
+ *  BasicShape by ImportOBJ::genShape (on the thread that owns the OpenGL context).
+ *  The data is either owned by the mesh or, when it came from a .meshbin file,
+ *  read straight from the mapped cache.
+ **/
+struct ImportedMesh {
+    std::string name;
+    //False if the .OBJ file could not be read
+    bool loaded = false;
+    bool from_cache = false;
+    //True if the vertices are CompactVertex instead of CompleteVertex
+    bool compact_vertices = false;
+    uint32_t vertex_stride = sizeof(CompleteVertex);
+    uint32_t vertex_count = 0;
+    uint32_t index_count = 0;
+    //Bytes per index (2 when every vertex can be addressed with 16 bits, otherwise 4)
+    uint32_t index_size = sizeof(unsigned int);
+    //Ranges of the index buffer holding each level of detail, starting with the full
+    // mesh (empty when the whole index buffer is a single level)
+    std::vector<MeshCacheLOD> lods;
+    //One entry per material of the .MTL file (in name order) followed by the
+    // default material used by faces without a valid usemtl
+    std::vector<MeshCacheMaterial> materials;
+    //Texture file for each map_Kd entry (a material's texture_index refers to this list)
+    std::vector<std::string> texture_paths;
+    glm::vec3 bounds_min = glm::vec3(0.0f);
+    glm::vec3 bounds_max = glm::vec3(0.0f);
+    //Time spent parsing the text files (for a cached mesh: when the cache was written)
+    double parse_ms = 0.0;
+    //Time spent producing this mesh (parsing or reading the cache)
+    double load_ms = 0.0;
+
+    //Returns the vertex data (vertex_stride bytes per vertex)
+    const void* Vertices() const;
+    const void* Indices() const;
+    //Returns the material table in the layout of the uniform buffer
+    std::vector<MaterialTableEntry> MaterialTable() const;
+    //Returns a hash of everything that is uploaded (0 if the mesh is not loaded), so
+    // meshes with identical GPU data can share it
+    uint64_t ContentHash() const;
+
+    //Storage behind Vertices()/Indices() when the mesh was parsed
+    std::vector<CompleteVertex> vertex_storage;
+    std::vector<CompactVertex> compact_vertex_storage;
+    std::vector<unsigned short> short_index_storage;
+    std::vector<unsigned int> index_storage;
+    //Storage behind Vertices()/Indices() when the mesh came from the cache
+    std::shared_ptr<MeshCacheFile> cache;
+};
 
 /** ImportOBJ is a basic class that facilitates creating BasicShape objects
  *  from  *.obj and *.mtl files generated using a program like Blender.
- *  Exported faces need to be triangulated for this class to work properly.
+ *  Files are memory-mapped and scanned in place with a pointer-based tokenizer,
+ *  so parsing does no per-line heap allocation.  Faces with more than three
+ *  corners are split into a triangle fan.
+ *  The importer only holds settings: all per-load state lives in the call, so
+ *  one importer can read several models on different threads at the same time.
  **/  
 class ImportOBJ{
     public:
@@ -21,28 +134,49 @@ class ImportOBJ{
           * Position (3xfloat values)
           * Surface Normal (3xfloat values)
           * Texture Coordinates (2xfloat values)
-          * Color (3xfloat values)
-          * Specular Color (3xfloat values)
+          * Material index (1xunsigned int, an integer attribute)
+          * The materials are uploaded as the shape's material table.
+          * The Shape is indexed: shared corners are stored once and drawn
+          * with glDrawElements (16-bit indices when there are fewer than 65536 vertices).
+          * Triangles and vertices are reordered for the vertex cache unless optimizeMeshes is false.
+          * Unless generateLODs is false, simplified levels of detail follow the full mesh in the
+          * index buffer (see BasicShape::Draw(transform, view)).
+          * If textures is not NULL, it receives one texture per map_Kd entry.
+          *  */
+        BasicShape loadFiles(std::string name_without_file_extension, VAOStruct vao,
+                             std::vector<unsigned int> *textures = NULL) const;
+        /** Reads a model into mesh without making any OpenGL calls: from the
+          * .meshbin cache when it is up to date, otherwise by parsing the
+          * .OBJ/.MTL files (and then writing the cache).  Returns false if the
+          * .OBJ file could not be read.
           *  */
-        BasicShape loadFiles(std::string name_without_file_extension, VAOStruct vao);
+        bool readMesh(std::string name_without_file_extension, ImportedMesh &mesh) const;
+        /** Parses the .OBJ/.MTL files into mesh (never uses the cache, no OpenGL
+          * calls).  Returns false if the .OBJ file could not be read.
+          *  */
+        bool parseFiles(std::string name_without_file_extension, ImportedMesh &mesh) const;
+        /** Creates a Shape from an imported mesh (must run on the OpenGL context thread) */
+        static BasicShape genShape(const ImportedMesh &mesh, VAOStruct vao);
+        /** Prints a summary of how a mesh was loaded and how much GPU memory it uses */
+        static void printSummary(const ImportedMesh &mesh);
         bool debugOutput = false;
+        //When true, readMesh reads <name>.meshbin if it is up to date with the
+        // .OBJ/.MTL files and writes one after every text import
+        bool useCache = true;
 
-        int getNumCombined();
-        unsigned int getTexture(int index = 0);
-        std::vector<unsigned int> getAllTextures();
+        //Number of threads used to parse a single .OBJ file that is at least
+        // PARALLEL_PARSE_MIN_BYTES long.  The result does not depend on this setting.
+        int parseThreads = ThreadPool::HardwareThreads();
+        //When true, meshes use CompactVertex instead of CompleteVertex
+        bool compactVertices = false;
+        //When true, parsed meshes are reordered for the GPU (see mesh_optimizer.hpp).
+        // A cache written with another value of this (or of compactVertices or generateLODs)
+        // is rebuilt.
+        bool optimizeMeshes = true;
+        //When true, parsed meshes get up to MAX_MESH_LODS levels of detail (see mesh_simplifier.hpp)
+        bool generateLODs = true;
 
     private:
-        struct CompleteVertex {
-            glm::vec3 Position;
-            glm::vec3 Normal;
-            glm::vec2 TexCoords;
-            glm::vec3 aColor;
-            glm::vec3 Color;
-            glm::vec3 sColor;
-            float opacity = 1.0;
-            float texture_index=99.0;
-        };
-
         struct Material {
             std::string material_name;
             glm::vec3 ambient = glm::vec3(1.0);
@@ -52,29 +186,100 @@ class ImportOBJ{
             int illumination_model = -1;
             bool textured = false;
             int texture_index = 99;
+            //Row of the model's material table
+            int table_index = 0;
+        };
+
+        //Identifies a face corner: one vertex is created per unique combination of
+        // position, texture coordinate, normal, and material.
+        struct VertexKey {
+            int position_index;
+            int texture_index;
+            int normal_index;
+            const Material *material;
+            bool operator==(const VertexKey &other) const {
+                return position_index == other.position_index && texture_index == other.texture_index &&
+                       normal_index == other.normal_index && material == other.material;
+            }
+        };
+
+        struct VertexKeyHash {
+            size_t operator()(const VertexKey &key) const;
+        };
+
+        //Everything built up while parsing one model
+        struct ParseState {
+            //Used for faces that appear before any (valid) usemtl line
+            Material default_material;
+            //Texture file for each map_Kd entry
+            std::vector<std::string> texture_paths;
+
+            std::vector<glm::vec3> vertices;
+            std::vector<glm::vec3> normals;
+            std::vector<glm::vec2> textCoords;
+            bool compact_vertices = false;
+            std::vector<CompleteVertex> combinedData;
+            //Used instead of combinedData for compact vertices
+            std::vector<CompactVertex> compactData;
+            //Index buffer into combinedData (three entries per triangle)
+            std::vector<unsigned int> indices;
+            std::map<std::string,Material> material_map;
+        };
+
+        //A line-aligned part of an .OBJ file.  Chunks are parsed independently and
+        // then merged in file order, which gives the same result as one serial pass.
+        struct ParseChunk {
+            const char *begin = NULL;
+            const char *end = NULL;
+            //Number of elements (including the placeholders) read before this chunk
+            size_t vertex_base = 0;
+            size_t normal_base = 0;
+            size_t texture_base = 0;
+            //Material in effect at the start of the chunk, and while it is parsed
+            const Material *curMat = NULL;
+            const Material *default_material = NULL;
+            //Set by the counting pass
+            size_t vertex_count = 0;
+            size_t normal_count = 0;
+            size_t texture_count = 0;
+            bool changes_material = false;
+            const Material *last_material = NULL;
+
+            std::vector<glm::vec3> vertices;
+            std::vector<glm::vec3> normals;
+            std::vector<glm::vec2> textCoords;
+            //Unique face corners of this chunk in the order they are first seen
+            std::vector<VertexKey> keys;
+            //Index buffer into keys (three entries per triangle)
+            std::vector<unsigned int> indices;
+            //Maps each face corner already seen in this chunk to its index in keys
+            std::unordered_map<VertexKey,unsigned int,VertexKeyHash> key_lookup;
         };
 
-        void readMTLFile(std::string fName);
-        void readOBJFile(std::string fName);
-        BasicShape genShape(VAOStruct vao);
-        void reset();
-        void PrintMaterials();
-        
-        Material *curMat = NULL;
-
-        std::vector<unsigned int> textures;
-
-        std::vector<glm::vec3> vertices;
-        std::vector<glm::vec3> normals;
-        std::vector<glm::vec2> textCoords;
-        std::vector<CompleteVertex> combinedData;
-        std::map<std::string,Material> material_map;
+        bool readMTLFile(std::string fName, ParseState &state) const;
+        bool readOBJFile(std::string fName, ParseState &state) const;
+        //Counts the elements and finds the last usemtl of a chunk (first pass)
+        static void countChunk(const ParseState &state, ParseChunk &chunk);
+        //Parses the elements and faces of a chunk (second pass)
+        static void parseChunk(const ParseState &state, ParseChunk &chunk);
+        //Builds the complete vertex for a face corner
+        static CompleteVertex buildVertex(const ParseState &state, const VertexKey &key);
+        //Builds the compact vertex for a face corner
+        static CompactVertex buildCompactVertex(const ParseState &state, const VertexKey &key);
+        //Fills mesh from an up-to-date .meshbin file; returns false on a cache miss
+        bool readCacheFile(std::string baseName, ImportedMesh &mesh) const;
+        //Returns the MESH_CACHE_* flags of the import settings (compactVertices,
+        // optimizeMeshes, generateLODs)
+        uint32_t cacheFlags() const;
+        //Saves a parsed mesh as a .meshbin file next to the model
+        void writeCacheFile(std::string baseName, const ImportedMesh &mesh) const;
+        void PrintMaterials(const ParseState &state) const;
     
-        void readLineFace(std::string line);
-        void readFace(std::string lineSegment);
-        float getFloat (std::string line);
-        glm::vec3 getVec3(std::string line);
-        glm::vec2 getVec2(std::string line);
+        //Parses the corners of an "f" line (cursor points just past the "f")
+        static void readLineFace(ParseChunk &chunk, const char *cursor, const char *line_end);
+        //Appends the index of one face corner given its (already resolved) OBJ indices,
+        // adding a new key only the first time the corner is seen in the chunk
+        static void readFace(ParseChunk &chunk, int position_index, int texture_index, int normal_index);
 };
 
 
@@ -0,0 +1,147 @@
+#include "mapped_file.hpp"
+
+#include <fstream>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile() {
+}
+
+MappedFile::~MappedFile() {
+    this->Close();
+}
+
+bool MappedFile::Open(const std::string &path) {
+    this->Close();
+
+#ifdef _WIN32
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL | FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        return false;
+    }
+    LARGE_INTEGER file_size;
+    if (!GetFileSizeEx(file, &file_size)) {
+        CloseHandle(file);
+        return false;
+    }
+    this->size = (size_t)file_size.QuadPart;
+    this->is_open = true;
+    //An empty file cannot be mapped, but it is still a valid (empty) file
+    if (this->size == 0) {
+        CloseHandle(file);
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (mapping != NULL) {
+        void *view = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+        if (view != NULL) {
+            this->file_handle = file;
+            this->mapping_handle = mapping;
+            this->data = static_cast<const char*>(view);
+            this->is_mapped = true;
+            return true;
+        }
+        CloseHandle(mapping);
+    }
+    CloseHandle(file);
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat file_info;
+    if (fstat(fd, &file_info) != 0) {
+        close(fd);
+        return false;
+    }
+    this->size = (size_t)file_info.st_size;
+    this->is_open = true;
+    if (this->size == 0) {
+        close(fd);
+        return true;
+    }
+    void *view = mmap(NULL, this->size, PROT_READ, MAP_PRIVATE, fd, 0);
+    //The mapping keeps its own reference to the file
+    close(fd);
+    if (view != MAP_FAILED) {
+#ifdef MADV_SEQUENTIAL
+        madvise(view, this->size, MADV_SEQUENTIAL);
+#endif
+        this->data = static_cast<const char*>(view);
+        this->is_mapped = true;
+        return true;
+    }
+#endif
+
+    //Mapping failed: read the whole file into memory instead
+    std::ifstream infile(path.c_str(), std::ios::binary);
+    if (infile.fail()) {
+        this->Close();
+        return false;
+    }
+    this->fallback.resize(this->size);
+    infile.read(this->fallback.data(), this->size);
+    this->size = (size_t)infile.gcount();
+    this->data = this->fallback.data();
+    return true;
+}
+
+void MappedFile::Close() {
+    if (this->is_mapped) {
+#ifdef _WIN32
+        UnmapViewOfFile(this->data);
+        CloseHandle((HANDLE)this->mapping_handle);
+        CloseHandle((HANDLE)this->file_handle);
+        this->mapping_handle = nullptr;
+        this->file_handle = nullptr;
+#else
+        munmap((void*)this->data, this->size);
+#endif
+    }
+    this->fallback.clear();
+    this->data = nullptr;
+    this->size = 0;
+    this->is_open = false;
+    this->is_mapped = false;
+}
+
+const char* MappedFile::Data() const {
+    return this->data;
+}
+
+size_t MappedFile::Size() const {
+    return this->size;
+}
+
+bool MappedFile::IsOpen() const {
+    return this->is_open;
+}
+
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed) {
+    const unsigned char *bytes = static_cast<const unsigned char*>(data);
+    uint64_t hash = seed;
+    for (size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
+
+uint64_t HashFile(const std::string &path) {
+    MappedFile file;
+    if (!file.Open(path)) {
+        return 0;
+    }
+    return HashBytes(file.Data(), file.Size());
+}
@@ -0,0 +1,61 @@
+#ifndef MAPPED_FILE_HPP
+#define MAPPED_FILE_HPP
+
+#include <string>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+//MappedFile gives read-only access to the contents of a file without copying it
+// through a stream.  The file is memory-mapped (mmap on Linux/macOS, MapViewOfFile
+// on Windows); if mapping is not possible the file is read into a buffer instead so
+// callers always get one contiguous block of characters.
+class MappedFile {
+    public:
+        //Constructor for an empty (closed) MappedFile
+        MappedFile();
+        //Unmaps the file if it is still open
+        ~MappedFile();
+
+        //Maps the file at the given path.  Returns false (and leaves the object closed)
+        // if the file does not exist or cannot be read.
+        bool Open(const std::string &path);
+
+        //Unmaps the file and releases any handles.
+        void Close();
+
+        //Returns a pointer to the first byte of the file (nullptr if closed or empty)
+        const char* Data() const;
+        //Returns the number of bytes in the file
+        size_t Size() const;
+        //Returns true if a file is currently open
+        bool IsOpen() const;
+
+    private:
+        //A mapping owns OS handles, so it is not copied
+        MappedFile(const MappedFile&) = delete;
+        MappedFile& operator=(const MappedFile&) = delete;
+
+        const char *data = nullptr;
+        size_t size = 0;
+        bool is_open = false;
+        bool is_mapped = false;
+        //Used when the file could not be mapped
+        std::vector<char> fallback;
+#ifdef _WIN32
+        void *file_handle = nullptr;
+        void *mapping_handle = nullptr;
+#endif
+};
+
+//Starting value of HashBytes
+const uint64_t HASH_SEED = 0xcbf29ce484222325ULL;
+
+//Returns a 64-bit FNV-1a hash of a block of bytes.  Passing the hash of one block as
+// the seed for the next gives the hash of both blocks back to back.
+uint64_t HashBytes(const void *data, size_t size, uint64_t seed = HASH_SEED);
+
+//Returns the HashBytes value of a file's contents (0 if the file cannot be read)
+uint64_t HashFile(const std::string &path);
+
+#endif //MAPPED_FILE_HPP
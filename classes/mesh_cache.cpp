@@ -0,0 +1,212 @@
+#include "mesh_cache.hpp"
+
+#include <fstream>
+#include <filesystem>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+
+static const char MESH_CACHE_MAGIC[8] = {'M','E','S','H','B','I','N','\0'};
+
+// Blobs start on 16-byte boundaries so the mapped data is suitably aligned
+static uint64_t AlignOffset(uint64_t offset) {
+    return (offset + 15) & ~(uint64_t)15;
+}
+
+MeshCacheFile::MeshCacheFile() {
+}
+
+bool MeshCacheFile::Stamp(const std::string &path, SourceStamp &stamp, bool with_hash) {
+    namespace fs = std::filesystem;
+    std::error_code error;
+    stamp.size = 0;
+    stamp.modified = 0;
+    stamp.hash = 0;
+    uintmax_t size = fs::file_size(path, error);
+    if (error) {
+        // A missing source (e.g. a model without a .mtl) is recorded as all zeros
+        return false;
+    }
+    fs::file_time_type modified = fs::last_write_time(path, error);
+    stamp.size = (uint64_t)size;
+    stamp.modified = error ? 0 : (int64_t)modified.time_since_epoch().count();
+    if (with_hash) {
+        stamp.hash = HashFile(path);
+    }
+    return true;
+}
+
+bool MeshCacheFile::Matches(const std::string &path, const SourceStamp &stored) {
+    SourceStamp current;
+    Stamp(path, current, false);
+    if (current.size != stored.size) {
+        return false;
+    }
+    if (current.modified == stored.modified) {
+        return true;
+    }
+    // Same size but touched since the cache was written: compare the contents
+    return HashFile(path) == stored.hash;
+}
+
+bool MeshCacheFile::Open(const std::string &cache_path, const std::string &obj_path,
+                         const std::string &mtl_path, uint32_t vertex_stride, uint32_t import_flags) {
+    this->header = nullptr;
+    if (!this->file.Open(cache_path) || this->file.Size() < sizeof(Header)) {
+        this->file.Close();
+        return false;
+    }
+
+    const Header *candidate = reinterpret_cast<const Header*>(this->file.Data());
+    uint64_t file_size = this->file.Size();
+    bool valid = memcmp(candidate->magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC)) == 0 &&
+                 candidate->version == MESH_CACHE_VERSION &&
+                 candidate->vertex_stride == vertex_stride &&
+                 candidate->import_flags == import_flags &&
+                 (candidate->index_size == 2 || candidate->index_size == 4) &&
+                 candidate->vertex_offset + (uint64_t)candidate->vertex_count * candidate->vertex_stride <= file_size &&
+                 candidate->index_offset + (uint64_t)candidate->index_count * candidate->index_size <= file_size &&
+                 candidate->material_offset + (uint64_t)candidate->material_count * sizeof(MeshCacheMaterial) <= file_size &&
+                 candidate->texture_offset + candidate->texture_bytes <= file_size &&
+                 candidate->lod_count <= (uint32_t)MAX_MESH_LODS;
+    for (uint32_t i = 0; valid && i < candidate->lod_count; i++) {
+        valid = (uint64_t)candidate->lods[i].index_offset + candidate->lods[i].index_count <= candidate->index_count;
+    }
+    if (!valid || !Matches(obj_path, candidate->obj) || !Matches(mtl_path, candidate->mtl)) {
+        this->file.Close();
+        return false;
+    }
+    this->header = candidate;
+    return true;
+}
+
+const void* MeshCacheFile::Vertices() const {
+    return this->file.Data() + this->header->vertex_offset;
+}
+
+uint32_t MeshCacheFile::VertexCount() const {
+    return this->header->vertex_count;
+}
+
+const void* MeshCacheFile::Indices() const {
+    return this->file.Data() + this->header->index_offset;
+}
+
+uint32_t MeshCacheFile::IndexCount() const {
+    return this->header->index_count;
+}
+
+uint32_t MeshCacheFile::IndexSize() const {
+    return this->header->index_size;
+}
+
+std::vector<MeshCacheLOD> MeshCacheFile::LODs() const {
+    return std::vector<MeshCacheLOD>(this->header->lods, this->header->lods + this->header->lod_count);
+}
+
+const MeshCacheMaterial* MeshCacheFile::Materials() const {
+    return reinterpret_cast<const MeshCacheMaterial*>(this->file.Data() + this->header->material_offset);
+}
+
+uint32_t MeshCacheFile::MaterialCount() const {
+    return this->header->material_count;
+}
+
+std::vector<std::string> MeshCacheFile::TexturePaths() const {
+    // Paths are stored back to back, each followed by a '\0'
+    std::vector<std::string> paths;
+    const char *cursor = this->file.Data() + this->header->texture_offset;
+    const char *end = cursor + this->header->texture_bytes;
+    while (cursor < end && paths.size() < this->header->texture_count) {
+        const char *terminator = static_cast<const char*>(memchr(cursor, '\0', end - cursor));
+        if (terminator == NULL) {
+            break;
+        }
+        paths.push_back(std::string(cursor, terminator));
+        cursor = terminator + 1;
+    }
+    return paths;
+}
+
+glm::vec3 MeshCacheFile::BoundsMin() const {
+    return glm::vec3(this->header->bounds_min[0], this->header->bounds_min[1], this->header->bounds_min[2]);
+}
+
+glm::vec3 MeshCacheFile::BoundsMax() const {
+    return glm::vec3(this->header->bounds_max[0], this->header->bounds_max[1], this->header->bounds_max[2]);
+}
+
+double MeshCacheFile::ParseMilliseconds() const {
+    return this->header->parse_ms;
+}
+
+bool MeshCacheFile::Write(const std::string &cache_path, const std::string &obj_path,
+                          const std::string &mtl_path, const MeshCacheContents &contents) {
+    Header header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, MESH_CACHE_MAGIC, sizeof(MESH_CACHE_MAGIC));
+    header.version = MESH_CACHE_VERSION;
+    header.vertex_stride = contents.vertex_stride;
+    header.import_flags = contents.import_flags;
+    Stamp(obj_path, header.obj, true);
+    Stamp(mtl_path, header.mtl, true);
+    header.vertex_count = contents.vertex_count;
+    header.index_count = contents.index_count;
+    header.index_size = contents.index_size;
+    header.lod_count = std::min(contents.lods.size(), (size_t)MAX_MESH_LODS);
+    for (uint32_t i = 0; i < header.lod_count; i++) {
+        header.lods[i] = contents.lods[i];
+    }
+    header.material_count = contents.materials.size();
+    header.texture_count = contents.texture_paths.size();
+    for (const std::string &path : contents.texture_paths) {
+        header.texture_bytes += path.size() + 1;
+    }
+    header.vertex_offset = AlignOffset(sizeof(Header));
+    header.index_offset = AlignOffset(header.vertex_offset + (uint64_t)header.vertex_count * header.vertex_stride);
+    header.material_offset = AlignOffset(header.index_offset + (uint64_t)header.index_count * header.index_size);
+    header.texture_offset = AlignOffset(header.material_offset + (uint64_t)header.material_count * sizeof(MeshCacheMaterial));
+    for (int i = 0; i < 3; i++) {
+        header.bounds_min[i] = contents.bounds_min[i];
+        header.bounds_max[i] = contents.bounds_max[i];
+    }
+    header.parse_ms = contents.parse_ms;
+
+    // Write to a temporary file first so an interrupted write never leaves a
+    // truncated cache behind
+    std::string temporary_path = cache_path + ".tmp";
+    {
+        std::ofstream outfile(temporary_path.c_str(), std::ios::binary | std::ios::trunc);
+        if (outfile.fail()) {
+            return false;
+        }
+        const char padding[16] = {0};
+        uint64_t written = 0;
+        auto write_block = [&](uint64_t offset, const void *data, uint64_t bytes) {
+            outfile.write(padding, offset - written);
+            outfile.write(static_cast<const char*>(data), bytes);
+            written = offset + bytes;
+        };
+        write_block(0, &header, sizeof(header));
+        write_block(header.vertex_offset, contents.vertices, (uint64_t)header.vertex_count * header.vertex_stride);
+        write_block(header.index_offset, contents.indices, (uint64_t)header.index_count * header.index_size);
+        write_block(header.material_offset, contents.materials.data(), header.material_count * sizeof(MeshCacheMaterial));
+        outfile.write(padding, header.texture_offset - written);
+        for (const std::string &path : contents.texture_paths) {
+            outfile.write(path.c_str(), path.size() + 1);
+        }
+        if (outfile.fail()) {
+            outfile.close();
+            std::remove(temporary_path.c_str());
+            return false;
+        }
+    }
+
+    std::error_code error;
+    std::filesystem::rename(temporary_path, cache_path, error);
+    if (error) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,145 @@
+#ifndef MESH_CACHE_HPP
+#define MESH_CACHE_HPP
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <glm/glm.hpp>
+#include "mapped_file.hpp"
+
+//Bump whenever the layout of a .meshbin file (or of the vertices stored in it, or
+// their order) changes
+const uint32_t MESH_CACHE_VERSION = 7;
+
+//Import settings a cache file was written with (MeshCacheContents::import_flags).  A cache
+// written with other settings is rebuilt.
+const uint32_t MESH_CACHE_COMPACT_VERTICES = 1;
+const uint32_t MESH_CACHE_OPTIMIZED = 2;
+const uint32_t MESH_CACHE_LODS = 4;
+
+//Most levels of detail a cached mesh can have (including the full mesh)
+const int MAX_MESH_LODS = 4;
+
+//Extension of the binary cache written next to each imported model
+const std::string MESH_CACHE_EXTENSION = ".meshbin";
+
+//A material as stored in the cache's material table
+struct MeshCacheMaterial {
+    float ambient[3];
+    float diffuse[3];
+    float specular[3];
+    float opacity;
+    int32_t texture_index;
+    char name[64];
+};
+
+//One level of detail: a range of the index buffer
+struct MeshCacheLOD {
+    //First index and number of indices of the level
+    uint32_t index_offset;
+    uint32_t index_count;
+    //Largest distance (in model units) from a vertex of the level to the planes of the full
+    // mesh's triangles it replaced (see SimplifyMesh)
+    float error;
+    uint32_t padding;
+};
+
+//Everything needed to write a cache file.  The pointers are only read during the call.
+struct MeshCacheContents {
+    const void *vertices = nullptr;
+    uint32_t vertex_count = 0;
+    uint32_t vertex_stride = 0;
+    //MESH_CACHE_* flags of the settings the mesh was imported with
+    uint32_t import_flags = 0;
+    const void *indices = nullptr;
+    uint32_t index_count = 0;
+    uint32_t index_size = 0;
+    //At most MAX_MESH_LODS ranges of indices (empty when the mesh has a single level)
+    std::vector<MeshCacheLOD> lods;
+    std::vector<MeshCacheMaterial> materials;
+    std::vector<std::string> texture_paths;
+    glm::vec3 bounds_min = glm::vec3(0.0f);
+    glm::vec3 bounds_max = glm::vec3(0.0f);
+    //How long the text import took (reported when the cache is used later)
+    double parse_ms = 0.0;
+};
+
+//MeshCacheFile reads a .meshbin file: a versioned binary snapshot of an imported
+// model (vertex/index blobs, levels of detail, material table, texture path list,
+// and bounds).  The
+// file is memory-mapped, so the vertex and index pointers can be handed straight to
+// glBufferData.  A cache is only accepted when it was written with the same import
+// settings from the same .obj/.mtl files: their size and modification time must match,
+// or (when only the time differs) their content hash.
+class MeshCacheFile {
+    public:
+        MeshCacheFile();
+
+        //Opens and validates a cache file.  Returns false if the file is missing,
+        // damaged, from another version / vertex layout / import settings, or older than
+        // its sources.
+        bool Open(const std::string &cache_path, const std::string &obj_path,
+                  const std::string &mtl_path, uint32_t vertex_stride, uint32_t import_flags);
+
+        const void* Vertices() const;
+        uint32_t VertexCount() const;
+        const void* Indices() const;
+        uint32_t IndexCount() const;
+        //Bytes per index (2 or 4)
+        uint32_t IndexSize() const;
+        //Index ranges of the levels of detail (empty when the mesh has a single level)
+        std::vector<MeshCacheLOD> LODs() const;
+        const MeshCacheMaterial* Materials() const;
+        uint32_t MaterialCount() const;
+        std::vector<std::string> TexturePaths() const;
+        glm::vec3 BoundsMin() const;
+        glm::vec3 BoundsMax() const;
+        double ParseMilliseconds() const;
+
+        //Writes a cache file for the given sources.  Returns false on I/O errors.
+        static bool Write(const std::string &cache_path, const std::string &obj_path,
+                          const std::string &mtl_path, const MeshCacheContents &contents);
+
+    private:
+        struct SourceStamp {
+            uint64_t size;
+            int64_t modified;
+            uint64_t hash;
+        };
+
+        struct Header {
+            char magic[8];
+            uint32_t version;
+            uint32_t vertex_stride;
+            uint32_t import_flags;
+            uint32_t flags_padding;
+            SourceStamp obj;
+            SourceStamp mtl;
+            uint32_t vertex_count;
+            uint32_t index_count;
+            uint32_t index_size;
+            uint32_t material_count;
+            uint32_t texture_count;
+            uint32_t texture_bytes;
+            uint32_t lod_count;
+            uint32_t lod_padding;
+            MeshCacheLOD lods[MAX_MESH_LODS];
+            uint64_t vertex_offset;
+            uint64_t index_offset;
+            uint64_t material_offset;
+            uint64_t texture_offset;
+            float bounds_min[3];
+            float bounds_max[3];
+            double parse_ms;
+        };
+
+        //Fills in size and time (and the hash if requested) of a source file
+        static bool Stamp(const std::string &path, SourceStamp &stamp, bool with_hash);
+        //Checks a stored stamp against the file currently on disk
+        static bool Matches(const std::string &path, const SourceStamp &stored);
+
+        MappedFile file;
+        const Header *header = nullptr;
+};
+
+#endif //MESH_CACHE_HPP
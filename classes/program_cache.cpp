@@ -0,0 +1,183 @@
+#include "program_cache.hpp"
+#include "mapped_file.hpp"
+
+#include <glad/glad.h>
+#include <GLFW/glfw3.h>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <filesystem>
+#include <vector>
+
+// The OpenGL 3.3 loader has neither the constants nor the functions of program binaries
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+typedef void (APIENTRYP GetProgramBinaryFunction)(GLuint program, GLsizei buffer_size, GLsizei *length,
+                                                   GLenum *binary_format, void *binary);
+typedef void (APIENTRYP ProgramBinaryFunction)(GLuint program, GLenum binary_format, const void *binary,
+                                                GLsizei length);
+typedef void (APIENTRYP ProgramParameteriFunction)(GLuint program, GLenum name, GLint value);
+
+static const char PROGRAM_CACHE_MAGIC[4] = {'P', 'R', 'G', 'B'};
+
+//Fixed-size header at the start of a cache file (followed by the binary)
+struct ProgramCacheHeader {
+    char magic[4];
+    uint32_t version;
+    uint32_t binary_format;
+    uint32_t binary_length;
+};
+
+struct ProgramBinaryFunctions {
+    bool loaded = false;
+    bool supported = false;
+    GetProgramBinaryFunction get_program_binary = nullptr;
+    ProgramBinaryFunction program_binary = nullptr;
+    ProgramParameteriFunction program_parameteri = nullptr;
+};
+
+static bool HasExtension(const char *name) {
+    GLint count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (GLint i = 0; i < count; i++) {
+        const GLubyte *extension = glGetStringi(GL_EXTENSIONS, i);
+        if (extension != NULL && strcmp(reinterpret_cast<const char*>(extension), name) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+static ProgramBinaryFunctions& Functions() {
+    static ProgramBinaryFunctions functions;
+    if (functions.loaded) {
+        return functions;
+    }
+    functions.loaded = true;
+    GLint major = 0;
+    GLint minor = 0;
+    glGetIntegerv(GL_MAJOR_VERSION, &major);
+    glGetIntegerv(GL_MINOR_VERSION, &minor);
+    if (major < 4 || (major == 4 && minor < 1)) {
+        if (!HasExtension("GL_ARB_get_program_binary")) {
+            return functions;
+        }
+    }
+    functions.get_program_binary = (GetProgramBinaryFunction)glfwGetProcAddress("glGetProgramBinary");
+    functions.program_binary = (ProgramBinaryFunction)glfwGetProcAddress("glProgramBinary");
+    functions.program_parameteri = (ProgramParameteriFunction)glfwGetProcAddress("glProgramParameteri");
+    // Some drivers support the functions but no binary format, which makes them useless
+    GLint formats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+    functions.supported = functions.get_program_binary != nullptr && functions.program_binary != nullptr &&
+                          functions.program_parameteri != nullptr && formats > 0;
+    return functions;
+}
+
+static uint64_t HashString(const char *text, uint64_t seed) {
+    if (text == NULL) {
+        return seed;
+    }
+    return HashBytes(text, strlen(text) + 1, seed);
+}
+
+bool ProgramBinariesSupported() {
+    return Functions().supported;
+}
+
+std::string ProgramCachePath(const std::string &vertex_code, const std::string &fragment_code) {
+    uint64_t hash = HashBytes(&PROGRAM_CACHE_VERSION, sizeof(PROGRAM_CACHE_VERSION));
+    hash = HashString(vertex_code.c_str(), hash);
+    hash = HashString(fragment_code.c_str(), hash);
+    hash = HashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)), hash);
+    hash = HashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), hash);
+    hash = HashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)), hash);
+    char name[32];
+    snprintf(name, sizeof(name), "%016llx.progbin", (unsigned long long)hash);
+    return PROGRAM_CACHE_DIRECTORY + "/" + name;
+}
+
+void MarkProgramRetrievable(unsigned int program) {
+    if (ProgramBinariesSupported()) {
+        Functions().program_parameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+bool LoadProgramBinary(unsigned int program, const std::string &path) {
+    if (!ProgramBinariesSupported()) {
+        return false;
+    }
+    MappedFile file;
+    if (!file.Open(path) || file.Size() < sizeof(ProgramCacheHeader)) {
+        return false;
+    }
+    ProgramCacheHeader header;
+    memcpy(&header, file.Data(), sizeof(header));
+    if (memcmp(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != PROGRAM_CACHE_VERSION ||
+        file.Size() != sizeof(header) + (size_t)header.binary_length) {
+        return false;
+    }
+    Functions().program_binary(program, header.binary_format, file.Data() + sizeof(header), header.binary_length);
+    // The driver refuses binaries it can no longer use (after an update, for example)
+    GLint linked = 0;
+    glGetProgramiv(program, GL_LINK_STATUS, &linked);
+    return linked != 0;
+}
+
+bool SaveProgramBinary(unsigned int program, const std::string &path) {
+    if (!ProgramBinariesSupported()) {
+        return false;
+    }
+    GLint length = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) {
+        return false;
+    }
+    std::vector<char> binary(length);
+    GLenum binary_format = 0;
+    GLsizei written_length = 0;
+    Functions().get_program_binary(program, length, &written_length, &binary_format, binary.data());
+    if (written_length <= 0) {
+        return false;
+    }
+
+    ProgramCacheHeader header;
+    memcpy(header.magic, PROGRAM_CACHE_MAGIC, sizeof(header.magic));
+    header.version = PROGRAM_CACHE_VERSION;
+    header.binary_format = binary_format;
+    header.binary_length = written_length;
+
+    std::error_code error;
+    std::filesystem::create_directories(PROGRAM_CACHE_DIRECTORY, error);
+    // Write to a temporary file first so an interrupted write never leaves a
+    // truncated cache behind
+    std::string temporary_path = path + ".tmp";
+    {
+        std::ofstream outfile(temporary_path.c_str(), std::ios::binary | std::ios::trunc);
+        if (outfile.fail()) {
+            return false;
+        }
+        outfile.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        outfile.write(binary.data(), written_length);
+        if (outfile.fail()) {
+            outfile.close();
+            std::remove(temporary_path.c_str());
+            return false;
+        }
+    }
+    std::filesystem::rename(temporary_path, path, error);
+    if (error) {
+        std::remove(temporary_path.c_str());
+        return false;
+    }
+    return true;
+}
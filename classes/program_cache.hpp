@@ -0,0 +1,33 @@
+#ifndef PROGRAM_CACHE_HPP
+#define PROGRAM_CACHE_HPP
+
+#include <string>
+#include <cstdint>
+
+//Directory that holds the linked shader programs saved by SaveProgramBinary
+const std::string PROGRAM_CACHE_DIRECTORY = "shaders/cache";
+
+//Changing the layout of a cache file makes older files miss
+const uint32_t PROGRAM_CACHE_VERSION = 1;
+
+//Returns true if the driver can save and load linked programs (OpenGL 4.1 or
+// GL_ARB_get_program_binary).  The functions are looked up the first time this is called,
+// since the OpenGL 3.3 loader does not provide them.
+bool ProgramBinariesSupported();
+
+//Returns the path of the cache file for a program built from the given sources.  The name
+// is a hash of the sources and of the GL vendor, renderer, and version, so editing a shader
+// or changing drivers never loads a stale binary.
+std::string ProgramCachePath(const std::string &vertex_code, const std::string &fragment_code);
+
+//Asks the driver to keep the binary of a program that is about to be linked
+void MarkProgramRetrievable(unsigned int program);
+
+//Loads a saved binary into the program.  Returns false if there is no cache file or the
+// driver rejects it (the program must then be compiled and linked as usual).
+bool LoadProgramBinary(unsigned int program, const std::string &path);
+
+//Saves the binary of a linked program.  Returns false if it could not be written.
+bool SaveProgramBinary(unsigned int program, const std::string &path);
+
+#endif //PROGRAM_CACHE_HPP
@@ -0,0 +1,135 @@
+#include "render_queue.hpp"
+#include "gl_state.hpp"
+#include <algorithm>
+
+RenderQueueStats RenderQueue::frame_stats;
+
+RenderQueue::RenderQueue() {
+}
+
+uint64_t RenderQueue::MakeKey(RenderPass pass, unsigned int program, unsigned int texture, unsigned int mesh) {
+    return ((uint64_t)(pass & 0xF) << 60) |
+           ((uint64_t)(program & 0xFFF) << 48) |
+           ((uint64_t)(texture & 0xFFFFFF) << 24) |
+           (uint64_t)(mesh & 0xFFFFFF);
+}
+
+void RenderQueue::Submit(const DrawItem &item) {
+    this->items.push_back(item);
+}
+
+bool RenderQueue::canInstance(const DrawItem &first, const DrawItem &second) {
+    return first.shape == second.shape && first.program == second.program &&
+           first.object_type == second.object_type && first.texture == second.texture &&
+           first.texture_target == second.texture_target && first.texture_unit == second.texture_unit;
+}
+
+void RenderQueue::Execute(LODView &lod_view, bool instancing) {
+    this->order.clear();
+    for (size_t i = 0; i < this->items.size(); i++) {
+        this->order.push_back(std::make_pair(this->items[i].key, i));
+    }
+    // Draws with equal keys keep their submission order
+    std::sort(this->order.begin(), this->order.end());
+
+    // The state left by earlier passes is unknown, so the first draw sets everything it uses
+    Shader* program = nullptr;
+    UniformHandle shader_state_uniform;
+    UniformHandle model_uniform;
+    UniformHandle local_uniform;
+    UniformHandle instanced_uniform;
+    UniformHandle tint_uniform;
+    int active_unit = -1;
+    unsigned int bound[RENDER_QUEUE_TEXTURE_UNITS] = {0};
+    GLenum bound_target[RENDER_QUEUE_TEXTURE_UNITS] = {0};
+
+    size_t next = 0;
+    while (next < this->order.size()) {
+        const DrawItem &item = this->items[this->order[next].second];
+        // Sorting by key puts the draws of a shape with the same state next to each other
+        size_t run_end = next + 1;
+        if (instancing) {
+            while (run_end < this->order.size() && canInstance(item, this->items[this->order[run_end].second])) {
+                run_end++;
+            }
+        }
+
+        if (item.program != program) {
+            // Programs are left drawing from model and local, untinted, as other code expects
+            instanced_uniform.Set(false);
+            tint_uniform.Set(glm::vec4(1.0));
+            program = item.program;
+            program->use();
+            shader_state_uniform = program->GetUniform("shader_state");
+            model_uniform = program->GetUniform("model");
+            local_uniform = program->GetUniform("local");
+            instanced_uniform = program->GetUniform("instanced");
+            tint_uniform = program->GetUniform("tint");
+            frame_stats.program_changes++;
+        } else {
+            frame_stats.skipped_changes++;
+        }
+        if (item.texture != 0) {
+            int unit = std::max(0, std::min(item.texture_unit, RENDER_QUEUE_TEXTURE_UNITS - 1));
+            if (bound[unit] != item.texture || bound_target[unit] != item.texture_target) {
+                if (active_unit != unit) {
+                    GLState::ActiveTexture(GL_TEXTURE0 + unit);
+                    active_unit = unit;
+                    frame_stats.texture_changes++;
+                }
+                GLState::BindTexture(item.texture_target, item.texture);
+                bound[unit] = item.texture;
+                bound_target[unit] = item.texture_target;
+                frame_stats.texture_changes++;
+            } else {
+                frame_stats.skipped_changes++;
+            }
+        }
+        // Uniforms that already hold the value are skipped by the shader
+        shader_state_uniform.Set(item.object_type);
+
+        if (run_end - next > 1) {
+            this->instances.clear();
+            for (size_t i = next; i < run_end; i++) {
+                const DrawItem &instance = this->items[this->order[i].second];
+                InstanceData data;
+                data.transform = instance.model * instance.local;
+                data.tint = instance.tint;
+                this->instances.push_back(data);
+            }
+            instanced_uniform.Set(true);
+            frame_stats.draw_calls += item.shape->DrawInstanced(this->instances, lod_view);
+            frame_stats.instances += (int)this->instances.size();
+        } else {
+            instanced_uniform.Set(false);
+            model_uniform.Set(item.model);
+            local_uniform.Set(item.local);
+            tint_uniform.Set(item.tint);
+            item.shape->Draw(item.model * item.local, lod_view);
+            frame_stats.draw_calls++;
+        }
+        next = run_end;
+    }
+    instanced_uniform.Set(false);
+    tint_uniform.Set(glm::vec4(1.0));
+
+    if (active_unit > 0) {
+        GLState::ActiveTexture(GL_TEXTURE0);
+    }
+}
+
+const std::vector<DrawItem>& RenderQueue::Items() const {
+    return this->items;
+}
+
+void RenderQueue::Clear() {
+    this->items.clear();
+}
+
+RenderQueueStats RenderQueue::GetFrameStats() {
+    return frame_stats;
+}
+
+void RenderQueue::ResetFrameStats() {
+    frame_stats = RenderQueueStats();
+}
@@ -0,0 +1,100 @@
+#ifndef RENDER_QUEUE_HPP
+#define RENDER_QUEUE_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include "Shader.hpp"
+#include "basic_shape.hpp"
+
+//Passes a draw can belong to, in the order they run (the most significant bits of a sort key)
+enum RenderPass {
+    DEPTH_PASS = 0,
+    COLOR_PASS = 1
+};
+
+//Number of texture units a RenderQueue keeps track of
+const int RENDER_QUEUE_TEXTURE_UNITS = 16;
+
+//A draw submitted to a RenderQueue: the shape, the program and per-object uniforms it is
+// drawn with, and the texture it samples
+struct DrawItem {
+    //Order of the draw (see RenderQueue::MakeKey)
+    uint64_t key = 0;
+    BasicShape* shape = nullptr;
+    Shader* program = nullptr;
+    glm::mat4 model = glm::mat4(1.0);
+    glm::mat4 local = glm::mat4(1.0);
+    //Value of the shader_state uniform (ObjectType; variants compile it in and ignore it)
+    int object_type = 0;
+    //Material override of the draw (the tint uniform, or the instance data of an instanced
+    // draw; see InstanceData)
+    glm::vec4 tint = glm::vec4(1.0);
+    //Texture bound to texture_unit for the draw (0 binds nothing)
+    GLenum texture_target = GL_TEXTURE_2D;
+    unsigned int texture = 0;
+    int texture_unit = 0;
+};
+
+//Draw calls and state changes made by every RenderQueue since the last ResetFrameStats
+struct RenderQueueStats {
+    //Draw calls issued (an instanced draw counts once)
+    int draw_calls = 0;
+    //Draws that were merged into instanced draws
+    int instances = 0;
+    //glUseProgram calls
+    int program_changes = 0;
+    //glBindTexture and glActiveTexture calls
+    int texture_changes = 0;
+    //Program and texture changes that were skipped because the state was already set
+    int skipped_changes = 0;
+};
+
+//RenderQueue collects the draws of a pass, sorts them by key, and executes them in that
+// order.  The key puts the pass first, then the program, the texture, and the mesh, so
+// draws that share state run next to each other, and Execute only changes the program
+// or a texture binding when the next draw needs a different one.  Consecutive draws of
+// the same shape with the same program, texture, and object type are drawn as instances
+// of one instanced draw.
+class RenderQueue {
+    public:
+        RenderQueue();
+
+        //Builds a sort key.  Each field keeps its low bits: pass 4, program 12, texture 24,
+        // mesh 24.
+        static uint64_t MakeKey(RenderPass pass, unsigned int program, unsigned int texture, unsigned int mesh);
+
+        //Adds a draw (its key must already be set)
+        void Submit(const DrawItem &item);
+
+        //Sorts the draws and issues them.  Imported models use the levels of detail chosen by
+        // lod_view, which also counts the triangles drawn.  With instancing off, every draw
+        // is issued on its own.  Texture unit 0 is left active.
+        void Execute(LODView &lod_view, bool instancing = true);
+
+        //Returns the draws submitted since the last Clear, in submission order
+        const std::vector<DrawItem>& Items() const;
+
+        //Removes every draw (the storage is kept for the next frame)
+        void Clear();
+
+        //Returns the draws and state changes of all queues since the last reset (the render
+        // loop resets them every frame)
+        static RenderQueueStats GetFrameStats();
+        static void ResetFrameStats();
+
+    private:
+        std::vector<DrawItem> items;
+        //Sort keys paired with the position of their draw, so the matrices are not moved
+        std::vector<std::pair<uint64_t, size_t>> order;
+        //Instance data of the instanced draw being issued
+        std::vector<InstanceData> instances;
+
+        //True if two draws can be instances of one instanced draw
+        static bool canInstance(const DrawItem &first, const DrawItem &second);
+
+        static RenderQueueStats frame_stats;
+};
+
+#endif //RENDER_QUEUE_HPP
@@ -0,0 +1,106 @@
+#include "scene_graph.hpp"
+#include <glm/gtc/matrix_transform.hpp>
+#include <algorithm>
+
+glm::mat4 SceneTransform::Matrix() const {
+    glm::mat4 matrix = glm::translate(glm::mat4(1.0), this->translation);
+    if (this->rotation.x != 0.0f) {
+        matrix = glm::rotate(matrix, glm::radians(this->rotation.x), glm::vec3(1.0, 0.0, 0.0));
+    }
+    if (this->rotation.y != 0.0f) {
+        matrix = glm::rotate(matrix, glm::radians(this->rotation.y), glm::vec3(0.0, 1.0, 0.0));
+    }
+    if (this->rotation.z != 0.0f) {
+        matrix = glm::rotate(matrix, glm::radians(this->rotation.z), glm::vec3(0.0, 0.0, 1.0));
+    }
+    return glm::scale(matrix, this->scale);
+}
+
+bool operator==(const SceneTransform &first, const SceneTransform &second) {
+    return first.translation == second.translation && first.rotation == second.rotation &&
+           first.scale == second.scale;
+}
+
+bool operator!=(const SceneTransform &first, const SceneTransform &second) {
+    return !(first == second);
+}
+
+SceneGraph::SceneGraph() {
+}
+
+int SceneGraph::AddNode(int parent, const SceneTransform &local) {
+    int node = (int)this->parents.size();
+    // Parents come before their children, which is what lets Update run in one pass
+    if (parent >= node) {
+        parent = -1;
+    }
+    this->parents.push_back(parent);
+    this->locals.push_back(local);
+    this->worlds.push_back(glm::mat4(1.0));
+    this->dirty.push_back(1);
+    this->first_dirty = std::min(this->first_dirty, node);
+    return node;
+}
+
+void SceneGraph::SetLocal(int node, const SceneTransform &local) {
+    if (this->locals[node] == local) {
+        return;
+    }
+    this->locals[node] = local;
+    this->dirty[node] = 1;
+    this->first_dirty = std::min(this->first_dirty, node);
+}
+
+const SceneTransform& SceneGraph::GetLocal(int node) const {
+    return this->locals[node];
+}
+
+const glm::mat4& SceneGraph::World(int node) const {
+    return this->worlds[node];
+}
+
+int SceneGraph::Parent(int node) const {
+    return this->parents[node];
+}
+
+int SceneGraph::NodeCount() const {
+    return (int)this->parents.size();
+}
+
+int SceneGraph::Update() {
+    int count = this->NodeCount();
+    this->last_update_count = 0;
+    // A node's parent has been visited before it, so a dirty parent has already marked the
+    // node's world matrix as stale
+    for (int node = this->first_dirty; node < count; node++) {
+        int parent = this->parents[node];
+        if (parent >= 0 && this->dirty[parent]) {
+            this->dirty[node] = 1;
+        }
+        if (!this->dirty[node]) {
+            continue;
+        }
+        glm::mat4 local = this->locals[node].Matrix();
+        this->worlds[node] = parent >= 0 ? this->worlds[parent] * local : local;
+        this->last_update_count++;
+    }
+    // The flags are cleared once every child has seen its parent's
+    for (int node = this->first_dirty; node < count; node++) {
+        this->dirty[node] = 0;
+    }
+    this->first_dirty = count;
+    return this->last_update_count;
+}
+
+int SceneGraph::LastUpdateCount() const {
+    return this->last_update_count;
+}
+
+void SceneGraph::Clear() {
+    this->parents.clear();
+    this->locals.clear();
+    this->worlds.clear();
+    this->dirty.clear();
+    this->first_dirty = 0;
+    this->last_update_count = 0;
+}
@@ -0,0 +1,64 @@
+#ifndef SCENE_GRAPH_HPP
+#define SCENE_GRAPH_HPP
+
+#include <glm/glm.hpp>
+#include <vector>
+
+//Placement of a node relative to its parent: a translation, rotations (in degrees) about the
+// x, y, and z axes applied in that order, and a scale
+struct SceneTransform {
+    glm::vec3 translation = glm::vec3(0.0);
+    glm::vec3 rotation = glm::vec3(0.0);
+    glm::vec3 scale = glm::vec3(1.0);
+
+    //Returns translate * rotate x * rotate y * rotate z * scale
+    glm::mat4 Matrix() const;
+};
+
+bool operator==(const SceneTransform &first, const SceneTransform &second);
+bool operator!=(const SceneTransform &first, const SceneTransform &second);
+
+//SceneGraph holds a hierarchy of nodes, each with a local transform and a cached world matrix
+// (its parent's world matrix * its local matrix).  The nodes are kept in flat arrays in the
+// order they were added, and a node's parent is always added before it, so Update recomputes
+// every world matrix in one pass from front to back.  Only the nodes whose local transform
+// changed since the last Update, and the nodes below them, are recomputed.
+class SceneGraph {
+    public:
+        SceneGraph();
+
+        //Adds a node below parent (-1 for a root) and returns its index
+        int AddNode(int parent, const SceneTransform &local);
+
+        //Changes a node's local transform.  The node is only marked dirty if the transform
+        // differs from the one it has.
+        void SetLocal(int node, const SceneTransform &local);
+        const SceneTransform& GetLocal(int node) const;
+
+        //Returns the world matrix computed by the last Update
+        const glm::mat4& World(int node) const;
+        int Parent(int node) const;
+        int NodeCount() const;
+
+        //Recomputes the world matrices of the dirty nodes and their descendants, and returns
+        // how many were recomputed
+        int Update();
+        //Returns the number of world matrices the last Update recomputed
+        int LastUpdateCount() const;
+
+        //Removes every node
+        void Clear();
+
+    private:
+        std::vector<int> parents;
+        std::vector<SceneTransform> locals;
+        std::vector<glm::mat4> worlds;
+        //Set for a node whose local transform changed, or whose world matrix was recomputed by
+        // the running Update (so its children are recomputed after it)
+        std::vector<char> dirty;
+        //Lowest dirty node (NodeCount() if none); the nodes before it are left alone
+        int first_dirty = 0;
+        int last_update_count = 0;
+};
+
+#endif //SCENE_GRAPH_HPP
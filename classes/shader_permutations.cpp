@@ -0,0 +1,56 @@
+#include "shader_permutations.hpp"
+#include <algorithm>
+
+//Number of possible keys: object types x directional light x spot light x shadows x effects
+static const int VARIANT_COUNT = OBJECT_TYPE_COUNT * 2 * 2 * 2 * (MAX_POST_PROCESS_SELECTION + 1);
+
+ShaderPermutations::ShaderPermutations(const char* vertex_path, const char* fragment_path) {
+    this->vertex_path = vertex_path;
+    this->fragment_path = fragment_path;
+    this->variants.assign(VARIANT_COUNT, NULL);
+}
+
+ShaderPermutations::~ShaderPermutations() {
+    this->DeallocateShaders();
+}
+
+Shader* ShaderPermutations::Get(ShaderVariantKey key) {
+    key.post_process = std::max(0, std::min(key.post_process, MAX_POST_PROCESS_SELECTION));
+    Shader*& variant = this->variants[Index(key)];
+    if (variant == NULL) {
+        variant = new Shader(this->vertex_path.c_str(), this->fragment_path.c_str(), Defines(key));
+        this->compiled++;
+    }
+    return variant;
+}
+
+std::string ShaderPermutations::Defines(const ShaderVariantKey &key) {
+    std::string defines;
+    defines += "#define OBJECT_TYPE " + std::to_string((int)key.object_type) + "\n";
+    defines += "#define DIRECTIONAL_LIGHT_ON " + std::to_string((int)key.directional_light) + "\n";
+    defines += "#define SPOT_LIGHT_ON " + std::to_string((int)key.spot_light) + "\n";
+    defines += "#define SHADOWS_ON " + std::to_string((int)key.shadows) + "\n";
+    defines += "#define POST_PROCESS_SELECTION " + std::to_string(key.post_process) + "\n";
+    return defines;
+}
+
+int ShaderPermutations::CompiledCount() {
+    return this->compiled;
+}
+
+void ShaderPermutations::DeallocateShaders() {
+    for (Shader*& variant : this->variants) {
+        delete variant;
+        variant = NULL;
+    }
+    this->compiled = 0;
+}
+
+int ShaderPermutations::Index(const ShaderVariantKey &key) {
+    int index = (int)key.object_type;
+    index = index * 2 + (key.directional_light ? 1 : 0);
+    index = index * 2 + (key.spot_light ? 1 : 0);
+    index = index * 2 + (key.shadows ? 1 : 0);
+    index = index * (MAX_POST_PROCESS_SELECTION + 1) + key.post_process;
+    return index;
+}
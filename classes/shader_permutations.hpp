@@ -0,0 +1,63 @@
+#ifndef SHADER_PERMUTATIONS_HPP
+#define SHADER_PERMUTATIONS_HPP
+
+#include "Shader.hpp"
+#include "object_types.hpp"
+#include <string>
+#include <vector>
+
+//Number of ObjectType values
+const int OBJECT_TYPE_COUNT = 4;
+//Largest post_process_selection handled by fragment.glsl (0 is no effect)
+const int MAX_POST_PROCESS_SELECTION = 9;
+
+//Features of the scene program that a variant fixes when it is compiled.  Each one
+// replaces a runtime branch of fragment.glsl and vertex.glsl (shader_state, the lights'
+// "on" flags, the shadow lookup, and post_process_selection) with a constant.
+struct ShaderVariantKey {
+    ObjectType object_type = BASIC;
+    bool directional_light = true;
+    bool spot_light = true;
+    bool shadows = true;
+    int post_process = 0;
+};
+
+//ShaderPermutations compiles specialized variants of one vertex/fragment program.  The
+// variant's #defines (see Defines) are inserted after the #version line of both sources,
+// and each variant is compiled the first time it is requested and kept until
+// DeallocateShaders.  With program binaries, later launches load them from the cache.
+class ShaderPermutations {
+    public:
+        //Constructor for the variants of the program built from the given GLSL files
+        ShaderPermutations(const char* vertex_path, const char* fragment_path);
+        ~ShaderPermutations();
+
+        //Returns the variant for the key, compiling it if it has not been used yet
+        Shader* Get(ShaderVariantKey key);
+
+        //Returns the #define lines of a variant (OBJECT_TYPE, DIRECTIONAL_LIGHT_ON,
+        // SPOT_LIGHT_ON, SHADOWS_ON and POST_PROCESS_SELECTION)
+        static std::string Defines(const ShaderVariantKey &key);
+
+        //Returns the number of variants compiled so far
+        int CompiledCount();
+
+        //Deletes every compiled variant
+        void DeallocateShaders();
+
+    private:
+        //Each variant is compiled once, so the permutations are not copied
+        ShaderPermutations(const ShaderPermutations&) = delete;
+        ShaderPermutations& operator=(const ShaderPermutations&) = delete;
+
+        //Returns the position of the key's variant in variants
+        static int Index(const ShaderVariantKey &key);
+
+        std::string vertex_path;
+        std::string fragment_path;
+        //One entry per possible key (NULL until the variant is compiled)
+        std::vector<Shader*> variants;
+        int compiled = 0;
+};
+
+#endif //SHADER_PERMUTATIONS_HPP
@@ -0,0 +1,316 @@
+#include "static_batch.hpp"
+#include "import_object.hpp"
+#include "gl_state.hpp"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+StaticBatchStats StaticBatch::frame_stats;
+
+// Vertex layouts match when every attribute does (their vertices can share a vertex array)
+static bool sameLayout(const VAOStruct &first, const VAOStruct &second) {
+    if (first.attributes.size() != second.attributes.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < first.attributes.size(); i++) {
+        const AttributePointer &a = first.attributes[i];
+        const AttributePointer &b = second.attributes[i];
+        if (a.number_per_vertex != b.number_per_vertex || a.type_data != b.type_data ||
+            a.normalize_data != b.normalize_data || a.stride_bytes != b.stride_bytes ||
+            a.offset_bytes != b.offset_bytes || a.is_integer != b.is_integer) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Moves a vertex into world space: its position (attribute 0) by the transform, its normal
+// (attribute 1, three floats or GL_INT_2_10_10_10_REV) by the normal matrix, and its material
+// index (the integer attribute, if any) to its mesh's rows of the merged table
+static void transformVertex(unsigned char *vertex, const VAOStruct &layout, const glm::mat4 &transform,
+                            const glm::mat3 &normal_matrix, unsigned int material_base) {
+    glm::vec3 position;
+    memcpy(&position, vertex + layout.attributes[0].offset_bytes, sizeof(position));
+    position = glm::vec3(transform * glm::vec4(position, 1.0f));
+    memcpy(vertex + layout.attributes[0].offset_bytes, &position, sizeof(position));
+
+    if (layout.attributes.size() > 1) {
+        const AttributePointer &normal_attribute = layout.attributes[1];
+        unsigned char *normal_data = vertex + normal_attribute.offset_bytes;
+        if (normal_attribute.type_data == GL_FLOAT && normal_attribute.number_per_vertex == 3) {
+            glm::vec3 normal;
+            memcpy(&normal, normal_data, sizeof(normal));
+            normal = glm::normalize(normal_matrix * normal);
+            memcpy(normal_data, &normal, sizeof(normal));
+        } else if (normal_attribute.type_data == GL_INT_2_10_10_10_REV) {
+            uint32_t packed;
+            memcpy(&packed, normal_data, sizeof(packed));
+            packed = PackNormal(glm::normalize(normal_matrix * UnpackNormal(packed)));
+            memcpy(normal_data, &packed, sizeof(packed));
+        }
+    }
+
+    if (material_base == 0) {
+        return;
+    }
+    for (const AttributePointer &attribute : layout.attributes) {
+        if (!attribute.is_integer) {
+            continue;
+        }
+        unsigned char *index_data = vertex + attribute.offset_bytes;
+        if (attribute.type_data == GL_UNSIGNED_SHORT) {
+            uint16_t index;
+            memcpy(&index, index_data, sizeof(index));
+            index = (uint16_t)(index + material_base);
+            memcpy(index_data, &index, sizeof(index));
+        } else if (attribute.type_data == GL_UNSIGNED_INT) {
+            uint32_t index;
+            memcpy(&index, index_data, sizeof(index));
+            index += material_base;
+            memcpy(index_data, &index, sizeof(index));
+        }
+    }
+}
+
+StaticBatch::StaticBatch() {
+}
+
+void StaticBatch::Build(const std::vector<StaticMesh> &meshes) {
+    this->DeallocateBatch();
+
+    // The vertices of each layout, in world space
+    struct Section {
+        VAOStruct layout;
+        std::vector<unsigned char> vertices;
+        int vertex_count = 0;
+    };
+    std::vector<Section> sections;
+    std::vector<int> group_sections;
+    std::vector<std::vector<unsigned char>> group_tables;
+    // Indices of each mesh (relative to its section) until the index buffer is assembled
+    std::vector<std::vector<unsigned int>> mesh_indices;
+
+    std::vector<unsigned char> vertices;
+    std::vector<unsigned int> indices;
+    std::vector<unsigned char> table;
+    for (const StaticMesh &mesh : meshes) {
+        // A shape without geometry (such as the placeholder of a model that failed to load)
+        // has no buffers to read back, and would only add an empty draw
+        if (mesh.shape->VertexCount() == 0) {
+            continue;
+        }
+        const VAOStruct &layout = mesh.shape->GetVAOStruct();
+        if (layout.attributes.empty() || layout.attributes[0].type_data != GL_FLOAT ||
+            layout.attributes[0].number_per_vertex != 3 || !mesh.shape->ReadGeometry(vertices, indices)) {
+            std::cout << "Static batch: a mesh with an unsupported layout or primitive is drawn on its own" << std::endl;
+            continue;
+        }
+        if (indices.empty()) {
+            continue;
+        }
+        int stride = layout.attributes[0].stride_bytes;
+        int vertex_count = std::min(mesh.shape->VertexCount(), (int)(vertices.size() / stride));
+        mesh.shape->ReadMaterialTable(table);
+        int material_count = (int)(table.size() / sizeof(MaterialTableEntry));
+
+        int section = 0;
+        while (section < (int)sections.size() && !sameLayout(sections[section].layout, layout)) {
+            section++;
+        }
+        if (section == (int)sections.size()) {
+            sections.push_back(Section());
+            sections.back().layout = layout;
+        }
+
+        // A group keeps adding meshes until its merged material table is full
+        int group = 0;
+        for (; group < (int)this->groups.size(); group++) {
+            const StaticBatchGroup &candidate = this->groups[group];
+            if (group_sections[group] == section && candidate.object_type == mesh.object_type &&
+                candidate.texture_target == mesh.texture_target && candidate.texture == mesh.texture &&
+                candidate.texture_unit == mesh.texture_unit &&
+                group_tables[group].empty() == (material_count == 0) &&
+                candidate.material_count + material_count <= MAX_TABLE_MATERIALS) {
+                break;
+            }
+        }
+        if (group == (int)this->groups.size()) {
+            StaticBatchGroup new_group;
+            new_group.object_type = mesh.object_type;
+            new_group.texture_target = mesh.texture_target;
+            new_group.texture = mesh.texture;
+            new_group.texture_unit = mesh.texture_unit;
+            this->groups.push_back(new_group);
+            group_sections.push_back(section);
+            group_tables.push_back(std::vector<unsigned char>());
+        }
+        StaticBatchGroup &batch_group = this->groups[group];
+        unsigned int material_base = batch_group.material_count;
+        group_tables[group].insert(group_tables[group].end(), table.begin(), table.begin() + material_count * sizeof(MaterialTableEntry));
+        batch_group.material_count += material_count;
+
+        glm::mat3 normal_matrix = glm::transpose(glm::inverse(glm::mat3(mesh.transform)));
+        for (int i = 0; i < vertex_count; i++) {
+            transformVertex(&vertices[i * stride], layout, mesh.transform, normal_matrix, material_base);
+        }
+        Section &target = sections[section];
+        for (unsigned int &index : indices) {
+            index += target.vertex_count;
+        }
+        target.vertices.insert(target.vertices.end(), vertices.begin(), vertices.begin() + vertex_count * stride);
+        target.vertex_count += vertex_count;
+
+        StaticBatchMesh record;
+        record.shape = mesh.shape;
+        record.transform = mesh.transform;
+        record.lods = mesh.shape->GetLODs();
+        if (record.lods.empty()) {
+            ShapeLOD level;
+            level.index_count = (int)indices.size();
+            record.lods.push_back(level);
+        }
+        batch_group.meshes.push_back((int)this->meshes.size());
+        this->meshes.push_back(record);
+        mesh_indices.push_back(indices);
+    }
+    if (this->meshes.empty()) {
+        return;
+    }
+
+    // One vertex buffer holds every section; the indices of a group's meshes are adjacent
+    std::vector<unsigned char> merged_vertices;
+    std::vector<size_t> section_offsets;
+    for (const Section &section : sections) {
+        section_offsets.push_back(merged_vertices.size());
+        merged_vertices.insert(merged_vertices.end(), section.vertices.begin(), section.vertices.end());
+    }
+    std::vector<unsigned int> merged_indices;
+    for (const StaticBatchGroup &group : this->groups) {
+        for (int mesh : group.meshes) {
+            int first_index = (int)merged_indices.size();
+            merged_indices.insert(merged_indices.end(), mesh_indices[mesh].begin(), mesh_indices[mesh].end());
+            for (ShapeLOD &level : this->meshes[mesh].lods) {
+                level.first_index += first_index;
+            }
+        }
+    }
+
+    // Both buffers are filled through GL_ARRAY_BUFFER, so no vertex array's index buffer changes
+    glGenBuffers(1, &this->vbo);
+    glBindBuffer(GL_ARRAY_BUFFER, this->vbo);
+    glBufferData(GL_ARRAY_BUFFER, merged_vertices.size(), merged_vertices.data(), GL_STATIC_DRAW);
+    glGenBuffers(1, &this->ebo);
+    glBindBuffer(GL_ARRAY_BUFFER, this->ebo);
+    glBufferData(GL_ARRAY_BUFFER, merged_indices.size() * sizeof(unsigned int), merged_indices.data(), GL_STATIC_DRAW);
+    this->buffer_bytes = (int)(merged_vertices.size() + merged_indices.size() * sizeof(unsigned int));
+
+    // Each section gets a vertex array whose attributes start at the section's vertices
+    for (size_t i = 0; i < sections.size(); i++) {
+        VAOStruct vao = sections[i].layout;
+        for (AttributePointer &attribute : vao.attributes) {
+            attribute.offset_bytes += (int)section_offsets[i];
+        }
+        glGenVertexArrays(1, &vao.id);
+        BindVAO(vao, this->vbo, GL_ARRAY_BUFFER);
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->ebo);
+        GLState::BindVertexArray(0);
+        this->vertex_arrays.push_back(vao.id);
+    }
+
+    for (size_t i = 0; i < this->groups.size(); i++) {
+        StaticBatchGroup &group = this->groups[i];
+        group.vertex_array = this->vertex_arrays[group_sections[i]];
+        if (!group_tables[i].empty()) {
+            glGenBuffers(1, &group.material_table);
+            glBindBuffer(GL_UNIFORM_BUFFER, group.material_table);
+            glBufferData(GL_UNIFORM_BUFFER, group_tables[i].size(), group_tables[i].data(), GL_STATIC_DRAW);
+            this->buffer_bytes += (int)group_tables[i].size();
+        }
+    }
+
+    std::cout << "Static batch: " << this->meshes.size() << " meshes in " << this->groups.size()
+              << " groups (" << this->buffer_bytes / 1024 << " KB)" << std::endl;
+}
+
+bool StaticBatch::Contains(const BasicShape* shape) const {
+    for (const StaticBatchMesh &mesh : this->meshes) {
+        if (mesh.shape == shape) {
+            return true;
+        }
+    }
+    return false;
+}
+
+const std::vector<StaticBatchMesh>& StaticBatch::Meshes() const {
+    return this->meshes;
+}
+
+const std::vector<StaticBatchGroup>& StaticBatch::Groups() const {
+    return this->groups;
+}
+
+int StaticBatch::DrawGroup(int group, const std::vector<char> &visible, LODView &view) {
+    const StaticBatchGroup &batch_group = this->groups[group];
+    this->counts.clear();
+    this->offsets.clear();
+    for (int mesh_index : batch_group.meshes) {
+        if (mesh_index >= (int)visible.size() || !visible[mesh_index]) {
+            continue;
+        }
+        const StaticBatchMesh &mesh = this->meshes[mesh_index];
+        int lod = std::min(mesh.shape->SelectLOD(mesh.transform, view), (int)mesh.lods.size() - 1);
+        view.triangles += mesh.shape->TriangleCount(lod);
+        view.full_triangles += mesh.shape->TriangleCount(0);
+        this->counts.push_back(mesh.lods[lod].index_count);
+        this->offsets.push_back((const void*)(intptr_t)(mesh.lods[lod].first_index * sizeof(unsigned int)));
+    }
+    if (this->counts.empty()) {
+        return 0;
+    }
+
+    GLState::BindVertexArray(batch_group.vertex_array);
+    if (batch_group.material_table > 0) {
+        glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_TABLE_BINDING, batch_group.material_table);
+    }
+    glMultiDrawElements(GL_TRIANGLES, this->counts.data(), GL_UNSIGNED_INT, this->offsets.data(),
+                        (GLsizei)this->counts.size());
+    frame_stats.multi_draws++;
+    frame_stats.meshes += (int)this->counts.size();
+    return (int)this->counts.size();
+}
+
+int StaticBatch::GetBufferBytes() const {
+    return this->buffer_bytes;
+}
+
+void StaticBatch::DeallocateBatch() {
+    // The identifiers are cleared so deallocating twice is harmless
+    for (StaticBatchGroup &group : this->groups) {
+        if (group.material_table > 0) {
+            glDeleteBuffers(1, &group.material_table);
+        }
+    }
+    if (!this->vertex_arrays.empty()) {
+        GLState::DeleteVertexArrays((int)this->vertex_arrays.size(), this->vertex_arrays.data());
+    }
+    if (this->vbo > 0) {
+        glDeleteBuffers(1, &this->vbo);
+    }
+    if (this->ebo > 0) {
+        glDeleteBuffers(1, &this->ebo);
+    }
+    this->meshes.clear();
+    this->groups.clear();
+    this->vertex_arrays.clear();
+    this->vbo = 0;
+    this->ebo = 0;
+    this->buffer_bytes = 0;
+}
+
+StaticBatchStats StaticBatch::GetFrameStats() {
+    return frame_stats;
+}
+
+void StaticBatch::ResetFrameStats() {
+    frame_stats = StaticBatchStats();
+}
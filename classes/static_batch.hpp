@@ -0,0 +1,104 @@
+#ifndef STATIC_BATCH_HPP
+#define STATIC_BATCH_HPP
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include <vector>
+#include "basic_shape.hpp"
+
+//A mesh handed to StaticBatch::Build: a shape that never moves, the transform it is drawn
+// with (model * local), and the object type and texture the camera pass draws it with
+struct StaticMesh {
+    BasicShape* shape = nullptr;
+    glm::mat4 transform = glm::mat4(1.0);
+    int object_type = 0;
+    GLenum texture_target = GL_TEXTURE_2D;
+    unsigned int texture = 0;
+    int texture_unit = 0;
+};
+
+//A mesh of a StaticBatch: the shape it was built from, and its levels of detail as ranges
+// of the batch's index buffer
+struct StaticBatchMesh {
+    BasicShape* shape = nullptr;
+    glm::mat4 transform = glm::mat4(1.0);
+    std::vector<ShapeLOD> lods;
+};
+
+//Meshes of a StaticBatch drawn by one glMultiDrawElements call: they share a vertex layout,
+// an object type, a texture, and a material table
+struct StaticBatchGroup {
+    //Vertex array of the group's vertex layout (shared by the groups with that layout)
+    unsigned int vertex_array = 0;
+    //Material tables of the meshes, one after the other (0 if the meshes have none)
+    unsigned int material_table = 0;
+    int material_count = 0;
+    int object_type = 0;
+    GLenum texture_target = GL_TEXTURE_2D;
+    unsigned int texture = 0;
+    int texture_unit = 0;
+    //Positions of the group's meshes in Meshes()
+    std::vector<int> meshes;
+};
+
+//Draws made by every StaticBatch since the last ResetFrameStats
+struct StaticBatchStats {
+    //glMultiDrawElements calls
+    int multi_draws = 0;
+    //Meshes drawn by them
+    int meshes = 0;
+};
+
+//StaticBatch merges meshes that never move into one vertex buffer and one index buffer.
+// The vertices are transformed into world space when the batch is built (so they are drawn
+// with identity model and local matrices), and the meshes are grouped by vertex layout,
+// object type, texture, and material table, so each group is drawn with a single
+// glMultiDrawElements call that only lists its visible meshes.  The material tables of a
+// group are merged, and each vertex's material index is moved to its mesh's rows.
+class StaticBatch {
+    public:
+        StaticBatch();
+
+        //Reads the meshes back from the GPU and builds the batch (replacing any earlier one).
+        // Meshes that can not be batched (see BasicShape::ReadGeometry, or a vertex layout
+        // that does not start with a float position) and empty meshes are left out.
+        void Build(const std::vector<StaticMesh> &meshes);
+
+        //Returns true if the shape was built into the batch
+        bool Contains(const BasicShape* shape) const;
+
+        const std::vector<StaticBatchMesh>& Meshes() const;
+        const std::vector<StaticBatchGroup>& Groups() const;
+
+        //Draws the meshes of a group whose entry in visible is set, each with the level of
+        // detail its shape would be drawn with, and adds the triangles to the view's counters.
+        // The program, its uniforms, and the group's texture must already be set.  Returns the
+        // number of meshes drawn.
+        int DrawGroup(int group, const std::vector<char> &visible, LODView &view);
+
+        //Returns the size of the merged buffers
+        int GetBufferBytes() const;
+
+        //Deletes the buffers and vertex arrays of the batch
+        void DeallocateBatch();
+
+        //Returns the draws of all batches since the last reset (the render loop resets them
+        // every frame)
+        static StaticBatchStats GetFrameStats();
+        static void ResetFrameStats();
+
+    private:
+        std::vector<StaticBatchMesh> meshes;
+        std::vector<StaticBatchGroup> groups;
+        std::vector<unsigned int> vertex_arrays;
+        unsigned int vbo = 0;
+        unsigned int ebo = 0;
+        int buffer_bytes = 0;
+        //Index counts and offsets of the multi-draw being issued
+        std::vector<GLsizei> counts;
+        std::vector<const void*> offsets;
+
+        static StaticBatchStats frame_stats;
+};
+
+#endif //STATIC_BATCH_HPP
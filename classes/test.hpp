@@ -7,7 +7,7 @@ class TestChild : public Avatar {
     protected:
         std::string name;
     public:
-        TestChild(std::string name, BasicShape shape, float orientation, glm::vec3 initial_position, int shader_state);
+        TestChild(std::string name, MeshHandle shape, float orientation, glm::vec3 initial_position, int shader_state);
         std::string GetName() {
             return this->name;
         }
@@ -0,0 +1,75 @@
+#include "thread_pool.hpp"
+
+#include <atomic>
+
+ThreadPool::ThreadPool(int thread_count) {
+    for (int i = 0; i < thread_count; i++) {
+        this->workers.push_back(std::thread(&ThreadPool::WorkerLoop, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->stopping = true;
+    }
+    this->task_available.notify_all();
+    for (std::thread &worker : this->workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::Submit(std::function<void()> task) {
+    if (this->workers.empty()) {
+        task();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(this->mutex);
+        this->tasks.push_back(std::move(task));
+    }
+    this->task_available.notify_one();
+}
+
+int ThreadPool::ThreadCount() const {
+    return this->workers.size();
+}
+
+int ThreadPool::HardwareThreads() {
+    unsigned int count = std::thread::hardware_concurrency();
+    return count > 0 ? (int)count : 1;
+}
+
+void ThreadPool::WorkerLoop() {
+    while (true) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(this->mutex);
+            this->task_available.wait(lock, [this] { return this->stopping || !this->tasks.empty(); });
+            // Queued tasks are still finished after the pool starts stopping
+            if (this->tasks.empty()) {
+                return;
+            }
+            task = std::move(this->tasks.front());
+            this->tasks.pop_front();
+        }
+        task();
+    }
+}
+
+void ParallelFor(int count, int thread_count, const std::function<void(int)> &body) {
+    std::atomic<int> next(0);
+    auto run = [&]() {
+        for (int i = next++; i < count; i = next++) {
+            body(i);
+        }
+    };
+    std::vector<std::thread> helpers;
+    for (int i = 1; i < thread_count && i < count; i++) {
+        helpers.push_back(std::thread(run));
+    }
+    run();
+    for (std::thread &helper : helpers) {
+        helper.join();
+    }
+}
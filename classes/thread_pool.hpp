@@ -0,0 +1,49 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <functional>
+
+//ThreadPool runs submitted tasks on a fixed set of worker threads, in the order
+// they were submitted.  A pool with zero threads runs each task immediately on
+// the thread that submits it, which gives a serial version of the same work.
+class ThreadPool {
+    public:
+        //Starts the given number of worker threads
+        ThreadPool(int thread_count);
+        //Finishes every queued task, then stops the workers
+        ~ThreadPool();
+
+        //Queues a task (or runs it right away when the pool has no threads)
+        void Submit(std::function<void()> task);
+
+        //Returns the number of worker threads
+        int ThreadCount() const;
+
+        //Returns the number of hardware threads (at least 1)
+        static int HardwareThreads();
+
+    private:
+        //The workers reference the pool, so it is not copied
+        ThreadPool(const ThreadPool&) = delete;
+        ThreadPool& operator=(const ThreadPool&) = delete;
+
+        //Main loop of each worker thread
+        void WorkerLoop();
+
+        std::vector<std::thread> workers;
+        std::deque<std::function<void()>> tasks;
+        std::mutex mutex;
+        std::condition_variable task_available;
+        bool stopping = false;
+};
+
+//Calls body(i) for every i in [0, count) using up to thread_count threads (the
+// calling thread is one of them) and returns once every call has finished.
+void ParallelFor(int count, int thread_count, const std::function<void(int)> &body);
+
+#endif //THREAD_POOL_HPP
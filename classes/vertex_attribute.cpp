@@ -1,6 +1,8 @@
 #include "vertex_attribute.hpp"
+#include "gl_state.hpp"
 
-AttributePointer BuildAttribute(int number_vals_per, int data_type, bool is_normalized, int stride, int offset)
+AttributePointer BuildAttribute(int number_vals_per, int data_type, bool is_normalized, int stride, int offset,
+                                bool is_integer)
 {
     AttributePointer attribute;
     attribute.number_per_vertex = number_vals_per;
@@ -8,19 +10,27 @@ AttributePointer BuildAttribute(int number_vals_per, int data_type, bool is_norm
     attribute.normalize_data = is_normalized;
     attribute.stride_bytes = stride;
     attribute.offset_bytes = offset;
+    attribute.is_integer = is_integer;
     return attribute;
 }
 
-void BindVAO (VAOStruct vao, unsigned int vbo, int buffer_type) 
+void BindVAO (const VAOStruct &vao, unsigned int vbo, int buffer_type) 
 {
-    glBindVertexArray(vao.id);
+    GLState::BindVertexArray(vao.id);
     glBindBuffer(buffer_type,vbo);
     for(int i = 0; i < vao.attributes.size(); i++) {
-        glVertexAttribPointer(i,vao.attributes[i].number_per_vertex,
-                                vao.attributes[i].type_data,
-                                vao.attributes[i].normalize_data,
-                                vao.attributes[i].stride_bytes,
-                                (void*)(intptr_t)vao.attributes[i].offset_bytes);
+        if (vao.attributes[i].is_integer) {
+            glVertexAttribIPointer(i,vao.attributes[i].number_per_vertex,
+                                    vao.attributes[i].type_data,
+                                    vao.attributes[i].stride_bytes,
+                                    (void*)(intptr_t)vao.attributes[i].offset_bytes);
+        } else {
+            glVertexAttribPointer(i,vao.attributes[i].number_per_vertex,
+                                    vao.attributes[i].type_data,
+                                    vao.attributes[i].normalize_data,
+                                    vao.attributes[i].stride_bytes,
+                                    (void*)(intptr_t)vao.attributes[i].offset_bytes);
+        }
         glEnableVertexAttribArray(i);
     }
 }
\ No newline at end of file
@@ -13,17 +13,22 @@ struct AttributePointer
     bool normalize_data;
     int stride_bytes;
     int offset_bytes;
+    //Integer attributes are passed to the shader unconverted (glVertexAttribIPointer)
+    bool is_integer;
 };
 
 struct VAOStruct
 {
-    unsigned int id;
+    unsigned int id = 0;
     std::vector<AttributePointer> attributes;
 
 };
 
-AttributePointer BuildAttribute(int number_vals_per, int data_type, bool is_normalized, int stride, int offset);
-void BindVAO (VAOStruct vao, unsigned int vbo, int buffer_type = GL_ARRAY_BUFFER);
+AttributePointer BuildAttribute(int number_vals_per, int data_type, bool is_normalized, int stride, int offset,
+                                bool is_integer = false);
+//Binds the vertex array and points its attributes at vbo.  A vertex array keeps this state,
+// so this is only needed once, when the array is created (see BasicShape::Initialize).
+void BindVAO (const VAOStruct &vao, unsigned int vbo, int buffer_type = GL_ARRAY_BUFFER);
 
 
 
@@ -4,12 +4,18 @@
 #include "utilities/rendering.hpp"
 #include "utilities/input_handling.hpp"
 #include "utilities/initialization.hpp"
+#include "utilities/benchmarks.hpp"
 #include "classes/camera.hpp"
 #include "classes/Font.hpp"
 #include "classes/import_object.hpp"
+#include "classes/thread_pool.hpp"
 #include "classes/avatar.hpp"
 #include "classes/avatar_high_bar.hpp"
 #include "classes/object_types.hpp"
+#include "classes/gpu_timer.hpp"
+#include "classes/program_cache.hpp"
+#include "classes/render_queue.hpp"
+#include "classes/gl_state.hpp"
 #include <iostream>
 #include <thread>
 #include <chrono>
@@ -56,12 +62,49 @@ Shader* font_program_ptr = nullptr;
 Shader* depth_shader_ptr = nullptr;
 Shader* post_processing_shader_ptr = nullptr;
 Shader* skybox_shader_ptr = nullptr; 
+// Variants of the scene program compiled for each object type and frame features
+ShaderPermutations* scene_permutations = nullptr;
 
 // Post-processing effect selection
 int current_effect = 0; // 0 = no effect
 bool effect_key_pressed = false; // To prevent multiple toggles in one key press
 
-int main() {
+int main(int argc, char **argv) {
+    // Optional benchmark modes (no window is created)
+    if (argc > 1 && std::string(argv[1]) == BENCHMARK_IMPORT_FLAG) {
+        RunImportBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == BENCHMARK_LOADING_FLAG) {
+        RunLoadingBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == BENCHMARK_PARSE_FLAG) {
+        RunParseBenchmark();
+        return 0;
+    }
+    if (argc > 1 && std::string(argv[1]) == BENCHMARK_VERTEX_CACHE_FLAG) {
+        RunVertexCacheBenchmark();
+        return 0;
+    }
+    // Load the scene serially instead of on the loader threads (for comparing load times)
+    int loader_threads = ThreadPool::HardwareThreads();
+    // Use the compact (24 byte) vertex layout for imported models
+    bool compact_vertices = false;
+    // Print the frame's counters to the console every 100 frames
+    bool frame_stats = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::string(argv[i]) == SERIAL_LOADING_FLAG) {
+            loader_threads = 0;
+        }
+        if (std::string(argv[i]) == COMPACT_VERTICES_FLAG) {
+            compact_vertices = true;
+        }
+        if (std::string(argv[i]) == FRAME_STATS_FLAG) {
+            frame_stats = true;
+        }
+    }
+
     // Initialize the environment
     GLFWwindow *window = InitializeEnvironment("CS473", SCR_WIDTH, SCR_HEIGHT);
     if (window == NULL) {
@@ -75,15 +118,20 @@ int main() {
     InitializeMouseSettings(window);
     
     // Initialize shaders
+    // Programs saved by an earlier run are loaded instead of compiled (see program_cache.hpp)
+    auto shaders_start = std::chrono::steady_clock::now();
     CreateShaders(shader_program_ptr, font_program_ptr);
+    CreateShaderPermutations(scene_permutations);
     CreateDepthShader(depth_shader_ptr);
     CreatePostProcessingShader(post_processing_shader_ptr);  
     CreateSkyboxShader(skybox_shader_ptr);  
+    std::cout << "Shader programs ready in "
+              << std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - shaders_start).count()
+              << " ms (program binaries " << (ProgramBinariesSupported() ? "cached" : "not supported") << ")" << std::endl;
     
     // Setup VAOs and models
-    RenderingVAOs vaos = setupVAOs();
-    ImportOBJ importer;
-    GameModels models = loadModels(vaos, importer);
+    RenderingVAOs vaos = setupVAOs(compact_vertices);
+    GameModels models = loadModels(vaos, loader_threads);
     
     // Setup avatars, camera, lighting, and font
     // Initialize baseAvatar with the correct model and parameters before passing to SetupAvatars
@@ -92,9 +140,14 @@ int main() {
     
     // Now initialize the high_bar_avatar in SetupAvatars
     SetupAvatars(baseAvatar, high_bar_avatar, models);
+
+    // Place the objects in the scene graph; the static batch is built from their world matrices
+    buildSceneGraph(models, baseAvatar, high_bar_avatar);
+    buildStaticBatch(models);
     
     setupShaders(shader_program_ptr, arial_font, vaos);
-    SetupCameraAndProjection(shader_program_ptr, SCR_WIDTH, SCR_HEIGHT);
+    FrameUniforms frame_uniforms;
+    SetupCameraAndProjection(frame_uniforms);
     SetupFontShader(font_program_ptr);
     SetupRendering();
 
@@ -109,7 +162,7 @@ int main() {
     // Define and generate a 2D texture for depth information
     unsigned int depthMap;
     glGenTextures(1, &depthMap);
-    glBindTexture(GL_TEXTURE_2D, depthMap);
+    GLState::BindTexture(GL_TEXTURE_2D, depthMap);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT, 
                  SHADOW_WIDTH, SHADOW_HEIGHT, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
@@ -120,7 +173,7 @@ int main() {
     glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
 
     // Bind the framebuffer and attach the texture
-    glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+    GLState::BindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
     glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, depthMap, 0);
 
     // Set draw and read buffers to none since we only need depth
@@ -133,7 +186,7 @@ int main() {
     }
 
     // Unbind the framebuffer
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
 
     std::cout << "Shadow mapping depth framebuffer setup complete" << std::endl;
 
@@ -146,12 +199,12 @@ int main() {
     // Create a framebuffer object for post-processing
     unsigned int postProcessingFBO;
     glGenFramebuffers(1, &postProcessingFBO);
-    glBindFramebuffer(GL_FRAMEBUFFER, postProcessingFBO);
+    GLState::BindFramebuffer(GL_FRAMEBUFFER, postProcessingFBO);
 
     // Create a texture attachment for the framebuffer
     unsigned int textureColorBuffer;
     glGenTextures(1, &textureColorBuffer);
-    glBindTexture(GL_TEXTURE_2D, textureColorBuffer);
+    GLState::BindTexture(GL_TEXTURE_2D, textureColorBuffer);
     glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, SCR_WIDTH, SCR_HEIGHT, 0, GL_RGB, GL_UNSIGNED_BYTE, NULL);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -169,7 +222,7 @@ int main() {
     if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
         std::cout << "Post-processing framebuffer is not complete!" << std::endl;
     }
-    glBindFramebuffer(GL_FRAMEBUFFER, 0);
+    GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
 
     // Create a texture rectangle that fills the screen in NDC (-1,-1) to (1,1)
     float quadVertices[] = {
@@ -187,14 +240,25 @@ int main() {
     unsigned int quadVAO, quadVBO;
     glGenVertexArrays(1, &quadVAO);
     glGenBuffers(1, &quadVBO);
-    glBindVertexArray(quadVAO);
+    GLState::BindVertexArray(quadVAO);
     glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
     glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), quadVertices, GL_STATIC_DRAW);
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 4 * sizeof(float), (void*)0);
     glEnableVertexAttribArray(1);
     glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 4 *sizeof(float), (void*)(2 * sizeof(float)));
-    glBindVertexArray(0);
+    GLState::BindVertexArray(0);
+
+    // Measures the GPU time of the shadow pass (shown on the HUD)
+    GpuTimer shadow_timer;
+    // Measures the GPU time of the camera pass, to compare the variants with the ubershader
+    GpuTimer scene_timer;
+    // Draws of the shadow and camera passes (each pass refills its queue every frame, keeping
+    // the storage)
+    RenderQueue shadow_queue;
+    RenderQueue scene_queue;
+    // CPU time spent in the camera pass's renderScene over the frames since the last report
+    double scene_cpu_milliseconds = 0.0;
 
     // Render loop
     while (!glfwWindowShouldClose(window)) {
@@ -203,11 +267,20 @@ int main() {
         delta_time = current_frame - last_frame;
         last_frame = current_frame; 
 
+        // Uniform updates are counted per frame
+        Shader::ResetUniformStats();
+        RenderQueue::ResetFrameStats();
+        GLState::ResetFrameStats();
+        StaticBatch::ResetFrameStats();
+
         // Handle input 
         ProcessInput(window);
         baseAvatar.ProcessInput(window, delta_time);
         high_bar_avatar->ProcessInput(window, delta_time);
 
+        // Recompute the world matrices of the nodes that moved (the avatars) once for both passes
+        updateSceneGraph(models, baseAvatar, high_bar_avatar);
+
         // Light space transformation matrix
 
         // Create a position for the light source based on the negative direction vector
@@ -232,63 +305,90 @@ int main() {
         // Create the combined light space matrix
         glm::mat4 lightSpaceMatrix = lightProjection * lightView;
 
-        // Set the light space matrix uniform in your depth shader
-        depth_shader_ptr->use();
-        depth_shader_ptr->setMat4("lightSpaceMatrix", lightSpaceMatrix);
+        // Upload the frame's camera and lighting blocks (read by every program)
+        updateFrameUniforms(frame_uniforms, camera, SCR_WIDTH, SCR_HEIGHT,
+                            point_light_color, light_direction, lightSpaceMatrix);
         
         // FIRST PASS - Render to depth map for shadows
-        glViewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
-        glBindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
+        GLState::Viewport(0, 0, SHADOW_WIDTH, SHADOW_HEIGHT);
+        GLState::BindFramebuffer(GL_FRAMEBUFFER, depthMapFBO);
         glClear(GL_DEPTH_BUFFER_BIT);
 
-        // Render the scene for depth map
-        renderScene(
-            depth_shader_ptr,
-            models,
-            baseAvatar,
-            high_bar_avatar,
-            camera,
-            point_light_color,
-            light_direction,
-            true // is_depth_pass
-        );
+        // Render the depth map (with coarser levels of detail than the camera pass)
+        LODView shadow_lods = makeLODView(camera, SCR_HEIGHT, SHADOW_LOD_PIXEL_ERROR);
+        shadow_timer.Begin();
+        CullingView shadow_culling;
+        // With shadows off ('G') nothing is drawn, so the cleared depth map casts no shadows
+        // (variants compiled without shadows skip the lookup entirely)
+        if (shadows_enabled && shadow_caster_culling) {
+            // Only the objects that cast shadows and are inside the light's frustum
+            shadow_culling = makeShadowCullingView(lightSpaceMatrix);
+            std::vector<ShadowCaster> shadow_casters = collectShadowCasters(models, baseAvatar, high_bar_avatar, shadow_culling);
+            renderShadowCasters(depth_shader_ptr, shadow_casters, shadow_queue, shadow_lods);
+            ScenePrograms depth_programs = makeScenePrograms(depth_shader_ptr);
+            renderStaticBatch(depth_programs, models, shadow_lods, shadow_culling, true, true);
+        } else if (shadows_enabled) {
+            // The whole scene, for comparison ('K')
+            shadow_culling.enabled = false;
+            ScenePrograms depth_programs = makeScenePrograms(depth_shader_ptr);
+            renderScene(
+                depth_programs,
+                models,
+                baseAvatar,
+                high_bar_avatar,
+                shadow_queue,
+                shadow_lods,
+                shadow_culling,
+                true // is_depth_pass
+            );
+        }
+        shadow_timer.End();
 
         // SECOND PASS - Render to post-processing framebuffer
-        glBindFramebuffer(GL_FRAMEBUFFER, postProcessingFBO);
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        GLState::BindFramebuffer(GL_FRAMEBUFFER, postProcessingFBO);
+        GLState::Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
         glClearColor(clear_color.r, clear_color.g, clear_color.b, clear_color.a);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
 
         // Draw skybox first (before other scene objects but after clearing the buffer)
-        renderSkybox(skybox_shader_ptr, models, camera, SCR_WIDTH, SCR_HEIGHT);
+        renderSkybox(skybox_shader_ptr, models);
         
-        // Set up the main shader
-        shader_program_ptr->use();
-        shader_program_ptr->setBool("debug_shadows", false);
-        shader_program_ptr->setMat4("lightSpaceMatrix", lightSpaceMatrix);
-        
-        // Apply post-processing effect
-        shader_program_ptr->setInt("post_process_selection", current_effect);
-        
-        // Assign shadow map to texture unit 1
-        shader_program_ptr->setInt("shadow_map", 1);
-        glActiveTexture(GL_TEXTURE1);
-        glBindTexture(GL_TEXTURE_2D, depthMap);
+        // Set up the scene's programs: the variant of each object type compiled for the
+        // frame's lights, shadows, and effect, or the ubershader that branches on them ('U')
+        ScenePrograms scene_programs = makeScenePrograms(shader_program_ptr);
+        if (shader_permutations_enabled) {
+            ShaderVariantKey variant_key;
+            variant_key.directional_light = point_light_on;
+            variant_key.spot_light = spotlight_on;
+            variant_key.shadows = shadows_enabled;
+            variant_key.post_process = current_effect;
+            scene_programs = makeScenePrograms(*scene_permutations, variant_key);
+        }
+        // Apply post-processing effect and assign the texture units (the shadow map is unit 1)
+        prepareScenePrograms(scene_programs, current_effect);
+        GLState::ActiveTexture(GL_TEXTURE0 + SHADOW_MAP_UNIT);
+        GLState::BindTexture(GL_TEXTURE_2D, depthMap);
         
         // Reset to texture unit 0 for other textures
-        glActiveTexture(GL_TEXTURE0);
+        GLState::ActiveTexture(GL_TEXTURE0);
 
         // Render the scene normally
+        LODView camera_lods = makeLODView(camera, SCR_HEIGHT, LOD_PIXEL_ERROR);
+        CullingView camera_culling = makeCullingView(camera, SCR_WIDTH, SCR_HEIGHT);
+        auto scene_start = std::chrono::steady_clock::now();
+        scene_timer.Begin();
         renderScene(
-            shader_program_ptr,
+            scene_programs,
             models,
             baseAvatar,
             high_bar_avatar,
-            camera,
-            point_light_color,
-            light_direction,
+            scene_queue,
+            camera_lods,
+            camera_culling,
             false // is_depth_pass
         );
+        scene_timer.End();
+        scene_cpu_milliseconds += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - scene_start).count();
 
         // Enforce minimum camera height
         if (camera.Position.y < 0.5) {
@@ -296,11 +396,12 @@ int main() {
         }
         
         // Display text (HUD)
-        renderText(font_program_ptr, arial_font, camera);
+        renderText(font_program_ptr, arial_font, camera, camera_lods, shadow_lods, camera_culling,
+                   shadow_culling, shadow_timer.Milliseconds(), scene_timer.Milliseconds());
 
         // THIRD PASS - Render the framebuffer texture to the screen
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
-        glViewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
+        GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+        GLState::Viewport(0, 0, SCR_WIDTH, SCR_HEIGHT);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         
@@ -310,14 +411,14 @@ int main() {
         post_processing_shader_ptr->setInt("effect", current_effect);
         
         // Bind the texture from our framebuffer
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, textureColorBuffer);
+        GLState::ActiveTexture(GL_TEXTURE0);
+        GLState::BindTexture(GL_TEXTURE_2D, textureColorBuffer);
         
         // Render the quad
-        glBindVertexArray(quadVAO);
-        glDisable(GL_DEPTH_TEST);
+        GLState::BindVertexArray(quadVAO);
+        GLState::Disable(GL_DEPTH_TEST);
         glDrawArrays(GL_TRIANGLES, 0, 6);
-        glEnable(GL_DEPTH_TEST);
+        GLState::Enable(GL_DEPTH_TEST);
         
         // Swap buffers and poll events
         glfwSwapBuffers(window);
@@ -326,17 +427,37 @@ int main() {
         // Limit frame rate
         std::this_thread::sleep_for(std::chrono::milliseconds(1));
         
-        // Debug frame count
+        // Debug frame count (with --frame-stats, followed by the counters the HUD shows, on one line)
         if (frame_count % 100 == 0) {
-            std::cout << "Frame: " << frame_count << std::endl;
+            std::cout << "Frame: " << frame_count;
+            if (frame_stats) {
+                RenderQueueStats queue_stats = RenderQueue::GetFrameStats();
+                StaticBatchStats batch_stats = StaticBatch::GetFrameStats();
+                GLStateStats state_stats = GLState::GetFrameStats();
+                UniformStats uniform_stats = Shader::GetUniformStats();
+                std::cout << " | shadow " << shadow_culling.visible << " draws " << shadow_timer.Milliseconds() << " ms"
+                          << " | scene " << scene_timer.Milliseconds() << " ms GPU "
+                          << (frame_count > 0 ? scene_cpu_milliseconds / 100.0 : 0.0) << " ms CPU"
+                          << " | draws " << queue_stats.draw_calls << " inst " << queue_stats.instances
+                          << " changes " << queue_stats.program_changes + queue_stats.texture_changes
+                          << " | static " << batch_stats.multi_draws << "/" << batch_stats.meshes
+                          << " | graph " << models.scene_graph.LastUpdateCount() << "/" << models.scene_graph.NodeCount()
+                          << " | GL " << state_stats.issued << " elided " << state_stats.elided
+                          << " | uniforms " << uniform_stats.uploads << " skipped " << uniform_stats.skipped;
+            }
+            std::cout << std::endl;
+            scene_cpu_milliseconds = 0.0;
         }
         frame_count++;
     }
 
     std::cout << "Render loop exited, starting cleanup..." << std::endl;
+    shadow_timer.DeallocateTimer();
+    scene_timer.DeallocateTimer();
 
     // Cleanup resources
     cleanupResources(vaos, models);
+    frame_uniforms.DeallocateBuffers();
 
     // Delete the shader programs
     if (shader_program_ptr != nullptr) {
@@ -364,6 +485,11 @@ int main() {
         skybox_shader_ptr = nullptr;
     }
 
+    if (scene_permutations != nullptr) {
+        delete scene_permutations;
+        scene_permutations = nullptr;
+    }
+
     // Delete the high_bar_avatar object
     if (high_bar_avatar != nullptr) {
         delete high_bar_avatar;
@@ -1,11 +1,23 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
+//model * local matrix of an instance (instanced draws, see InstanceData in basic_shape.hpp)
+layout (location = 4) in mat4 instance_transform;
 
-uniform mat4 lightSpaceMatrix;
+//Per-frame camera data shared by every program (see FrameUniforms)
+layout (std140) uniform FrameCamera {
+  mat4 projection;
+  mat4 view;
+  //light space matrix of the shadow map
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+};
 uniform mat4 model;
 uniform mat4 local;
+//true for instanced draws, which take the transform from the instance data
+uniform bool instanced;
 
 void main()
 {
-    gl_Position = lightSpaceMatrix * model * local * vec4(aPos, 1.0);
+    mat4 transform = instanced ? instance_transform : model * local;
+    gl_Position = lightSpaceMatrix * transform * vec4(aPos, 1.0);
 }
\ No newline at end of file
@@ -20,14 +20,30 @@ flat in int index_for_texture;
 
 //bring in the state of the fragment shader
 flat in int fragment_shader_state;
+//A variant compiled for one object type (see ShaderPermutations) fixes the state at
+//  compile time, which removes the branches of the other types.
+#ifdef OBJECT_TYPE
+const int object_type = OBJECT_TYPE;
+#else
+#define object_type fragment_shader_state
+#endif
 
 uniform vec4 set_color;
 
-//if it -is- textured, assume this 2D texture is mapped.
-#define NR_TEXTURES 19
-uniform sampler2D textures[NR_TEXTURES];
-
-uniform vec4 view_position;
+//if it -is- textured, assume this 2D texture is mapped (texture unit 0).
+uniform sampler2D shape_texture;
+//textures of an imported model, one layer per map_Kd entry (texture unit 2).  The
+//  material's texture index selects the layer.
+uniform sampler2DArray material_textures;
+
+//Per-frame camera data shared by every program (see FrameUniforms)
+layout (std140) uniform FrameCamera {
+  mat4 projection;
+  mat4 view;
+  //light space matrix of the shadow map
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+};
 
 struct DirectionalLight {
     vec4 direction;
@@ -39,7 +55,6 @@ struct DirectionalLight {
     bool on;
 };
 
-uniform DirectionalLight directional_light;
 
 struct SpotLight {
     vec4 position;
@@ -55,13 +70,41 @@ struct SpotLight {
     bool on;
 };
 
-uniform SpotLight spot_light;
+//Per-frame lighting data shared by every program (see FrameUniforms)
+layout (std140) uniform FrameLighting {
+    DirectionalLight directional_light;
+    SpotLight spot_light;
+};
+
+//Variants fix the lights' on/off state at compile time; the general program reads it
+//  from the lighting block
+#ifdef DIRECTIONAL_LIGHT_ON
+const bool directional_light_on = DIRECTIONAL_LIGHT_ON != 0;
+#else
+#define directional_light_on directional_light.on
+#endif
+#ifdef SPOT_LIGHT_ON
+const bool spot_light_on = SPOT_LIGHT_ON != 0;
+#else
+#define spot_light_on spot_light.on
+#endif
 
 in vec4 FragPosLightSpace;
 uniform sampler2D shadow_map;
-
-// Add post-processing uniform
+//Variants compiled without shadows never sample the shadow map
+#ifdef SHADOWS_ON
+const bool shadows_on = SHADOWS_ON != 0;
+#else
+const bool shadows_on = true;
+#endif
+
+// Add post-processing uniform (a variant fixes the effect at compile time)
+#ifdef POST_PROCESS_SELECTION
+const int post_process = POST_PROCESS_SELECTION;
+#else
 uniform int post_process_selection;
+#define post_process post_process_selection
+#endif
 
 uniform vec4 color;
 
@@ -97,6 +140,15 @@ float ShadowCalculation(vec4 fragPosLightSpace, vec3 normal, vec3 lightDir)
     return shadow;
 }
 
+//Samples the object's texture: the shape's texture (state 1) or the material's layer
+//  of the model's texture array (state 3)
+vec4 sampleTexture(vec2 coordinates) {
+    if (object_type == 1) {
+        return texture(shape_texture, coordinates);
+    }
+    return texture(material_textures, vec3(coordinates, float(index_for_texture)));
+}
+
 // Post-processing functions
 vec4 inverseColor(vec4 color) {
     return vec4(1.0 - color.rgb, color.a);
@@ -152,13 +204,8 @@ vec4 blurEffect(vec4 color) {
     
     vec3 sampleTex[9];
     for(int i = 0; i < 9; i++) {
-        if (fragment_shader_state == 1 || fragment_shader_state == 3) {
-            int tex_idx = index_for_texture;
-            if(tex_idx == 0) sampleTex[i] = vec3(texture(textures[0], texture_coordinates + offsets[i]));
-            else if(tex_idx == 1) sampleTex[i] = vec3(texture(textures[1], texture_coordinates + offsets[i]));
-            else if(tex_idx == 2) sampleTex[i] = vec3(texture(textures[2], texture_coordinates + offsets[i]));
-            // can add more texture indices as needed
-            else sampleTex[i] = color.rgb; // Fallback
+        if ((object_type == 1 || object_type == 3) && index_for_texture != 99) {
+            sampleTex[i] = vec3(sampleTexture(texture_coordinates + offsets[i]));
         } else {
             sampleTex[i] = color.rgb; // Use the original color for non-textured objects
         }
@@ -195,13 +242,8 @@ vec4 sharpenEffect(vec4 color) {
     
     vec3 sampleTex[9];
     for(int i = 0; i < 9; i++) {
-        if (fragment_shader_state == 1 || fragment_shader_state == 3) {
-            int tex_idx = index_for_texture;
-            if(tex_idx == 0) sampleTex[i] = vec3(texture(textures[0], texture_coordinates + offsets[i]));
-            else if(tex_idx == 1) sampleTex[i] = vec3(texture(textures[1], texture_coordinates + offsets[i]));
-            else if(tex_idx == 2) sampleTex[i] = vec3(texture(textures[2], texture_coordinates + offsets[i]));
-            // can add more texture indices as needed
-            else sampleTex[i] = color.rgb; // Fallback
+        if ((object_type == 1 || object_type == 3) && index_for_texture != 99) {
+            sampleTex[i] = vec3(sampleTexture(texture_coordinates + offsets[i]));
         } else {
             sampleTex[i] = color.rgb; // Use the original color for non-textured objects
         }
@@ -238,13 +280,8 @@ vec4 edgeDetectionEffect(vec4 color) {
     
     vec3 sampleTex[9];
     for(int i = 0; i < 9; i++) {
-        if (fragment_shader_state == 1 || fragment_shader_state == 3) {
-            int tex_idx = index_for_texture;
-            if(tex_idx == 0) sampleTex[i] = vec3(texture(textures[0], texture_coordinates + offsets[i]));
-            else if(tex_idx == 1) sampleTex[i] = vec3(texture(textures[1], texture_coordinates + offsets[i]));
-            else if(tex_idx == 2) sampleTex[i] = vec3(texture(textures[2], texture_coordinates + offsets[i]));
-            // can add more texture indices as needed
-            else sampleTex[i] = color.rgb; // Fallback
+        if ((object_type == 1 || object_type == 3) && index_for_texture != 99) {
+            sampleTex[i] = vec3(sampleTexture(texture_coordinates + offsets[i]));
         } else {
             sampleTex[i] = color.rgb; // Use the original color for non-textured objects
         }
@@ -259,23 +296,23 @@ vec4 edgeDetectionEffect(vec4 color) {
 
 // Apply post-processing based on selection
 vec4 applyPostProcessing(vec4 originalColor) {
-    if (post_process_selection == 1) {
+    if (post_process == 1) {
         return inverseColor(originalColor);
-    } else if (post_process_selection == 2) {
+    } else if (post_process == 2) {
         return grayscale(originalColor);
-    } else if (post_process_selection == 3) {
+    } else if (post_process == 3) {
         return redChannel(originalColor);
-    } else if (post_process_selection == 4) {
+    } else if (post_process == 4) {
         return greenChannel(originalColor);
-    } else if (post_process_selection == 5) {
+    } else if (post_process == 5) {
         return blueChannel(originalColor);
-    } else if (post_process_selection == 6) {
+    } else if (post_process == 6) {
         return sepiaEffect(originalColor);
-    } else if (post_process_selection == 7) {
+    } else if (post_process == 7) {
         return blurEffect(originalColor);
-    } else if (post_process_selection == 8) {
+    } else if (post_process == 8) {
         return sharpenEffect(originalColor);
-    } else if (post_process_selection == 9) {
+    } else if (post_process == 9) {
         return edgeDetectionEffect(originalColor);
     }
     
@@ -293,14 +330,14 @@ void main()
     vec4 directional_light_color = CalcDirectionalLight(directional_light, norm,
                                             fragment_position, view_position.xyz);
     //Material colors are integrated into the directional light calculation
-    if (fragment_shader_state == 2) {
+    if (object_type == 2) {
         FragColor = directional_light_color;
         return;
     }
 
      // Calculate spotlight contribution
     vec4 spot_light_color = vec4(0.0);
-    if (spot_light.on) {
+    if (spot_light_on) {
         spot_light_color = CalcSpotLight(spot_light, norm, 
                                        fragment_position, view_position.xyz);
     }
@@ -310,60 +347,20 @@ void main()
     vec4 combined_light = directional_light_color + spot_light_color;
 
     //Object is textured
-    if ((fragment_shader_state == 1) || (fragment_shader_state == 3)) {
-        // can't index an array with a variable in GLSL
-        //  so we have to use a set of if statements.
-        if (index_for_texture == 0) {
-            FragColor = texture(textures[0],texture_coordinates);
-        } else if (index_for_texture == 1) {
-            FragColor = texture(textures[1],texture_coordinates);
-        } else if (index_for_texture == 2) {
-            FragColor = texture(textures[2],texture_coordinates);
-        } else if (index_for_texture == 3) {
-            FragColor = texture(textures[3],texture_coordinates);
-        } else if (index_for_texture == 4) {
-            FragColor = texture(textures[4],texture_coordinates);
-        } else if (index_for_texture == 5) {
-            FragColor = texture(textures[5],texture_coordinates);
-        } else if (index_for_texture == 6) {
-            FragColor = texture(textures[6],texture_coordinates);
-        } else if (index_for_texture == 7) {
-            FragColor = texture(textures[7],texture_coordinates);
-        } else if (index_for_texture == 8) {
-            FragColor = texture(textures[8],texture_coordinates);
-        } else if (index_for_texture == 9) {
-            FragColor = texture(textures[9],texture_coordinates);
-        } else if (index_for_texture == 10) {
-            FragColor = texture(textures[10],texture_coordinates);
-        } else if (index_for_texture == 11) {
-            FragColor = texture(textures[11],texture_coordinates);
-        } else if (index_for_texture == 12) {
-            FragColor = texture(textures[12],texture_coordinates);
-        } else if (index_for_texture == 13) {
-            FragColor = texture(textures[13],texture_coordinates);
-        } else if (index_for_texture == 14) {
-            FragColor = texture(textures[14],texture_coordinates);
-        } else if (index_for_texture == 15) {
-            FragColor = texture(textures[15],texture_coordinates);
-        } else if (index_for_texture == 16) {
-            FragColor = texture(textures[16],texture_coordinates);
-        } else if (index_for_texture == 17) {
-            FragColor = texture(textures[17],texture_coordinates);
-        } else if (index_for_texture == 18) {
-            FragColor = texture(textures[18],texture_coordinates);
-        }
+    if ((object_type == 1) || (object_type == 3)) {
         if (index_for_texture == 99) {
             FragColor = combined_light;
             return;
         }
-        FragColor = combined_light * FragColor;
+        // One texture lookup: the layer comes from the material, not from a branch per texture
+        FragColor = combined_light * sampleTexture(texture_coordinates);
         FragColor = applyPostProcessing(FragColor);
         return;
 
     }
 
     //otherwise fragment state is 0 (use the set color)
-    if (fragment_shader_state == 0) { // BASIC
+    if (object_type == 0) { // BASIC
         FragColor = color;  // Use the color directly for basic rendering
     } else {
         FragColor = combined_light * set_color;
@@ -373,12 +370,15 @@ void main()
 };
 
 vec4 CalcDirectionalLight (DirectionalLight light,vec3 norm,vec3 frag,vec3 eye) {
-    if (!light.on) {
+    if (!directional_light_on) {
         return vec4(0.0,0.0,0.0,1.0);
     }
     
     // Calculate shadow
-    float shadow = ShadowCalculation(FragPosLightSpace, norm, normalize(-light.direction.xyz));
+    float shadow = 0.0;
+    if (shadows_on) {
+        shadow = ShadowCalculation(FragPosLightSpace, norm, normalize(-light.direction.xyz));
+    }
     
     // Rest of directional light calculation 
     vec3 light_direction = normalize(-light.direction.xyz);
@@ -390,7 +390,7 @@ vec4 CalcDirectionalLight (DirectionalLight light,vec3 norm,vec3 frag,vec3 eye)
     float spec_coeff = pow(max(dot(view_direction,reflect_direction),0.0),256.0);
     
     // Apply shadow - multiply diffuse and specular components (not ambient)
-    if ((fragment_shader_state == 2) || (fragment_shader_state == 3)) {
+    if ((object_type == 2) || (object_type == 3)) {
         return (light.ambient * vec4(ambient_color,opacity) 
                 + (1.0 - shadow) * diffuse_coeff * light.diffuse * vec4(diffuse_color,opacity)
                 + (1.0 - shadow) * spec_coeff * light.specular * vec4(specular_color,opacity));
@@ -402,7 +402,7 @@ vec4 CalcDirectionalLight (DirectionalLight light,vec3 norm,vec3 frag,vec3 eye)
 }
 
 vec4 CalcSpotLight(SpotLight light, vec3 norm, vec3 frag, vec3 eye) {
-    if (!light.on) {
+    if (!spot_light_on) {
         return vec4(0.0, 0.0, 0.0, 1.0);
     }
 
@@ -435,7 +435,7 @@ vec4 CalcSpotLight(SpotLight light, vec3 norm, vec3 frag, vec3 eye) {
     vec4 ambient, diffuse, specular;
 
     // Handle materials
-    if ((fragment_shader_state == 2) || (fragment_shader_state == 3)) {
+    if ((object_type == 2) || (object_type == 3)) {
         ambient = light.ambient * vec4(ambient_color, opacity);
         diffuse = attenuation * intensity * diffuse_coeff * light.diffuse * vec4(diffuse_color, opacity);
         specular = attenuation * intensity * spec_coeff * light.specular * vec4(specular_color, opacity);
@@ -1,12 +1,20 @@
 #version 330 core
 layout (location = 0) in vec3 aPos;
-uniform mat4 view;
-uniform mat4 projection;
+
+//Per-frame camera data shared by every program (see FrameUniforms)
+layout (std140) uniform FrameCamera {
+  mat4 projection;
+  mat4 view;
+  //light space matrix of the shadow map
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+};
 
 out vec3 TexCoords;
 
 void main() {
     TexCoords = aPos;
-    vec4 pos = projection * view * vec4(aPos, 1.0);
+    // Only the rotation of the view is used, so the skybox stays centered on the camera
+    vec4 pos = projection * mat4(mat3(view)) * vec4(aPos, 1.0);
     gl_Position = pos.xyww;
 }
\ No newline at end of file
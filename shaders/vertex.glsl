@@ -8,16 +8,28 @@ layout (location = 0) in vec3 aPos;
 layout (location = 1) in vec3 aNorm;
 //texture coordinates for the vertex
 layout (location = 2) in vec2 aCoord;
-//ambient color data for the vertex
-layout (location = 3) in vec3 aColor;
-//diffuse color data for the vertex
-layout (location = 4) in vec3 dColor;
-//specular color data for the vertex
-layout (location = 5) in vec3 sColor;
-//opacitdy value for the vertex
-layout (location = 6) in float opacity_value;
-//index for the texture (for multiple textures on an imported object)
-layout (location = 7) in float texture_index;
+//row of the material table (imported objects)
+layout (location = 3) in uint material_index;
+//per-instance data of instanced draws (see InstanceData in basic_shape.hpp): the
+//  instance's model * local matrix and the tint of its materials
+layout (location = 4) in mat4 instance_transform;
+layout (location = 8) in vec4 instance_tint;
+
+//Material table of an imported object (one row per material, see
+//  MaterialTableEntry in import_object.hpp).  Materials can be changed without
+//  touching the object's vertices.
+#define MAX_MATERIALS 128
+struct MaterialData {
+  vec4 ambient;
+  //rgb = diffuse color, a = opacity
+  vec4 diffuse;
+  vec4 specular;
+  //x = texture index (99 if the material is not textured)
+  ivec4 texture_info;
+};
+layout (std140) uniform MaterialTable {
+  MaterialData materials[MAX_MATERIALS];
+};
 
 
 //note: "flat" is a key word that indicates this value stays the same 
@@ -50,48 +62,64 @@ out vec4 FragPosLightSpace;
 // uniform bool is_imported;
 
 //state for the shader
-uniform int shader_state;
 //  0: BasicShape objects that just have a set color (basic)
 //  1: BasicShape objects that have a texture
 //  2: Imported BasicShape objects that use materials from Blender
 //  3: Imported BasicShape objects that use materials and/or textures
+//A variant compiled for one object type (see ShaderPermutations) fixes the state at
+//  compile time; otherwise it comes from the shader_state uniform.
+#ifdef OBJECT_TYPE
+const int object_type = OBJECT_TYPE;
+#else
+uniform int shader_state;
+#define object_type shader_state
+#endif
 flat out int fragment_shader_state;
 
-//transformation matrices for the projection, view (camera), model (world), and 
-//  transform (local).  
-uniform mat4 projection, view, model, local;
-//light space matrix
-uniform mat4 lightSpaceMatrix;
+//Per-frame camera data shared by every program (see FrameUniforms)
+layout (std140) uniform FrameCamera {
+  mat4 projection;
+  mat4 view;
+  //light space matrix of the shadow map
+  mat4 lightSpaceMatrix;
+  vec4 view_position;
+};
+
+//transformation matrices for the model (world) and transform (local).  The
+//  projection and view (camera) matrices come from the FrameCamera block.
+uniform mat4 model, local;
+//true for instanced draws, which take the transform and tint from the instance data
+//  instead of model, local, and tint
+uniform bool instanced;
+//tint of the materials of a draw that is not instanced (see DrawItem in render_queue.hpp)
+uniform vec4 tint = vec4(1.0);
 
 void main()
 {
+  mat4 transform = instanced ? instance_transform : model * local;
+  vec4 material_tint = instanced ? instance_tint : tint;
   //See chapter 6.2.2 for this operation
-  norm = mat3(transpose(inverse(model*local))) * aNorm;
-  fragment_shader_state = shader_state;
-  if (shader_state == 1) {
+  norm = mat3(transpose(inverse(transform))) * aNorm;
+  fragment_shader_state = object_type;
+  if (object_type == 1) {
     //Basic shape with texture (pass s, t and index = 0)
     texture_coordinates = aCoord;
     index_for_texture = 0;
-  } else if (shader_state == 2) {
-    //Imported object using materials (no textures)
-    ambient_color = aColor;
-    diffuse_color = dColor;
-    specular_color = sColor;
-    opacity = opacity_value;
-  } else if (shader_state == 3) {
-    //Imported object using materials and textures
-    ambient_color = aColor;
-    diffuse_color = dColor;
-    specular_color = sColor;
-    opacity = opacity_value;
-    index_for_texture = int(texture_index);
+  } else if (object_type == 2 || object_type == 3) {
+    //Imported object using materials (and textures for state 3) from the material table
+    MaterialData material = materials[min(material_index, uint(MAX_MATERIALS - 1))];
+    ambient_color = material.ambient.rgb * material_tint.rgb;
+    diffuse_color = material.diffuse.rgb * material_tint.rgb;
+    specular_color = material.specular.rgb;
+    opacity = material.diffuse.a;
+    index_for_texture = material.texture_info.x;
   } else {
     //shader state is 0 so set_color is used in the 
     //  fragment shader.
   }
 
-  fragment_position = (model * local * vec4(aPos.x, aPos.y, aPos.z,1.0)).xyz;
+  fragment_position = (transform * vec4(aPos.x, aPos.y, aPos.z,1.0)).xyz;
   //figure out this vertex's location after applying the necessary matrices.
-  FragPosLightSpace = lightSpaceMatrix * model * local * vec4(aPos, 1.0);
+  FragPosLightSpace = lightSpaceMatrix * vec4(fragment_position, 1.0);
   gl_Position = projection * view * vec4(fragment_position,1.0);
 };
\ No newline at end of file
@@ -0,0 +1,332 @@
+#include "benchmarks.hpp"
+#include "build_shapes.hpp"
+#include "mesh_optimizer.hpp"
+#include "../classes/import_object.hpp"
+#include "../classes/thread_pool.hpp"
+
+#include <iostream>
+#include <iomanip>
+#include <filesystem>
+#include <algorithm>
+#include <chrono>
+#include <vector>
+#include <atomic>
+#include <fstream>
+#include <cstdio>
+#include <cstring>
+
+void RunImportBenchmark(std::string model_directory, int iterations) {
+    namespace fs = std::filesystem;
+
+    // Collect the base names (path without extension) of every .obj file
+    std::vector<fs::path> models;
+    std::error_code error;
+    for (const fs::directory_entry &entry : fs::directory_iterator(model_directory, error)) {
+        if (entry.path().extension() == ".obj") {
+            models.push_back(entry.path());
+        }
+    }
+    if (error || models.empty()) {
+        std::cout << "No .obj files found in " << model_directory << std::endl;
+        return;
+    }
+    std::sort(models.begin(), models.end());
+
+    ImportOBJ importer;
+    // Only the parser is timed, as before the mesh optimizer and levels of detail existed
+    importer.optimizeMeshes = false;
+    importer.generateLODs = false;
+    ImportedMesh mesh;
+
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "OBJ import benchmark (" << iterations << " iterations, best time)" << std::endl;
+    std::cout << std::left << std::setw(24) << "model" << std::right
+              << std::setw(12) << "bytes" << std::setw(12) << "vertices"
+              << std::setw(12) << "ms" << std::setw(12) << "MB/s" << std::endl;
+
+    double total_ms = 0.0;
+    uintmax_t total_bytes = 0;
+    for (const fs::path &obj_path : models) {
+        fs::path base = obj_path;
+        base.replace_extension();
+        fs::path mtl_path = base;
+        mtl_path.replace_extension(".mtl");
+
+        uintmax_t bytes = fs::file_size(obj_path, error);
+        if (fs::exists(mtl_path)) {
+            bytes += fs::file_size(mtl_path, error);
+        }
+
+        double best_ms = -1.0;
+        for (int i = 0; i < iterations; i++) {
+            auto start = std::chrono::high_resolution_clock::now();
+            importer.parseFiles(base.string(), mesh);
+            auto stop = std::chrono::high_resolution_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+            if (best_ms < 0.0 || ms < best_ms) {
+                best_ms = ms;
+            }
+        }
+
+        double mb_per_second = best_ms > 0.0 ? (bytes / (1024.0 * 1024.0)) / (best_ms / 1000.0) : 0.0;
+        std::cout << std::left << std::setw(24) << base.filename().string() << std::right
+                  << std::setw(12) << bytes << std::setw(12) << mesh.vertex_count
+                  << std::setw(12) << best_ms << std::setw(12) << mb_per_second << std::endl;
+        total_ms += best_ms;
+        total_bytes += bytes;
+    }
+
+    double total_mb_per_second = total_ms > 0.0 ? (total_bytes / (1024.0 * 1024.0)) / (total_ms / 1000.0) : 0.0;
+    std::cout << std::left << std::setw(24) << "total" << std::right
+              << std::setw(12) << total_bytes << std::setw(12) << ""
+              << std::setw(12) << total_ms << std::setw(12) << total_mb_per_second << std::endl;
+}
+
+// Reads every model and decodes every image on a pool with the given number of
+// threads and returns the wall-clock time in milliseconds
+static double TimeAssetLoad(const std::vector<std::string> &models, const std::vector<std::string> &images,
+                            int thread_count) {
+    ImportOBJ importer;
+    importer.useCache = false;
+    std::atomic<size_t> vertex_count(0);
+    auto start = std::chrono::steady_clock::now();
+    {
+        ThreadPool pool(thread_count);
+        for (const std::string &model : models) {
+            pool.Submit([&importer, &vertex_count, model]() {
+                ImportedMesh mesh;
+                importer.readMesh(model, mesh);
+                vertex_count += mesh.vertex_count;
+            });
+        }
+        for (const std::string &image_path : images) {
+            pool.Submit([image_path]() {
+                DecodedImage image = DecodeImage(image_path, true);
+                FreeImage(image);
+            });
+        }
+        // The pool finishes every task before it is destroyed
+    }
+    auto stop = std::chrono::steady_clock::now();
+    return std::chrono::duration<double, std::milli>(stop - start).count();
+}
+
+void RunLoadingBenchmark(std::string model_directory, std::string texture_directory, int iterations) {
+    namespace fs = std::filesystem;
+
+    std::vector<std::string> models;
+    std::vector<std::string> images;
+    std::error_code error;
+    for (const fs::directory_entry &entry : fs::directory_iterator(model_directory, error)) {
+        if (entry.path().extension() == ".obj") {
+            fs::path base = entry.path();
+            base.replace_extension();
+            models.push_back(base.string());
+        }
+    }
+    for (const fs::directory_entry &entry : fs::recursive_directory_iterator(texture_directory, error)) {
+        std::string extension = entry.path().extension().string();
+        if (extension == ".png" || extension == ".jpg") {
+            images.push_back(entry.path().string());
+        }
+    }
+    std::sort(models.begin(), models.end());
+    std::sort(images.begin(), images.end());
+
+    int thread_count = ThreadPool::HardwareThreads();
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Asset loading benchmark: " << models.size() << " models and " << images.size()
+              << " images, no mesh cache (" << iterations << " iterations, best time)" << std::endl;
+
+    double serial_ms = -1.0;
+    double parallel_ms = -1.0;
+    for (int i = 0; i < iterations; i++) {
+        double ms = TimeAssetLoad(models, images, 0);
+        if (serial_ms < 0.0 || ms < serial_ms) {
+            serial_ms = ms;
+        }
+        ms = TimeAssetLoad(models, images, thread_count);
+        if (parallel_ms < 0.0 || ms < parallel_ms) {
+            parallel_ms = ms;
+        }
+    }
+    std::cout << std::left << std::setw(24) << "serial" << std::right << std::setw(12) << serial_ms << " ms" << std::endl;
+    std::cout << std::left << std::setw(24) << (std::to_string(thread_count) + " threads") << std::right
+              << std::setw(12) << parallel_ms << " ms" << std::endl;
+    std::cout << std::left << std::setw(24) << "speedup" << std::right
+              << std::setw(12) << (parallel_ms > 0.0 ? serial_ms / parallel_ms : 0.0) << "x" << std::endl;
+}
+
+// Writes a grid of quads with the given number of triangles (plus a .mtl file with
+// two materials that alternate every few rows) and returns the base name
+static std::string WriteSyntheticOBJ(int triangles) {
+    namespace fs = std::filesystem;
+    int size = 1;
+    while (2 * size * size < triangles) {
+        size++;
+    }
+    std::string base = (fs::temp_directory_path() / "synthetic_grid").string();
+
+    std::ofstream mtl_file((base + ".mtl").c_str());
+    mtl_file << "newmtl Light\nKa 0.2 0.2 0.2\nKd 0.8 0.8 0.8\nKs 0.5 0.5 0.5\nd 1.0\n";
+    mtl_file << "newmtl Dark\nKa 0.1 0.1 0.1\nKd 0.2 0.3 0.4\nKs 0.5 0.5 0.5\nd 1.0\n";
+    mtl_file.close();
+
+    std::ofstream obj_file((base + ".obj").c_str(), std::ios::binary);
+    obj_file << "mtllib synthetic_grid.mtl\n";
+    char line[128];
+    for (int y = 0; y <= size; y++) {
+        for (int x = 0; x <= size; x++) {
+            float height = 0.05f * (float)((x * 7 + y * 13) % 17);
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\nvt %.6f %.6f\n",
+                     x * 0.01f, y * 0.01f, height, (float)x / size, (float)y / size);
+            obj_file << line;
+        }
+    }
+    obj_file << "vn 0.000000 0.000000 1.000000\n";
+    int row_length = size + 1;
+    for (int y = 0; y < size; y++) {
+        if (y % 50 == 0) {
+            obj_file << ((y / 50) % 2 == 0 ? "usemtl Light\n" : "usemtl Dark\n");
+        }
+        for (int x = 0; x < size; x++) {
+            int a = y * row_length + x + 1;
+            int b = a + 1;
+            int c = b + row_length;
+            int d = a + row_length;
+            snprintf(line, sizeof(line), "f %d/%d/1 %d/%d/1 %d/%d/1 %d/%d/1\n", a, a, b, b, c, c, d, d);
+            obj_file << line;
+        }
+    }
+    obj_file.close();
+    return base;
+}
+
+void RunParseBenchmark(int triangles, int iterations) {
+    std::cout << "Writing a synthetic model with " << triangles << " triangles..." << std::endl;
+    std::string base = WriteSyntheticOBJ(triangles);
+    std::error_code error;
+    uintmax_t bytes = std::filesystem::file_size(base + ".obj", error);
+
+    ImportOBJ importer;
+    // Optimizing or simplifying a million triangles (on one thread) would dwarf the parse
+    // being measured
+    importer.optimizeMeshes = false;
+    importer.generateLODs = false;
+    ImportedMesh reference;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Chunked OBJ parse benchmark (" << bytes / (1024 * 1024) << " MB, "
+              << iterations << " iterations, best time)" << std::endl;
+    std::cout << std::left << std::setw(12) << "threads" << std::right << std::setw(12) << "ms"
+              << std::setw(12) << "MB/s" << std::setw(12) << "speedup" << std::setw(12) << "identical" << std::endl;
+
+    double single_thread_ms = 0.0;
+    for (int threads : {1, 2, 4, 8}) {
+        importer.parseThreads = threads;
+        ImportedMesh mesh;
+        double best_ms = -1.0;
+        for (int i = 0; i < iterations; i++) {
+            auto start = std::chrono::steady_clock::now();
+            importer.parseFiles(base, mesh);
+            auto stop = std::chrono::steady_clock::now();
+            double ms = std::chrono::duration<double, std::milli>(stop - start).count();
+            if (best_ms < 0.0 || ms < best_ms) {
+                best_ms = ms;
+            }
+        }
+        if (threads == 1) {
+            single_thread_ms = best_ms;
+            reference = mesh;
+        }
+        // The chunked parse must produce exactly the same buffers as the serial one
+        bool identical = mesh.vertex_count == reference.vertex_count && mesh.index_count == reference.index_count &&
+                         mesh.index_size == reference.index_size &&
+                         memcmp(mesh.Vertices(), reference.Vertices(), mesh.vertex_count * mesh.vertex_stride) == 0 &&
+                         memcmp(mesh.Indices(), reference.Indices(), (size_t)mesh.index_count * mesh.index_size) == 0;
+        double mb_per_second = best_ms > 0.0 ? (bytes / (1024.0 * 1024.0)) / (best_ms / 1000.0) : 0.0;
+        std::cout << std::left << std::setw(12) << threads << std::right << std::setw(12) << best_ms
+                  << std::setw(12) << mb_per_second << std::setw(12) << (best_ms > 0.0 ? single_thread_ms / best_ms : 0.0)
+                  << std::setw(12) << (identical ? "yes" : "NO") << std::endl;
+    }
+    std::cout << "(" << ThreadPool::HardwareThreads() << " hardware threads available)" << std::endl;
+
+    std::filesystem::remove(base + ".obj", error);
+    std::filesystem::remove(base + ".mtl", error);
+}
+
+void RunVertexCacheBenchmark(std::string model_directory) {
+    namespace fs = std::filesystem;
+
+    std::vector<fs::path> models;
+    std::error_code error;
+    for (const fs::directory_entry &entry : fs::directory_iterator(model_directory, error)) {
+        if (entry.path().extension() == ".obj") {
+            fs::path base = entry.path();
+            base.replace_extension();
+            models.push_back(base);
+        }
+    }
+    if (error || models.empty()) {
+        std::cout << "No .obj files found in " << model_directory << std::endl;
+        return;
+    }
+    std::sort(models.begin(), models.end());
+
+    // Parse without the cache or the optimizer to get the order the files were written in
+    ImportOBJ importer;
+    importer.useCache = false;
+    importer.optimizeMeshes = false;
+    importer.generateLODs = false;
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Vertex cache benchmark (" << VERTEX_CACHE_SIZE << " entry FIFO cache)" << std::endl;
+    std::cout << std::left << std::setw(24) << "model" << std::right
+              << std::setw(12) << "triangles" << std::setw(12) << "vertices"
+              << std::setw(12) << "ACMR" << std::setw(12) << "optimized"
+              << std::setw(12) << "ATVR" << std::setw(12) << "optimized" << std::setw(12) << "ms" << std::endl;
+
+    size_t total_triangles = 0;
+    size_t total_vertices = 0;
+    double total_misses_before = 0.0;
+    double total_misses_after = 0.0;
+    for (const fs::path &base : models) {
+        ImportedMesh mesh;
+        if (!importer.parseFiles(base.string(), mesh) || mesh.index_count == 0) {
+            continue;
+        }
+        std::vector<unsigned int> indices;
+        if (mesh.index_size == sizeof(unsigned short)) {
+            indices.assign(mesh.short_index_storage.begin(), mesh.short_index_storage.end());
+        } else {
+            indices = mesh.index_storage;
+        }
+        std::vector<glm::vec3> positions;
+        for (const CompleteVertex &vertex : mesh.vertex_storage) {
+            positions.push_back(vertex.Position);
+        }
+
+        VertexCacheStats before = AnalyzeVertexCache(indices, positions.size());
+        auto start = std::chrono::steady_clock::now();
+        OptimizeMesh(indices, positions);
+        double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+        VertexCacheStats after = AnalyzeVertexCache(indices, positions.size());
+
+        size_t triangles = indices.size() / 3;
+        std::cout << std::left << std::setw(24) << base.filename().string() << std::right
+                  << std::setw(12) << triangles << std::setw(12) << positions.size()
+                  << std::setw(12) << before.acmr << std::setw(12) << after.acmr
+                  << std::setw(12) << before.atvr << std::setw(12) << after.atvr << std::setw(12) << ms << std::endl;
+        total_triangles += triangles;
+        total_vertices += positions.size();
+        total_misses_before += before.acmr * triangles;
+        total_misses_after += after.acmr * triangles;
+    }
+    if (total_triangles > 0 && total_vertices > 0) {
+        std::cout << std::left << std::setw(24) << "total" << std::right
+                  << std::setw(12) << total_triangles << std::setw(12) << total_vertices
+                  << std::setw(12) << total_misses_before / total_triangles
+                  << std::setw(12) << total_misses_after / total_triangles
+                  << std::setw(12) << total_misses_before / total_vertices
+                  << std::setw(12) << total_misses_after / total_vertices << std::endl;
+    }
+}
@@ -0,0 +1,44 @@
+#ifndef BENCHMARKS_HPP
+#define BENCHMARKS_HPP
+
+#include <string>
+
+//Command line flag that runs the import benchmark instead of the simulator
+const std::string BENCHMARK_IMPORT_FLAG = "--benchmark-import";
+
+//Command line flag that runs the asset loading benchmark instead of the simulator
+const std::string BENCHMARK_LOADING_FLAG = "--benchmark-loading";
+
+//Command line flag that runs the chunked (multi-threaded) parse benchmark
+const std::string BENCHMARK_PARSE_FLAG = "--benchmark-parse";
+
+//Command line flag that reports how the mesh optimizer changes vertex cache use
+const std::string BENCHMARK_VERTEX_CACHE_FLAG = "--benchmark-vertex-cache";
+
+//Command line flag that loads the scene on the main thread only (to compare with
+// the default multi-threaded loading)
+const std::string SERIAL_LOADING_FLAG = "--serial-loading";
+
+//Parses every .obj/.mtl pair in the given directory (textures are not loaded and
+// no OpenGL context is needed) and prints the parse time (ms per model, best of the
+// given number of iterations) and throughput (MB/s) for each model and in total.
+void RunImportBenchmark(std::string model_directory = "models", int iterations = 5);
+
+//Reads every model in the model directory and decodes every .png/.jpg in the texture
+// directory, first serially and then on a thread pool with one thread per hardware
+// thread (the CPU side of the scene loader, without OpenGL uploads), and prints the
+// wall-clock times.
+void RunLoadingBenchmark(std::string model_directory = "models", std::string texture_directory = "textures",
+                         int iterations = 3);
+
+//Writes a synthetic grid model with the given number of triangles to the temporary
+// directory, parses it with 1, 2, 4, and 8 threads, and prints the time, throughput,
+// and speedup for each, and whether the result matches the single-threaded parse.
+void RunParseBenchmark(int triangles = 1000000, int iterations = 3);
+
+//Parses every .obj/.mtl pair in the given directory in the order it was written, runs
+// the mesh optimizer on it, and prints the ACMR and ATVR (see mesh_optimizer.hpp) of a
+// simulated post-transform cache before and after for each model and in total.
+void RunVertexCacheBenchmark(std::string model_directory = "models");
+
+#endif //BENCHMARKS_HPP
@@ -1,76 +1,143 @@
 #include "build_shapes.hpp"
+#include "../classes/gl_state.hpp"
 #include "stb_image_implementation.hpp"
 
 #include <vector>
+#include <map>
+#include <algorithm>
 #include <cmath>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+
+// Textures loaded by GetTexture, keyed by path and flip setting
+struct CachedTexture {
+    unsigned int id = 0;
+    size_t bytes = 0;
+};
+static std::map<std::pair<std::string, bool>, CachedTexture> texture_cache;
+static TextureCacheStats texture_cache_stats;
+
+DecodedImage DecodeImage (std::string path, bool flipped)
+{
+    DecodedImage image;
+    image.path = path;
+    auto start = std::chrono::steady_clock::now();
+    // The flip setting is per thread, so images can be decoded on several threads at once
+    stbi_set_flip_vertically_on_load_thread(flipped);
+    image.pixels = stbi_load(path.c_str(), &image.width, &image.height, &image.channels, 0);
+    image.decode_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return image;
+}
 
-unsigned int GetTexture (std::string texture_path, bool flipped)
+void FreeImage (DecodedImage &image)
+{
+    if (image.pixels != NULL) {
+        stbi_image_free(image.pixels);
+        image.pixels = NULL;
+    }
+}
+
+unsigned int UploadTexture (DecodedImage &image)
 {
+    if (image.pixels == NULL)
+    {
+        std::cout << "Failed to load texture: " << image.path<<std::endl;
+        return 0;
+    }
+
     unsigned int texture;
     glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
+    GLState::BindTexture(GL_TEXTURE_2D, texture);
     // set the texture wrapping/filtering options (on the currently bound texture object)
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);	
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
     glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
-    if (flipped) {
-        stbi_set_flip_vertically_on_load(true);
-    } else {
-        stbi_set_flip_vertically_on_load(false);
-    }
-
-    // load and generate the texture
-    int width, height, nrChannels;
-    unsigned char *data = stbi_load(texture_path.c_str(), &width, &height, &nrChannels, 0);
     int channel_type = GL_RGB;
-    if (nrChannels == 4) {
+    if (image.channels == 4) {
         channel_type = GL_RGBA;
     }
+    glTexImage2D(GL_TEXTURE_2D, 0, channel_type, image.width, image.height, 0, channel_type, GL_UNSIGNED_BYTE, image.pixels);
+    glGenerateMipmap(GL_TEXTURE_2D);
+    FreeImage(image);
+    return texture;
+}
 
-    if (data)
-    {
-        glTexImage2D(GL_TEXTURE_2D, 0, channel_type, width, height, 0, channel_type, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);
+size_t TextureBytes (const DecodedImage &image, bool mipmapped)
+{
+    size_t bytes = (size_t)image.width * image.height * image.channels;
+    return mipmapped ? bytes * 4 / 3 : bytes;
+}
+
+unsigned int GetTexture (std::string texture_path, bool flipped)
+{
+    std::pair<std::string, bool> key(texture_path, flipped);
+    std::map<std::pair<std::string, bool>, CachedTexture>::iterator found = texture_cache.find(key);
+    if (found != texture_cache.end()) {
+        texture_cache_stats.hits++;
+        return found->second.id;
     }
-    else
-    {
-        std::cout << "Failed to load texture: " << texture_path<<std::endl;
-        return 0;
+
+    texture_cache_stats.misses++;
+    DecodedImage image = DecodeImage(texture_path, flipped);
+    texture_cache_stats.decode_ms += image.decode_ms;
+    size_t bytes = TextureBytes(image);
+    unsigned int texture = UploadTexture(image);
+    // Files that could not be read are not cached, so every request reports them
+    if (texture != 0) {
+        texture_cache[key].id = texture;
+        texture_cache[key].bytes = bytes;
+        texture_cache_stats.textures++;
+        texture_cache_stats.resident_bytes += bytes;
     }
-    stbi_image_free(data);
     return texture;
 }
 
-unsigned int GetCubeMap(const std::vector<std::string>& faces, bool flip) {
+TextureCacheStats GetTextureCacheStats ()
+{
+    return texture_cache_stats;
+}
+
+void PrintTextureCacheStats (std::string label, const TextureCacheStats &stats)
+{
+    std::ostringstream report;
+    report<<std::fixed<<std::setprecision(1);
+    report<<label<<": "<<stats.hits<<" hits, "<<stats.misses<<" misses ("<<stats.decode_ms<<" ms decoding), "
+          <<stats.textures<<" textures resident ("<<stats.resident_bytes/1024.0<<" KB)";
+    std::cout<<report.str()<<std::endl;
+}
+
+void ClearTextureCache ()
+{
+    for (std::pair<const std::pair<std::string, bool>, CachedTexture> &entry : texture_cache) {
+        GLState::DeleteTextures(1, &(entry.second.id));
+    }
+    texture_cache.clear();
+    texture_cache_stats.textures = 0;
+    texture_cache_stats.resident_bytes = 0;
+}
+
+unsigned int UploadCubeMap(std::vector<DecodedImage>& faces) {
     unsigned int textureID;
     glGenTextures(1, &textureID);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, textureID);
-
-    // Control vertical flip
-    stbi_set_flip_vertically_on_load(flip);
+    GLState::BindTexture(GL_TEXTURE_CUBE_MAP, textureID);
 
     for (unsigned int i = 0; i < faces.size(); i++) {
-        int width, height, nrChannels;
-        unsigned char *data = stbi_load(faces[i].c_str(), &width, &height, &nrChannels, 0);
-        if (data) {
-            GLenum format = (nrChannels == 3 ? GL_RGB : GL_RGBA);
+        if (faces[i].pixels) {
+            GLenum format = (faces[i].channels == 3 ? GL_RGB : GL_RGBA);
             glTexImage2D(
                 GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
-                0, format, width, height, 0,
-                format, GL_UNSIGNED_BYTE, data
+                0, format, faces[i].width, faces[i].height, 0,
+                format, GL_UNSIGNED_BYTE, faces[i].pixels
             );
-            stbi_image_free(data);
+            FreeImage(faces[i]);
         } else {
-            std::cerr << "Cubemap texture failed to load at " << faces[i] << std::endl;
-            stbi_image_free(data);
+            std::cerr << "Cubemap texture failed to load at " << faces[i].path << std::endl;
         }
     }
 
-    // Reset to default
-    stbi_set_flip_vertically_on_load(false);
-
     // Filtering and wrapping
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
     glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
@@ -81,6 +148,109 @@ unsigned int GetCubeMap(const std::vector<std::string>& faces, bool flip) {
     return textureID;
 }
 
+// Returns the size every layer of a texture array built from the images is resized to
+static void TextureArraySize(const std::vector<DecodedImage>& layers, int &width, int &height) {
+    width = 1;
+    height = 1;
+    for (const DecodedImage &layer : layers) {
+        if (layer.pixels != NULL) {
+            width = std::max(width, layer.width);
+            height = std::max(height, layer.height);
+        }
+    }
+}
+
+// Resamples an image (1 to 4 channels) to RGBA at the given size with bilinear filtering
+static void ResampleToRGBA(const DecodedImage &image, int width, int height, std::vector<unsigned char> &rgba) {
+    rgba.assign((size_t)width * height * 4, 255);
+    if (image.pixels == NULL) {
+        return;
+    }
+    int channels = image.channels;
+    // Reads a texel as RGBA (gray images repeat their value, and images without alpha are opaque)
+    auto texel = [&image, channels](int x, int y, float out[4]) {
+        const unsigned char *p = image.pixels + ((size_t)y * image.width + x) * channels;
+        if (channels >= 3) {
+            out[0] = p[0];
+            out[1] = p[1];
+            out[2] = p[2];
+            out[3] = channels == 4 ? p[3] : 255.0f;
+        } else {
+            out[0] = out[1] = out[2] = p[0];
+            out[3] = channels == 2 ? p[1] : 255.0f;
+        }
+    };
+    for (int y = 0; y < height; y++) {
+        // Sample at texel centers so an image of the same size is copied unchanged
+        float source_y = std::max(0.0f, (y + 0.5f) * image.height / height - 0.5f);
+        int y0 = std::min((int)source_y, image.height - 1);
+        int y1 = std::min(y0 + 1, image.height - 1);
+        float fy = source_y - y0;
+        for (int x = 0; x < width; x++) {
+            float source_x = std::max(0.0f, (x + 0.5f) * image.width / width - 0.5f);
+            int x0 = std::min((int)source_x, image.width - 1);
+            int x1 = std::min(x0 + 1, image.width - 1);
+            float fx = source_x - x0;
+            float a[4], b[4], c[4], d[4];
+            texel(x0, y0, a);
+            texel(x1, y0, b);
+            texel(x0, y1, c);
+            texel(x1, y1, d);
+            unsigned char *out = &rgba[((size_t)y * width + x) * 4];
+            for (int i = 0; i < 4; i++) {
+                float top = a[i] + (b[i] - a[i]) * fx;
+                float bottom = c[i] + (d[i] - c[i]) * fx;
+                out[i] = (unsigned char)(top + (bottom - top) * fy + 0.5f);
+            }
+        }
+    }
+}
+
+unsigned int UploadTextureArray(std::vector<DecodedImage>& layers) {
+    int width, height;
+    TextureArraySize(layers, width, height);
+    unsigned int textureID;
+    glGenTextures(1, &textureID);
+    GLState::BindTexture(GL_TEXTURE_2D_ARRAY, textureID);
+    glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_RGBA8, width, height, (GLsizei)std::max<size_t>(layers.size(), 1), 0,
+                 GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+
+    std::vector<unsigned char> rgba;
+    for (unsigned int i = 0; i < layers.size(); i++) {
+        if (layers[i].pixels == NULL) {
+            std::cout << "Failed to load texture: " << layers[i].path << std::endl;
+        } else if (layers[i].width != width || layers[i].height != height) {
+            std::cout << "Texture " << layers[i].path << " resized from " << layers[i].width << "x"
+                      << layers[i].height << " to " << width << "x" << height << std::endl;
+        }
+        ResampleToRGBA(layers[i], width, height, rgba);
+        glTexSubImage3D(GL_TEXTURE_2D_ARRAY, 0, 0, 0, i, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, rgba.data());
+        FreeImage(layers[i]);
+    }
+
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+    glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    glGenerateMipmap(GL_TEXTURE_2D_ARRAY);
+    return textureID;
+}
+
+size_t TextureArrayBytes(const std::vector<DecodedImage>& layers) {
+    int width, height;
+    TextureArraySize(layers, width, height);
+    size_t bytes = (size_t)width * height * 4 * std::max<size_t>(layers.size(), 1);
+    return bytes * 4 / 3;
+}
+
+unsigned int GetCubeMap(const std::vector<std::string>& faces, bool flip) {
+    std::vector<DecodedImage> images;
+    for (unsigned int i = 0; i < faces.size(); i++) {
+        images.push_back(DecodeImage(faces[i], flip));
+    }
+    return UploadCubeMap(images);
+}
+
 BasicShape GetTexturedRectangle (VAOStruct vao, glm::vec3 bottom_left, float width, 
                                  float height,float texture_size, bool flipped)
 {   
@@ -310,6 +480,47 @@ BasicShape GetTexturedCircle (VAOStruct vao, float radius, int points, glm::vec3
     return new_shape;
 }
 
+BasicShape GetWireBox (VAOStruct vao) {
+    float box_vert[8*6]{};
+    for (int i = 0; i < 8; i++) {
+        //Corner i has x, y, and z set by bits 0, 1, and 2 (the normal is unused)
+        box_vert[i*6] = (float)(i & 1);
+        box_vert[i*6+1] = (float)((i >> 1) & 1);
+        box_vert[i*6+2] = (float)((i >> 2) & 1);
+    }
+    
+    BasicShape new_shape;
+    new_shape.Initialize(vao,box_vert,sizeof(box_vert),8,GL_LINES);
+
+    //the twelve edges join corners that differ in one bit
+    unsigned int indices[] = {0,1, 2,3, 4,5, 6,7,
+                              0,2, 1,3, 4,6, 5,7,
+                              0,4, 1,5, 2,6, 3,7};
+    new_shape.InitializeEBO(indices,sizeof(indices),24,GL_LINES);
+    return new_shape;
+}
+
+BasicShape GetWireSphere (VAOStruct vao, int segments) {
+    std::vector<float> sphere_vert;
+    std::vector<unsigned int> indices;
+    for (int axis = 0; axis < 3; axis++) {
+        unsigned int first = sphere_vert.size() / 6;
+        for (int i = 0; i < segments; i++) {
+            float angle = glm::radians(360.0f * i / segments);
+            glm::vec3 point(0.0f);
+            point[(axis + 1) % 3] = cos(angle);
+            point[(axis + 2) % 3] = sin(angle);
+            sphere_vert.insert(sphere_vert.end(), {point.x, point.y, point.z, point.x, point.y, point.z});
+            indices.push_back(first + i);
+            indices.push_back(first + (i + 1) % segments);
+        }
+    }
+
+    BasicShape new_shape;
+    new_shape.Initialize(vao,sphere_vert.data(),sphere_vert.size()*sizeof(float),sphere_vert.size()/6,GL_LINES);
+    new_shape.InitializeEBO(indices.data(),indices.size()*sizeof(unsigned int),indices.size(),GL_LINES);
+    return new_shape;
+}
 
 BasicShape GetStars (VAOStruct vao, int number_stars)
 {
@@ -377,24 +588,6 @@ BasicShape GetCube(VAOStruct vao) {
          1.0f, -1.0f,  1.0f
     };
 
-    unsigned int VBO;
-    glGenBuffers(1, &VBO);
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);
-    glBufferData(GL_ARRAY_BUFFER, sizeof(skyboxVertices), skyboxVertices, GL_STATIC_DRAW);
-    
-    glBindVertexArray(vao.id);
-    for (const auto& attribute : vao.attributes) {
-        glEnableVertexAttribArray(attribute.number_per_vertex);
-        glVertexAttribPointer(
-            attribute.number_per_vertex, 
-            attribute.number_per_vertex, 
-            attribute.type_data, 
-            attribute.normalize_data, 
-            attribute.stride_bytes, 
-            (void*)(uintptr_t)attribute.offset_bytes
-        );
-    }
-    
     BasicShape new_shape;
     new_shape.Initialize(vao, skyboxVertices, sizeof(skyboxVertices), 36, GL_TRIANGLES);
     return new_shape;
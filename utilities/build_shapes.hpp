@@ -3,10 +3,71 @@
 
 #include "../classes/basic_shape.hpp"
 
+//Pixels of an image file decoded into memory (pixels is NULL if the file could not be read)
+struct DecodedImage {
+    std::string path;
+    int width = 0;
+    int height = 0;
+    int channels = 0;
+    unsigned char *pixels = NULL;
+    //Time spent decoding the file
+    double decode_ms = 0.0;
+};
+
+//Counters of a texture cache
+struct TextureCacheStats {
+    //Requests answered with a texture that was already loaded
+    int hits = 0;
+    //Requests that decoded and uploaded a new texture
+    int misses = 0;
+    //Textures currently held by the cache and the GPU memory they use
+    int textures = 0;
+    size_t resident_bytes = 0;
+    //Time spent decoding the images of the misses
+    double decode_ms = 0.0;
+};
+
+//Decodes an image file without making any OpenGL calls, so it can run on a worker thread.
+// The pixels are released by UploadTexture/UploadCubeMap or FreeImage.
+DecodedImage DecodeImage (std::string path, bool flipped = false);
+
+//Releases the pixels of a decoded image
+void FreeImage (DecodedImage &image);
+
+//Creates a texture from a decoded image (on the OpenGL context thread), frees the pixels,
+// and returns the texture identifier (0 if the image could not be decoded)
+unsigned int UploadTexture (DecodedImage &image);
+
+//Returns the bytes a decoded image uses on the GPU (mipmaps add a third)
+size_t TextureBytes (const DecodedImage &image, bool mipmapped = true);
+
 //Loads a texture and returns an identifier for that texture given a string input 
 // representing the filepath/name for the texture file input.
+// Textures are cached by path and flip setting: asking for the same file again
+// returns the texture that was already loaded (call on the OpenGL context thread).
 unsigned int GetTexture (std::string texture_path, bool flipped = false);
 
+//Returns the counters of the GetTexture cache
+TextureCacheStats GetTextureCacheStats ();
+
+//Prints the counters of a texture cache on one line
+void PrintTextureCacheStats (std::string label, const TextureCacheStats &stats);
+
+//Deletes every texture loaded by GetTexture (call before the OpenGL context is destroyed)
+void ClearTextureCache ();
+
+//Creates a cubemap from six decoded images (frees their pixels). Returns OpenGL texture ID.
+unsigned int UploadCubeMap(std::vector<DecodedImage>& faces);
+
+//Creates a 2D texture array with one layer per decoded image (frees their pixels) and returns
+// its identifier.  Layers are converted to RGBA and resized to the largest width and height
+// among the images, so texture coordinates keep their meaning; images that could not be
+// decoded become white layers.
+unsigned int UploadTextureArray(std::vector<DecodedImage>& layers);
+
+//Returns the bytes UploadTextureArray will use on the GPU for the images (with mipmaps)
+size_t TextureArrayBytes(const std::vector<DecodedImage>& layers);
+
 //Loads a cubemap from six image paths. Returns OpenGL texture ID.
 unsigned int GetCubeMap(const std::vector<std::string>& faces, bool flip = false);
 
@@ -43,6 +104,14 @@ BasicShape GetCircle (VAOStruct vao, float radius=1.0, int points= 40, glm::vec3
 BasicShape GetTexturedCircle (VAOStruct vao, float radius=1.0, int points= 40, glm::vec3 location = glm::vec3(0.0));
 
 
+//Creates and returns a BasicShape outline of the unit box from (0,0,0) to (1,1,1) given a VAO
+// (position and normal).  Draw it with DrawEBO (GL_LINES).
+BasicShape GetWireBox (VAOStruct vao);
+
+//Creates and returns a BasicShape outline of the unit sphere (three circles, one around each axis)
+// given a VAO (position and normal) and the number of segments per circle.  Draw it with DrawEBO (GL_LINES).
+BasicShape GetWireSphere (VAOStruct vao, int segments = 32);
+
 //Creates and returns a BasicShape star field given the number of random numbers to display
 BasicShape GetStars (VAOStruct vao, int number_stars);
 
@@ -1,4 +1,5 @@
 #include "environment.hpp"
+#include "../classes/gl_state.hpp"
 
 GLFWwindow* InitializeEnvironment (string window_title, int window_width, int window_height) 
 {
@@ -39,7 +40,7 @@ GLFWwindow* InitializeEnvironment (string window_title, int window_width, int wi
     //then width then height of the window in pixels
     //Below this means a point at (-0.5, 0.5) in normalized device coordinates ends up at 
     //   location (200, 450)
-    glViewport(0,0,window_width,window_height);
+    GLState::Viewport(0,0,window_width,window_height);
 
     //Set the window resize callback.
     glfwSetFramebufferSizeCallback(window,framebuffer_size_callback);
@@ -51,7 +52,7 @@ GLFWwindow* InitializeEnvironment (string window_title, int window_width, int wi
 //The window, width, and height are provided to this function when the window is resized.
 void framebuffer_size_callback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    GLState::Viewport(0, 0, width, height);
 }  
 
 void PrintColor (glm::vec4 vec) {
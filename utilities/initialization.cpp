@@ -1,6 +1,7 @@
 #include "initialization.hpp"
 #include "input_handling.hpp"
 #include "../classes/object_types.hpp"
+#include "../classes/gl_state.hpp"
 #include <iostream>
 #include <glm/gtc/matrix_transform.hpp>
 
@@ -31,6 +32,13 @@ void CreateShaders(Shader*& shader_program_ptr, Shader*& font_program_ptr) {
     std::cout << "Shaders created" << std::endl;
 }
 
+void CreateShaderPermutations(ShaderPermutations*& scene_permutations) {
+    scene_permutations = new ShaderPermutations(".//shaders//vertex.glsl", ".//shaders//fragment.glsl");
+    // Other variants are compiled the first time a frame uses them
+    makeScenePrograms(*scene_permutations, ShaderVariantKey());
+    std::cout << "Shader variants created (" << scene_permutations->CompiledCount() << " compiled)" << std::endl;
+}
+
 void CreateDepthShader(Shader*& depth_shader) {
     depth_shader = new Shader("shaders/depthVertexShader.glsl", "shaders/depthFragmentShader.glsl");
     if (depth_shader == nullptr) {
@@ -65,13 +73,12 @@ void SetupAvatars(Avatar& baseAvatar, AvatarHighBar*& high_bar_avatar, GameModel
     std::cout << "Avatars setup complete" << std::endl;
 }
 
-void SetupCameraAndProjection(Shader* shader_program_ptr, unsigned int scr_width, unsigned int scr_height) {
-    // Set up projection matrix
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (1.0f * scr_width) / (1.0f * scr_height), 0.1f, 100.0f);
-    shader_program_ptr->setMat4("projection", projection);
+void SetupCameraAndProjection(FrameUniforms& frame_uniforms) {
+    // Create the per-frame camera and lighting blocks (filled in every frame by updateFrameUniforms)
+    frame_uniforms.Initialize();
     
     // Setup lighting 
-    setupLighting(shader_program_ptr, point_light_color, light_direction, camera);
+    setupLighting(frame_uniforms);
     
     std::cout << "Camera and projection setup complete" << std::endl;
 }
@@ -82,8 +89,8 @@ void SetupFontShader(Shader* font_program_ptr) {
     glm::mat4 identity(1.0);
     font_program_ptr->setMat4("local", identity);
     font_program_ptr->setMat4("model", identity);
-    font_program_ptr->setMat4("view", identity);
-    font_program_ptr->setMat4("projection", glm::ortho(-1.0, 1.0, -1.0, 1.0, -1.0, 1.0));
+    // The font is drawn straight to the screen instead of through the frame's camera
+    font_program_ptr->BindUniformBlock("FrameCamera", SCREEN_CAMERA_BINDING);
     font_program_ptr->setVec4("transparentColor", glm::vec4(0.0f, 0.0f, 0.0f, 1.0f));
     font_program_ptr->setFloat("alpha", 1.0); // Make sure alpha is set to 1.0 for full opacity
     font_program_ptr->setInt("texture1", 0);
@@ -93,9 +100,9 @@ void SetupFontShader(Shader* font_program_ptr) {
 
 void SetupRendering() {
     // Set up the depth test and blending
-    glEnable(GL_DEPTH_TEST);
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Enable(GL_DEPTH_TEST);
+    GLState::Enable(GL_BLEND);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     std::cout << "Rendering setup complete" << std::endl;
 }
\ No newline at end of file
@@ -13,11 +13,15 @@
 // Function declarations for initialization tasks
 void InitializeMouseSettings(GLFWwindow* window);
 void CreateShaders(Shader*& shader_program_ptr, Shader*& font_program_ptr);
+//Creates the variants of the scene program and compiles those of the default features
+// (both lights and shadows on, no effect) for every object type
+void CreateShaderPermutations(ShaderPermutations*& scene_permutations);
 void CreateDepthShader(Shader*& depth_shader);
 void CreatePostProcessingShader(Shader*& post_processing_shader);
 void CreateSkyboxShader(Shader*& skybox_shader);
 void SetupAvatars(Avatar& baseAvatar, AvatarHighBar*& high_bar_avatar, GameModels& models);
-void SetupCameraAndProjection(Shader* shader_program_ptr, unsigned int scr_width, unsigned int scr_height);
+//Creates the per-frame uniform blocks and sets their constant lighting values
+void SetupCameraAndProjection(FrameUniforms& frame_uniforms);
 void SetupFontShader(Shader* font_program_ptr);
 void SetupRendering();
 
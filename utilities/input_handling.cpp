@@ -1,10 +1,19 @@
 #include "input_handling.hpp"
+#include "rendering.hpp"
 #include <iostream>
 
 // Make spotlight_on and point_light_on global variables accessible from other files
 bool spotlight_on = true;  // Initialize to true
 bool point_light_on = true;  // Initialize to true
 bool hud_visible = true; // HUD is visible by default
+bool lods_enabled = true; // Distant models use their levels of detail by default
+bool bounds_visible = false; // The bounds overlay is hidden by default
+bool shadow_caster_culling = true; // The shadow pass only draws casters inside the light's frustum
+bool shadows_enabled = true; // Shadows are drawn by default
+bool shader_permutations_enabled = true; // Each object type is drawn with a variant compiled for the frame's features
+bool instancing_enabled = true; // Copies of a mesh are drawn with one instanced draw
+bool crowd_enabled = false; // The crowd stress mode is off by default
+bool static_batching_enabled = true; // The objects that never move are drawn from the static batch
 
 // Variables to track arrow key states
 static bool up_key_pressed = false;
@@ -19,6 +28,14 @@ void ProcessInput(GLFWwindow *window) {
     static bool p_key_pressed = false;
     static bool effect_key_pressed = false;
     static bool h_key_pressed = false;
+    static bool o_key_pressed = false;
+    static bool v_key_pressed = false;
+    static bool k_key_pressed = false;
+    static bool g_key_pressed = false;
+    static bool u_key_pressed = false;
+    static bool i_key_pressed = false;
+    static bool n_key_pressed = false;
+    static bool t_key_pressed = false;
 
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)
         glfwSetWindowShouldClose(window, true);
@@ -38,11 +55,6 @@ void ProcessInput(GLFWwindow *window) {
                 point_light_color = glm::vec3(0.0f, 0.0f, 1.0f);
                 std::cout << "Point light color changed to blue" << std::endl;
             }
-            
-            // Update the light color in the shader
-            shader_program_ptr->setVec4("directional_light.ambient", glm::vec4(0.5f * point_light_color, 1.0f));
-            shader_program_ptr->setVec4("directional_light.diffuse", glm::vec4(point_light_color, 1.0f));
-            shader_program_ptr->setVec4("directional_light.specular", glm::vec4(0.5f * point_light_color, 1.0f));
         }
     } else {
         r_key_pressed = false;
@@ -100,10 +112,8 @@ void ProcessInput(GLFWwindow *window) {
         right_key_pressed = false;
     }
     
-    // Update the light direction in the shader if it changed
-    if (light_direction_changed && shader_program_ptr) {
-        shader_program_ptr->use();
-        shader_program_ptr->setVec4("directional_light.direction", light_direction);
+    // The frame's lighting block picks up the new direction
+    if (light_direction_changed) {
         std::cout << "Light direction updated to: (" << 
             light_direction.x << ", " << 
             light_direction.y << ", " << 
@@ -181,12 +191,6 @@ void ProcessInput(GLFWwindow *window) {
         if (!l_key_pressed) {
             l_key_pressed = true;
             spotlight_on = !spotlight_on;
-            
-            // Make sure we update the shader with the current state
-            if (shader_program_ptr) {
-                shader_program_ptr->use();
-                shader_program_ptr->setBool("spot_light.on", spotlight_on);
-            }
 
             // Print feedback
             if (spotlight_on) {
@@ -204,12 +208,6 @@ void ProcessInput(GLFWwindow *window) {
         if (!p_key_pressed) {
             p_key_pressed = true;
             point_light_on = !point_light_on;
-            
-            // Make sure we update the shader with the current state
-            if (shader_program_ptr) {
-                shader_program_ptr->use();
-                shader_program_ptr->setBool("point_light.on", point_light_on);
-            }
 
             // Print feedback
             if (point_light_on) {
@@ -264,6 +262,86 @@ void ProcessInput(GLFWwindow *window) {
     } else {
         h_key_pressed = false;
     }
+
+    if (glfwGetKey(window, GLFW_KEY_O) == GLFW_PRESS) {
+        if (!o_key_pressed) {
+            o_key_pressed = true;
+            lods_enabled = !lods_enabled;  // Toggle the state
+            std::cout << "Levels of detail toggled " << (lods_enabled ? "ON" : "OFF") << std::endl;
+        }
+    } else {
+        o_key_pressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_V) == GLFW_PRESS) {
+        if (!v_key_pressed) {
+            v_key_pressed = true;
+            bounds_visible = !bounds_visible;  // Toggle the state
+            std::cout << "Bounds overlay toggled " << (bounds_visible ? "ON" : "OFF") << std::endl;
+        }
+    } else {
+        v_key_pressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_K) == GLFW_PRESS) {
+        if (!k_key_pressed) {
+            k_key_pressed = true;
+            shadow_caster_culling = !shadow_caster_culling;  // Toggle the state
+            std::cout << "Shadow caster culling toggled " << (shadow_caster_culling ? "ON" : "OFF") << std::endl;
+        }
+    } else {
+        k_key_pressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_G) == GLFW_PRESS) {
+        if (!g_key_pressed) {
+            g_key_pressed = true;
+            shadows_enabled = !shadows_enabled;  // Toggle the state
+            std::cout << "Shadows toggled " << (shadows_enabled ? "ON" : "OFF") << std::endl;
+        }
+    } else {
+        g_key_pressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_U) == GLFW_PRESS) {
+        if (!u_key_pressed) {
+            u_key_pressed = true;
+            shader_permutations_enabled = !shader_permutations_enabled;  // Toggle the state
+            std::cout << "Shader variants toggled " << (shader_permutations_enabled ? "ON" : "OFF") << std::endl;
+        }
+    } else {
+        u_key_pressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_I) == GLFW_PRESS) {
+        if (!i_key_pressed) {
+            i_key_pressed = true;
+            instancing_enabled = !instancing_enabled;  // Toggle the state
+            std::cout << "Instancing toggled " << (instancing_enabled ? "ON" : "OFF") << std::endl;
+        }
+    } else {
+        i_key_pressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_N) == GLFW_PRESS) {
+        if (!n_key_pressed) {
+            n_key_pressed = true;
+            crowd_enabled = !crowd_enabled;  // Toggle the state
+            std::cout << "Crowd of " << CROWD_GYMNASTS << " gymnasts toggled " << (crowd_enabled ? "ON" : "OFF") << std::endl;
+        }
+    } else {
+        n_key_pressed = false;
+    }
+
+    if (glfwGetKey(window, GLFW_KEY_T) == GLFW_PRESS) {
+        if (!t_key_pressed) {
+            t_key_pressed = true;
+            static_batching_enabled = !static_batching_enabled;  // Toggle the state
+            std::cout << "Static batching toggled " << (static_batching_enabled ? "ON" : "OFF") << std::endl;
+        }
+    } else {
+        t_key_pressed = false;
+    }
 }
 
 void mouse_callback(GLFWwindow* window, double xpos, double ypos) {
@@ -27,6 +27,14 @@ extern float original_camera_pitch;
 extern bool spotlight_on; // Declaration for spotlight toggle state
 extern bool point_light_on; // Declaration for point light toggle state
 extern bool hud_visible;
+extern bool lods_enabled; // Levels of detail of imported models ('O' toggles them)
+extern bool bounds_visible; // Bounding box and sphere overlay ('V' toggles it)
+extern bool shadow_caster_culling; // Shadow pass draws only the culled caster list ('K' toggles it)
+extern bool shadows_enabled; // Shadow pass and shadow lookups ('G' toggles them)
+extern bool shader_permutations_enabled; // Scene drawn with compiled variants instead of the ubershader ('U' toggles it)
+extern bool instancing_enabled; // Copies of a mesh drawn as instances of one draw ('I' toggles it)
+extern bool crowd_enabled; // Crowd stress mode of CROWD_GYMNASTS gymnasts ('N' toggles it)
+extern bool static_batching_enabled; // Objects that never move drawn from the static batch ('T' toggles it)
 
 // External variables for post-processing
 extern int current_effect;
@@ -0,0 +1,257 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+
+// Marks a vertex that has not been seen yet
+static const unsigned int NO_VERTEX = ~0u;
+
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertex_count, int cache_size) {
+    VertexCacheStats stats;
+    if (indices.size() < 3 || vertex_count == 0) {
+        return stats;
+    }
+    // A vertex is in the cache if fewer than cache_size misses happened since it was added
+    std::vector<size_t> added(vertex_count, (size_t)-1);
+    size_t misses = 0;
+    size_t referenced = 0;
+    for (unsigned int index : indices) {
+        if (added[index] == (size_t)-1) {
+            referenced++;
+        } else if (misses - added[index] < (size_t)cache_size) {
+            continue;
+        }
+        added[index] = misses++;
+    }
+    stats.acmr = (double)misses / (indices.size() / 3);
+    stats.atvr = (double)misses / referenced;
+    return stats;
+}
+
+// Returns the next fanning vertex when none of the candidates is usable: the most
+// recently used vertex that still has triangles left, or else the next one in order
+static unsigned int SkipDeadEnd(std::vector<unsigned int> &dead_end, const std::vector<unsigned int> &live,
+                                size_t &input_cursor) {
+    while (!dead_end.empty()) {
+        unsigned int vertex = dead_end.back();
+        dead_end.pop_back();
+        if (live[vertex] > 0) {
+            return vertex;
+        }
+    }
+    for (; input_cursor < live.size(); input_cursor++) {
+        if (live[input_cursor] > 0) {
+            return input_cursor;
+        }
+    }
+    return NO_VERTEX;
+}
+
+std::vector<unsigned int> OptimizeVertexCache(const std::vector<unsigned int> &indices, size_t vertex_count,
+                                              std::vector<size_t> *clusters, int cache_size) {
+    size_t triangle_count = indices.size() / 3;
+    std::vector<unsigned int> result;
+    result.reserve(triangle_count * 3);
+    if (clusters != NULL) {
+        clusters->clear();
+    }
+    if (triangle_count == 0 || vertex_count == 0) {
+        return result;
+    }
+
+    // Triangles using each vertex (adjacency[offsets[v]] to adjacency[offsets[v + 1]])
+    std::vector<unsigned int> live(vertex_count, 0);
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+        live[indices[i]]++;
+    }
+    std::vector<size_t> offsets(vertex_count + 1, 0);
+    for (size_t v = 0; v < vertex_count; v++) {
+        offsets[v + 1] = offsets[v] + live[v];
+    }
+    std::vector<unsigned int> adjacency(triangle_count * 3);
+    std::vector<size_t> fill(offsets.begin(), offsets.end() - 1);
+    for (size_t i = 0; i < triangle_count * 3; i++) {
+        adjacency[fill[indices[i]]++] = i / 3;
+    }
+
+    std::vector<unsigned int> cache_time(vertex_count, 0);
+    unsigned int timestamp = cache_size + 1;
+    std::vector<char> emitted(triangle_count, 0);
+    std::vector<unsigned int> dead_end;
+    std::vector<unsigned int> candidates;
+    size_t input_cursor = 0;
+
+    unsigned int fan = SkipDeadEnd(dead_end, live, input_cursor);
+    if (clusters != NULL) {
+        clusters->push_back(0);
+    }
+    while (fan != NO_VERTEX) {
+        // Emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (size_t k = offsets[fan]; k < offsets[fan + 1]; k++) {
+            unsigned int triangle = adjacency[k];
+            if (emitted[triangle]) {
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++) {
+                unsigned int vertex = indices[triangle * 3 + corner];
+                result.push_back(vertex);
+                dead_end.push_back(vertex);
+                candidates.push_back(vertex);
+                live[vertex]--;
+                if (timestamp - cache_time[vertex] > (unsigned int)cache_size) {
+                    cache_time[vertex] = timestamp++;
+                }
+            }
+            emitted[triangle] = 1;
+        }
+
+        // Continue with the candidate that stays in the cache longest while its
+        // remaining triangles are emitted
+        unsigned int next = NO_VERTEX;
+        int best_priority = -1;
+        for (unsigned int vertex : candidates) {
+            if (live[vertex] == 0) {
+                continue;
+            }
+            int priority = 0;
+            if (timestamp - cache_time[vertex] + 2 * live[vertex] <= (unsigned int)cache_size) {
+                priority = timestamp - cache_time[vertex];
+            }
+            if (priority > best_priority) {
+                best_priority = priority;
+                next = vertex;
+            }
+        }
+        if (next == NO_VERTEX) {
+            next = SkipDeadEnd(dead_end, live, input_cursor);
+            if (next != NO_VERTEX && clusters != NULL && clusters->back() != result.size() / 3) {
+                clusters->push_back(result.size() / 3);
+            }
+        }
+        fan = next;
+    }
+    return result;
+}
+
+std::vector<unsigned int> OptimizeOverdraw(const std::vector<unsigned int> &indices,
+                                           const std::vector<glm::vec3> &positions,
+                                           const std::vector<size_t> &clusters, float threshold, int cache_size) {
+    size_t triangle_count = indices.size() / 3;
+    if (triangle_count == 0 || clusters.empty()) {
+        return indices;
+    }
+
+    // Split each cluster wherever the triangles so far already use the cache about as
+    // well as the whole cluster does (every part is simulated with a cold cache, as it
+    // may be drawn after any other part)
+    std::vector<size_t> starts;
+    std::vector<size_t> cache_time(positions.size(), 0);
+    size_t timestamp = cache_size + 1;
+    auto count_misses = [&](size_t triangle) {
+        size_t misses = 0;
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertex = indices[triangle * 3 + corner];
+            if (timestamp - cache_time[vertex] > (size_t)cache_size) {
+                cache_time[vertex] = timestamp++;
+                misses++;
+            }
+        }
+        return misses;
+    };
+    for (size_t c = 0; c < clusters.size(); c++) {
+        size_t start = clusters[c];
+        size_t end = (c + 1 < clusters.size()) ? clusters[c + 1] : triangle_count;
+        timestamp += cache_size + 1;
+        size_t cluster_misses = 0;
+        for (size_t t = start; t < end; t++) {
+            cluster_misses += count_misses(t);
+        }
+        double cluster_threshold = threshold * (double)cluster_misses / (end - start);
+
+        starts.push_back(start);
+        timestamp += cache_size + 1;
+        size_t misses = 0;
+        for (size_t t = start; t < end; t++) {
+            misses += count_misses(t);
+            if (t + 1 < end && misses <= cluster_threshold * (t - start + 1)) {
+                start = t + 1;
+                misses = 0;
+                starts.push_back(start);
+                timestamp += cache_size + 1;
+            }
+        }
+    }
+
+    // Clusters that face away from the middle of the mesh occlude the others from most
+    // viewpoints, so they are drawn first
+    glm::vec3 mesh_center(0.0f);
+    for (const glm::vec3 &position : positions) {
+        mesh_center += position;
+    }
+    if (!positions.empty()) {
+        mesh_center /= (float)positions.size();
+    }
+    std::vector<float> sort_keys(starts.size(), 0.0f);
+    for (size_t c = 0; c < starts.size(); c++) {
+        size_t end = (c + 1 < starts.size()) ? starts[c + 1] : triangle_count;
+        glm::vec3 center(0.0f);
+        glm::vec3 normal(0.0f);
+        float area = 0.0f;
+        for (size_t t = starts[c]; t < end; t++) {
+            const glm::vec3 &a = positions[indices[t * 3]];
+            const glm::vec3 &b = positions[indices[t * 3 + 1]];
+            const glm::vec3 &d = positions[indices[t * 3 + 2]];
+            // The cross product is twice the area along the triangle's normal
+            glm::vec3 cross = glm::cross(b - a, d - a);
+            float triangle_area = glm::length(cross);
+            center += (a + b + d) * (triangle_area / 3.0f);
+            normal += cross;
+            area += triangle_area;
+        }
+        float normal_length = glm::length(normal);
+        if (area > 0.0f && normal_length > 0.0f) {
+            sort_keys[c] = glm::dot(center / area - mesh_center, normal / normal_length);
+        }
+    }
+    std::vector<size_t> order(starts.size());
+    for (size_t c = 0; c < order.size(); c++) {
+        order[c] = c;
+    }
+    std::stable_sort(order.begin(), order.end(), [&sort_keys](size_t a, size_t b) {
+        return sort_keys[a] > sort_keys[b];
+    });
+
+    std::vector<unsigned int> result;
+    result.reserve(indices.size());
+    for (size_t c : order) {
+        size_t end = (c + 1 < starts.size()) ? starts[c + 1] : triangle_count;
+        result.insert(result.end(), indices.begin() + starts[c] * 3, indices.begin() + end * 3);
+    }
+    return result;
+}
+
+std::vector<unsigned int> OptimizeVertexFetch(std::vector<unsigned int> &indices, size_t vertex_count) {
+    std::vector<unsigned int> remap(vertex_count, NO_VERTEX);
+    std::vector<unsigned int> order;
+    order.reserve(vertex_count);
+    for (unsigned int &index : indices) {
+        if (remap[index] == NO_VERTEX) {
+            remap[index] = order.size();
+            order.push_back(index);
+        }
+        index = remap[index];
+    }
+    for (size_t v = 0; v < vertex_count; v++) {
+        if (remap[v] == NO_VERTEX) {
+            order.push_back(v);
+        }
+    }
+    return order;
+}
+
+std::vector<unsigned int> OptimizeMesh(std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions) {
+    std::vector<size_t> clusters;
+    indices = OptimizeVertexCache(indices, positions.size(), &clusters);
+    indices = OptimizeOverdraw(indices, positions, clusters);
+    return OptimizeVertexFetch(indices, positions.size());
+}
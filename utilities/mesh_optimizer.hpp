@@ -0,0 +1,67 @@
+#ifndef MESH_OPTIMIZER_HPP
+#define MESH_OPTIMIZER_HPP
+
+#include <vector>
+#include <cstddef>
+#include <glm/glm.hpp>
+
+//Number of entries in the FIFO post-transform cache that the optimizer targets
+// and that AnalyzeVertexCache simulates
+const int VERTEX_CACHE_SIZE = 16;
+
+//The overdraw pass splits a cluster into parts whose cache misses per triangle stay
+// within this factor of the whole cluster's, which gives it more parts to reorder
+const float OVERDRAW_THRESHOLD = 1.05f;
+
+//How well an index buffer uses the post-transform cache
+struct VertexCacheStats {
+    //Average cache misses per triangle (0.5 is ideal for a large grid, 3.0 is the worst)
+    double acmr = 0.0;
+    //Average cache misses per referenced vertex (1.0 is ideal)
+    double atvr = 0.0;
+};
+
+//Simulates a FIFO post-transform cache of the given size over an index buffer
+// (three entries per triangle) and returns its ACMR and ATVR
+VertexCacheStats AnalyzeVertexCache(const std::vector<unsigned int> &indices, size_t vertex_count,
+                                    int cache_size = VERTEX_CACHE_SIZE);
+
+//Reorders the triangles for the post-transform cache with the Tipsify algorithm
+// (Sander et al. 2007).  The corners of each triangle keep their order.  If clusters
+// is not NULL it receives the first triangle of every cluster (a run of triangles
+// that ends where the algorithm had to jump to an unrelated part of the mesh).
+std::vector<unsigned int> OptimizeVertexCache(const std::vector<unsigned int> &indices, size_t vertex_count,
+                                              std::vector<size_t> *clusters = NULL,
+                                              int cache_size = VERTEX_CACHE_SIZE);
+
+//Reorders the clusters of a cache-optimized index buffer so that triangles facing
+// outward from the middle of the mesh are drawn first and hide the ones behind them.
+// Clusters are first split wherever that keeps the ACMR of the parts within the given
+// threshold of the cluster's.
+std::vector<unsigned int> OptimizeOverdraw(const std::vector<unsigned int> &indices,
+                                           const std::vector<glm::vec3> &positions,
+                                           const std::vector<size_t> &clusters,
+                                           float threshold = OVERDRAW_THRESHOLD,
+                                           int cache_size = VERTEX_CACHE_SIZE);
+
+//Renumbers the vertices in the order the index buffer first uses them (rewriting
+// indices) so vertex fetches walk through memory, and returns the old index of each
+// new vertex.  Vertices that are never used keep their order at the end.
+std::vector<unsigned int> OptimizeVertexFetch(std::vector<unsigned int> &indices, size_t vertex_count);
+
+//Runs all three passes on an indexed mesh: rewrites indices and returns the old index
+// of each new vertex (pass the result to RemapVertices)
+std::vector<unsigned int> OptimizeMesh(std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions);
+
+//Puts vertices in the order returned by OptimizeVertexFetch/OptimizeMesh
+template <typename Vertex>
+void RemapVertices(std::vector<Vertex> &vertices, const std::vector<unsigned int> &order) {
+    std::vector<Vertex> remapped;
+    remapped.reserve(order.size());
+    for (unsigned int old_index : order) {
+        remapped.push_back(vertices[old_index]);
+    }
+    vertices.swap(remapped);
+}
+
+#endif //MESH_OPTIMIZER_HPP
@@ -0,0 +1,454 @@
+#include "mesh_simplifier.hpp"
+
+#include <unordered_map>
+#include <algorithm>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+
+// Planes along a border count this much more than the surface, so outlines keep their shape
+static const double BORDER_WEIGHT = 10.0;
+
+// How a welded vertex may move
+enum VertexKind {
+    MANIFOLD_VERTEX,
+    //Only collapses along its two border edges
+    BORDER_VERTEX,
+    //Never moves (corners of borders and vertices on non-manifold edges)
+    LOCKED_VERTEX
+};
+
+// Sum of squared distances to a set of weighted planes: p'Ap + 2b'p + c
+struct Quadric {
+    double a00 = 0.0, a01 = 0.0, a02 = 0.0, a11 = 0.0, a12 = 0.0, a22 = 0.0;
+    double b0 = 0.0, b1 = 0.0, b2 = 0.0;
+    double c = 0.0;
+    double weight = 0.0;
+};
+
+// A plane a.x + b.y + c.z + d = 0 with a unit normal (a, b, c)
+struct Plane {
+    double a, b, c, d;
+};
+
+// One candidate collapse of vertex from into vertex to
+struct Collapse {
+    unsigned int from;
+    unsigned int to;
+    double cost;
+};
+
+// Returns the plane through point with the given unit normal
+static Plane MakePlane(glm::vec3 normal, glm::vec3 point) {
+    Plane plane = {normal.x, normal.y, normal.z, 0.0};
+    plane.d = -(plane.a * point.x + plane.b * point.y + plane.c * point.z);
+    return plane;
+}
+
+// Adds a plane to the quadric
+static void AddPlane(Quadric &q, const Plane &plane, double weight) {
+    double a = plane.a, b = plane.b, c = plane.c, d = plane.d;
+    q.a00 += weight * a * a; q.a01 += weight * a * b; q.a02 += weight * a * c;
+    q.a11 += weight * b * b; q.a12 += weight * b * c; q.a22 += weight * c * c;
+    q.b0 += weight * a * d; q.b1 += weight * b * d; q.b2 += weight * c * d;
+    q.c += weight * d * d;
+    q.weight += weight;
+}
+
+static Quadric AddQuadrics(const Quadric &q, const Quadric &r) {
+    Quadric sum;
+    sum.a00 = q.a00 + r.a00; sum.a01 = q.a01 + r.a01; sum.a02 = q.a02 + r.a02;
+    sum.a11 = q.a11 + r.a11; sum.a12 = q.a12 + r.a12; sum.a22 = q.a22 + r.a22;
+    sum.b0 = q.b0 + r.b0; sum.b1 = q.b1 + r.b1; sum.b2 = q.b2 + r.b2;
+    sum.c = q.c + r.c;
+    sum.weight = q.weight + r.weight;
+    return sum;
+}
+
+// Returns the weighted mean squared distance from p to the planes of the quadric
+static double QuadricError(const Quadric &q, glm::vec3 p) {
+    double x = p.x, y = p.y, z = p.z;
+    double error = q.a00 * x * x + q.a11 * y * y + q.a22 * z * z
+                 + 2.0 * (q.a01 * x * y + q.a02 * x * z + q.a12 * y * z)
+                 + 2.0 * (q.b0 * x + q.b1 * y + q.b2 * z) + q.c;
+    return q.weight > 0.0 ? std::fabs(error) / q.weight : 0.0;
+}
+
+// Adds a plane to a vertex's planes unless it is already there (coplanar triangles share one)
+static void AddUniquePlane(std::vector<Plane> &planes, const Plane &plane) {
+    for (const Plane &other : planes) {
+        if (other.a == plane.a && other.b == plane.b && other.c == plane.c && other.d == plane.d) {
+            return;
+        }
+    }
+    planes.push_back(plane);
+}
+
+// Returns the largest distance from p to the planes
+static double MaxPlaneDistance(const std::vector<Plane> &planes, glm::vec3 p) {
+    double distance = 0.0;
+    for (const Plane &plane : planes) {
+        distance = std::max(distance, std::fabs(plane.a * p.x + plane.b * p.y + plane.c * p.z + plane.d));
+    }
+    return distance;
+}
+
+static inline uint64_t EdgeKey(unsigned int a, unsigned int b) {
+    return a < b ? ((uint64_t)a << 32) | b : ((uint64_t)b << 32) | a;
+}
+
+// Hashes the bit pattern of a position, so only identical positions are welded
+struct PositionHash {
+    size_t operator()(const glm::vec3 &p) const {
+        uint32_t bits[3];
+        memcpy(bits, &p.x, sizeof(float));
+        memcpy(bits + 1, &p.y, sizeof(float));
+        memcpy(bits + 2, &p.z, sizeof(float));
+        uint64_t h = bits[0] * 0x9E3779B97F4A7C15ULL;
+        h ^= bits[1] * 0xC2B2AE3D27D4EB4FULL + (h << 6) + (h >> 2);
+        h ^= bits[2] * 0x165667B19E3779F9ULL + (h << 6) + (h >> 2);
+        return (size_t)h;
+    }
+};
+
+struct PositionEqual {
+    bool operator()(const glm::vec3 &a, const glm::vec3 &b) const {
+        return memcmp(&a, &b, sizeof(glm::vec3)) == 0;
+    }
+};
+
+SimplifiedMesh SimplifyMesh(const std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions,
+                            size_t target_index_count, float max_error, unsigned int first_new_vertex) {
+    SimplifiedMesh result;
+    size_t vertex_count = positions.size();
+
+    // Every vertex is represented by the first vertex with the same position
+    std::vector<unsigned int> weld(vertex_count);
+    {
+        std::unordered_map<glm::vec3, unsigned int, PositionHash, PositionEqual> first_vertex;
+        first_vertex.reserve(vertex_count);
+        for (size_t v = 0; v < vertex_count; v++) {
+            weld[v] = first_vertex.emplace(positions[v], (unsigned int)v).first->second;
+        }
+    }
+
+    // Each corner keeps its own vertex (for the attributes) and the welded vertex it is at
+    std::vector<unsigned int> corner_vertex;
+    std::vector<unsigned int> corner_position;
+    for (size_t i = 0; i + 2 < indices.size(); i += 3) {
+        unsigned int a = weld[indices[i]], b = weld[indices[i + 1]], c = weld[indices[i + 2]];
+        if (a == b || b == c || a == c) {
+            continue;
+        }
+        for (int corner = 0; corner < 3; corner++) {
+            corner_vertex.push_back(indices[i + corner]);
+            corner_position.push_back(weld[indices[i + corner]]);
+        }
+    }
+
+    // Classify the vertices by the edges around them
+    std::unordered_map<uint64_t, int> edge_use;
+    for (size_t i = 0; i < corner_position.size(); i += 3) {
+        for (int e = 0; e < 3; e++) {
+            edge_use[EdgeKey(corner_position[i + e], corner_position[i + (e + 1) % 3])]++;
+        }
+    }
+    std::vector<int> border_edges(vertex_count, 0);
+    std::vector<char> kind(vertex_count, MANIFOLD_VERTEX);
+    for (const std::pair<const uint64_t, int> &edge : edge_use) {
+        unsigned int a = (unsigned int)(edge.first >> 32), b = (unsigned int)(edge.first & 0xFFFFFFFFu);
+        if (edge.second == 1) {
+            border_edges[a]++;
+            border_edges[b]++;
+        } else if (edge.second > 2) {
+            kind[a] = kind[b] = LOCKED_VERTEX;
+        }
+    }
+    for (size_t v = 0; v < vertex_count; v++) {
+        if (kind[v] == MANIFOLD_VERTEX && border_edges[v] > 0) {
+            kind[v] = border_edges[v] == 2 ? BORDER_VERTEX : LOCKED_VERTEX;
+        }
+    }
+
+    // Quadrics of the triangle planes (weighted by area) and of planes standing on the borders.
+    // The quadrics only order the collapses; each vertex also keeps the planes themselves, so
+    // a collapse can be measured by how far it moves off the farthest one.
+    std::vector<Quadric> quadrics(vertex_count);
+    std::vector<std::vector<Plane>> planes(vertex_count);
+    for (size_t i = 0; i < corner_position.size(); i += 3) {
+        glm::vec3 p[3];
+        for (int corner = 0; corner < 3; corner++) {
+            p[corner] = positions[corner_position[i + corner]];
+        }
+        glm::vec3 normal = glm::cross(p[1] - p[0], p[2] - p[0]);
+        float length = glm::length(normal);
+        if (length <= 0.0f) {
+            continue;
+        }
+        Plane plane = MakePlane(normal / length, p[0]);
+        for (int corner = 0; corner < 3; corner++) {
+            AddPlane(quadrics[corner_position[i + corner]], plane, 0.5 * length);
+            AddUniquePlane(planes[corner_position[i + corner]], plane);
+        }
+        for (int e = 0; e < 3; e++) {
+            unsigned int a = corner_position[i + e], b = corner_position[i + (e + 1) % 3];
+            if (edge_use[EdgeKey(a, b)] != 1) {
+                continue;
+            }
+            glm::vec3 edge = positions[b] - positions[a];
+            glm::vec3 border_normal = glm::cross(edge, normal);
+            float border_length = glm::length(border_normal);
+            if (border_length > 0.0f) {
+                double weight = BORDER_WEIGHT * glm::length(edge) * glm::length(edge);
+                Plane border_plane = MakePlane(border_normal / border_length, positions[a]);
+                AddPlane(quadrics[a], border_plane, weight);
+                AddPlane(quadrics[b], border_plane, weight);
+                AddUniquePlane(planes[a], border_plane);
+                AddUniquePlane(planes[b], border_plane);
+            }
+        }
+    }
+
+    // Collapse edges in passes: each pass sorts the candidates by cost and collapses as
+    // many as it can without touching the neighborhood of an earlier collapse
+    double max_cost = (double)max_error * max_error;
+    double worst_distance = 0.0;
+    std::vector<char> alive(corner_position.size() / 3, 1);
+    std::vector<unsigned int> offsets(vertex_count + 1);
+    std::vector<unsigned int> adjacency;
+    std::vector<Collapse> collapses;
+    std::vector<char> locked(vertex_count);
+    std::vector<unsigned int> from_neighbors;
+    std::vector<unsigned int> to_neighbors;
+    std::vector<std::pair<unsigned int, unsigned int>> partners;
+    bool done = false;
+    while (!done && corner_position.size() > target_index_count) {
+        // Drop the triangles removed by the last pass
+        size_t kept = 0;
+        for (size_t t = 0; t < alive.size(); t++) {
+            if (!alive[t]) {
+                continue;
+            }
+            for (int corner = 0; corner < 3; corner++) {
+                corner_vertex[kept * 3 + corner] = corner_vertex[t * 3 + corner];
+                corner_position[kept * 3 + corner] = corner_position[t * 3 + corner];
+            }
+            kept++;
+        }
+        corner_vertex.resize(kept * 3);
+        corner_position.resize(kept * 3);
+        alive.assign(kept, 1);
+        if (corner_position.size() <= target_index_count) {
+            break;
+        }
+
+        // Triangles around each welded vertex (adjacency[offsets[v]] to adjacency[offsets[v + 1]])
+        std::fill(offsets.begin(), offsets.end(), 0);
+        for (unsigned int position : corner_position) {
+            offsets[position + 1]++;
+        }
+        for (size_t v = 0; v < vertex_count; v++) {
+            offsets[v + 1] += offsets[v];
+        }
+        adjacency.resize(corner_position.size());
+        std::vector<unsigned int> fill(offsets.begin(), offsets.end() - 1);
+        for (size_t i = 0; i < corner_position.size(); i++) {
+            adjacency[fill[corner_position[i]]++] = i / 3;
+        }
+        edge_use.clear();
+        for (size_t i = 0; i < corner_position.size(); i += 3) {
+            for (int e = 0; e < 3; e++) {
+                edge_use[EdgeKey(corner_position[i + e], corner_position[i + (e + 1) % 3])]++;
+            }
+        }
+
+        // The cheaper direction of every edge that may collapse
+        collapses.clear();
+        for (const std::pair<const uint64_t, int> &edge : edge_use) {
+            if (edge.second > 2) {
+                continue;
+            }
+            bool border = edge.second == 1;
+            unsigned int a = (unsigned int)(edge.first >> 32), b = (unsigned int)(edge.first & 0xFFFFFFFFu);
+            Quadric sum = AddQuadrics(quadrics[a], quadrics[b]);
+            Collapse best = {0, 0, -1.0};
+            for (int direction = 0; direction < 2; direction++) {
+                unsigned int from = direction == 0 ? a : b;
+                unsigned int to = direction == 0 ? b : a;
+                if (kind[from] == LOCKED_VERTEX || (kind[from] == BORDER_VERTEX && !border)) {
+                    continue;
+                }
+                double cost = QuadricError(sum, positions[to]);
+                if (best.cost < 0.0 || cost < best.cost) {
+                    best.from = from;
+                    best.to = to;
+                    best.cost = cost;
+                }
+            }
+            if (best.cost >= 0.0) {
+                collapses.push_back(best);
+            }
+        }
+        std::sort(collapses.begin(), collapses.end(), [](const Collapse &a, const Collapse &b) {
+            return a.cost < b.cost || (a.cost == b.cost && (a.from < b.from || (a.from == b.from && a.to < b.to)));
+        });
+
+        size_t remove_target = (corner_position.size() - target_index_count + 2) / 3;
+        size_t removed = 0;
+        int collapsed = 0;
+        std::fill(locked.begin(), locked.end(), 0);
+        for (const Collapse &collapse : collapses) {
+            // Candidates skipped because of a lock get another chance in the next pass.  The
+            // cost is a weighted mean of squared plane distances, so once it passes max_error
+            // squared the farthest plane is beyond max_error as well.
+            if (collapse.cost > max_cost) {
+                break;
+            }
+            unsigned int from = collapse.from;
+            unsigned int to = collapse.to;
+            if (locked[from] || locked[to]) {
+                continue;
+            }
+
+            // The planes collected at to were already measured at its position, so only the
+            // planes of from can be farther than max_error
+            double distance = MaxPlaneDistance(planes[from], positions[to]);
+            if (distance > max_error) {
+                continue;
+            }
+
+            // The two end points may only share the vertices opposite the edge, or the
+            // collapse would fold the surface onto itself
+            from_neighbors.clear();
+            to_neighbors.clear();
+            for (unsigned int k = offsets[from]; k < offsets[from + 1]; k++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    from_neighbors.push_back(corner_position[adjacency[k] * 3 + corner]);
+                }
+            }
+            for (unsigned int k = offsets[to]; k < offsets[to + 1]; k++) {
+                for (int corner = 0; corner < 3; corner++) {
+                    to_neighbors.push_back(corner_position[adjacency[k] * 3 + corner]);
+                }
+            }
+            std::sort(from_neighbors.begin(), from_neighbors.end());
+            from_neighbors.erase(std::unique(from_neighbors.begin(), from_neighbors.end()), from_neighbors.end());
+            std::sort(to_neighbors.begin(), to_neighbors.end());
+            to_neighbors.erase(std::unique(to_neighbors.begin(), to_neighbors.end()), to_neighbors.end());
+            int shared = 0;
+            for (unsigned int neighbor : from_neighbors) {
+                if (neighbor != from && neighbor != to &&
+                    std::binary_search(to_neighbors.begin(), to_neighbors.end(), neighbor)) {
+                    shared++;
+                }
+            }
+            if (shared != edge_use[EdgeKey(from, to)]) {
+                continue;
+            }
+
+            // No remaining triangle may flip over or collapse to a line
+            bool flips = false;
+            for (unsigned int k = offsets[from]; k < offsets[from + 1] && !flips; k++) {
+                unsigned int t = adjacency[k];
+                const unsigned int *corners = &corner_position[t * 3];
+                if (corners[0] == to || corners[1] == to || corners[2] == to) {
+                    continue;
+                }
+                glm::vec3 p[3], q[3];
+                for (int corner = 0; corner < 3; corner++) {
+                    p[corner] = positions[corners[corner]];
+                    q[corner] = corners[corner] == from ? positions[to] : p[corner];
+                }
+                glm::vec3 before = glm::cross(p[1] - p[0], p[2] - p[0]);
+                glm::vec3 after = glm::cross(q[1] - q[0], q[2] - q[0]);
+                flips = glm::dot(before, after) <= 0.0f;
+            }
+            if (flips) {
+                continue;
+            }
+
+            // The triangles on the edge pair each vertex at from with the vertex at to that
+            // continues its normals and texture coordinates; moved corners use that vertex
+            // and only corners without a partner keep their own attributes
+            partners.clear();
+            for (unsigned int k = offsets[from]; k < offsets[from + 1]; k++) {
+                unsigned int t = adjacency[k];
+                int from_corner = -1, to_corner = -1;
+                for (int corner = 0; corner < 3; corner++) {
+                    if (corner_position[t * 3 + corner] == from) {
+                        from_corner = corner;
+                    } else if (corner_position[t * 3 + corner] == to) {
+                        to_corner = corner;
+                    }
+                }
+                if (to_corner >= 0) {
+                    partners.push_back(std::make_pair(corner_vertex[t * 3 + from_corner], corner_vertex[t * 3 + to_corner]));
+                    alive[t] = 0;
+                    removed++;
+                }
+            }
+
+            // Move every corner at from to the position of to
+            for (unsigned int k = offsets[from]; k < offsets[from + 1]; k++) {
+                unsigned int t = adjacency[k];
+                if (!alive[t]) {
+                    continue;
+                }
+                for (int corner = 0; corner < 3; corner++) {
+                    if (corner_position[t * 3 + corner] != from) {
+                        continue;
+                    }
+                    corner_position[t * 3 + corner] = to;
+                    for (const std::pair<unsigned int, unsigned int> &partner : partners) {
+                        if (partner.first == corner_vertex[t * 3 + corner]) {
+                            corner_vertex[t * 3 + corner] = partner.second;
+                            break;
+                        }
+                    }
+                }
+            }
+            for (unsigned int neighbor : from_neighbors) {
+                locked[neighbor] = 1;
+            }
+            locked[to] = 1;
+            quadrics[to] = AddQuadrics(quadrics[to], quadrics[from]);
+            for (const Plane &plane : planes[from]) {
+                AddUniquePlane(planes[to], plane);
+            }
+            std::vector<Plane>().swap(planes[from]);
+            worst_distance = std::max(worst_distance, distance);
+            collapsed++;
+            if (removed >= remove_target) {
+                break;
+            }
+        }
+        if (collapsed == 0) {
+            done = true;
+        }
+    }
+
+    // Corners that moved need a vertex with their attributes at the new position
+    std::unordered_map<uint64_t, unsigned int> moved;
+    for (size_t t = 0; t < alive.size(); t++) {
+        if (!alive[t]) {
+            continue;
+        }
+        for (int corner = 0; corner < 3; corner++) {
+            unsigned int vertex = corner_vertex[t * 3 + corner];
+            unsigned int position = corner_position[t * 3 + corner];
+            if (weld[vertex] == position) {
+                result.indices.push_back(vertex);
+                continue;
+            }
+            uint64_t key = ((uint64_t)vertex << 32) | position;
+            std::unordered_map<uint64_t, unsigned int>::iterator found = moved.find(key);
+            if (found == moved.end()) {
+                found = moved.emplace(key, first_new_vertex + (unsigned int)result.new_vertices.size()).first;
+                result.new_vertices.push_back(std::make_pair(vertex, position));
+            }
+            result.indices.push_back(found->second);
+        }
+    }
+    result.error = (float)worst_distance;
+    return result;
+}
@@ -0,0 +1,30 @@
+#ifndef MESH_SIMPLIFIER_HPP
+#define MESH_SIMPLIFIER_HPP
+
+#include <vector>
+#include <utility>
+#include <glm/glm.hpp>
+
+//A simplified version of an indexed mesh.  Vertices that only moved to the position of
+// another vertex are new vertices (numbered from the first_new_vertex passed to
+// SimplifyMesh) described by new_vertices.
+struct SimplifiedMesh {
+    std::vector<unsigned int> indices;
+    //Each new vertex copies the attributes of .first and the position of .second
+    std::vector<std::pair<unsigned int, unsigned int>> new_vertices;
+    //Largest distance (in model units) from a moved vertex to the planes of the original
+    // triangles and borders it replaced
+    float error = 0.0f;
+};
+
+//Reduces a triangle mesh towards target_index_count indices with quadric error metrics
+// (Garland and Heckbert 1997): edges are collapsed into one of their end points, cheapest
+// first, as long as no vertex ends up farther than max_error (in model units) from the plane
+// of any original triangle or border it replaced.  Vertices that share a position are
+// treated as one, so seams in normals or texture coordinates do not stop the simplification,
+// and each corner keeps the attributes it had.  Borders only collapse along themselves and
+// no triangle is allowed to flip.
+SimplifiedMesh SimplifyMesh(const std::vector<unsigned int> &indices, const std::vector<glm::vec3> &positions,
+                            size_t target_index_count, float max_error, unsigned int first_new_vertex);
+
+#endif //MESH_SIMPLIFIER_HPP
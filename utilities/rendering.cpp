@@ -2,10 +2,16 @@
 #include "build_shapes.hpp"
 #include "input_handling.hpp" 
 #include <iostream>
+#include <chrono>
+#include <cstddef>
 #include "../classes/object_types.hpp"
+#include "../classes/asset_loader.hpp"
+#include "../classes/render_queue.hpp"
+#include "../classes/gl_state.hpp"
 
-RenderingVAOs setupVAOs() {
+RenderingVAOs setupVAOs(bool compact_vertices) {
     RenderingVAOs vaos;
+    vaos.compact_vertices = compact_vertices;
     
     // Basic VAO setup
     glGenVertexArrays(1, &(vaos.basic_vao.id));
@@ -20,15 +26,23 @@ RenderingVAOs setupVAOs() {
 
     // Import VAO setup
     glGenVertexArrays(1, &(vaos.import_vao.id));
-    int stride_size = 19*sizeof(float);
-    vaos.import_vao.attributes.push_back(BuildAttribute(3, GL_FLOAT, false, stride_size, 0));
-    vaos.import_vao.attributes.push_back(BuildAttribute(3, GL_FLOAT, false, stride_size, 3*sizeof(float)));
-    vaos.import_vao.attributes.push_back(BuildAttribute(2, GL_FLOAT, false, stride_size, 6*sizeof(float)));
-    vaos.import_vao.attributes.push_back(BuildAttribute(3, GL_FLOAT, false, stride_size, 8*sizeof(float)));
-    vaos.import_vao.attributes.push_back(BuildAttribute(3, GL_FLOAT, false, stride_size, 11*sizeof(float)));
-    vaos.import_vao.attributes.push_back(BuildAttribute(3, GL_FLOAT, false, stride_size, 14*sizeof(float)));
-    vaos.import_vao.attributes.push_back(BuildAttribute(1, GL_FLOAT, false, stride_size, 17*sizeof(float)));
-    vaos.import_vao.attributes.push_back(BuildAttribute(1, GL_FLOAT, false, stride_size, 18*sizeof(float)));
+    if (compact_vertices) {
+        // Position, packed normal, half float texture coordinates, and the material
+        // table row (an integer attribute)
+        int stride_size = sizeof(CompactVertex);
+        vaos.import_vao.attributes.push_back(BuildAttribute(3, GL_FLOAT, false, stride_size, offsetof(CompactVertex, Position)));
+        vaos.import_vao.attributes.push_back(BuildAttribute(4, GL_INT_2_10_10_10_REV, true, stride_size, offsetof(CompactVertex, Normal)));
+        vaos.import_vao.attributes.push_back(BuildAttribute(2, GL_HALF_FLOAT, false, stride_size, offsetof(CompactVertex, TexCoords)));
+        vaos.import_vao.attributes.push_back(BuildAttribute(1, GL_UNSIGNED_SHORT, false, stride_size,
+                                                            offsetof(CompactVertex, material_index), true));
+    } else {
+        int stride_size = sizeof(CompleteVertex);
+        vaos.import_vao.attributes.push_back(BuildAttribute(3, GL_FLOAT, false, stride_size, offsetof(CompleteVertex, Position)));
+        vaos.import_vao.attributes.push_back(BuildAttribute(3, GL_FLOAT, false, stride_size, offsetof(CompleteVertex, Normal)));
+        vaos.import_vao.attributes.push_back(BuildAttribute(2, GL_FLOAT, false, stride_size, offsetof(CompleteVertex, TexCoords)));
+        vaos.import_vao.attributes.push_back(BuildAttribute(1, GL_UNSIGNED_INT, false, stride_size,
+                                                            offsetof(CompleteVertex, material_index), true));
+    }
     
     // Skybox VAO setup
     glGenVertexArrays(1, &(vaos.skybox_vao.id));
@@ -39,54 +53,33 @@ RenderingVAOs setupVAOs() {
     return vaos;
 }
 
-GameModels loadModels(RenderingVAOs& vaos, ImportOBJ& importer) {
+GameModels loadModels(RenderingVAOs& vaos, int loader_threads) {
     GameModels models;
-    std::cout << "Loading models..." << std::endl;
-    
-    // Load base model
-    models.baseModel = importer.loadFiles("models/baseModel", vaos.import_vao);
-    std::cout << "BaseModel imported" << std::endl;
-    
-    // Load tumbling floor
-    models.tumbling_floor = importer.loadFiles("models/tumbling_floor", vaos.import_vao);
-    std::cout << "Tumbling floor imported" << std::endl;
-    models.tumbling_floor_texture = importer.getTexture();
-    std::cout << "Tumbling floor texture imported" << std::endl;
-
-    // Load vault table
-    models.vault_table = importer.loadFiles("models/VaultTable", vaos.import_vao);
-    models.vault_table_textures = importer.getAllTextures();
-    for (int i = 0; i < models.vault_table_textures.size(); i++) {
-        std::cout << "Vault table texture " << i << ": " << models.vault_table_textures[i] << std::endl;
-    }
-    std::cout << "Vault table imported with " << models.vault_table_textures.size() << " textures." << std::endl;
-
-    // Load Lou Gross building
-    models.LouGrossBuilding = importer.loadFiles("models/ComplexBuilding", vaos.import_vao);
-    std::cout << "Lou Gross Building imported" << std::endl;
-    models.building_textures = importer.getAllTextures();
-    for (int i = 0; i < models.building_textures.size(); i++) {
-        std::cout << "Lou Gross Building texture " << i << ": " << models.building_textures[i] << std::endl;
-    }
-    std::cout << "Lou Gross Building imported with " << models.building_textures.size() << " textures." << std::endl;
+    AssetLoader loader(models.assets, loader_threads);
+    loader.importer.compactVertices = vaos.compact_vertices;
+    std::cout << "Loading models with " << loader.ThreadCount() << " loader threads..." << std::endl;
+    auto start = std::chrono::steady_clock::now();
 
-    // Load high bar
-    models.high_bar = importer.loadFiles("models/HighBar", vaos.import_vao);
-    std::cout << "High Bar imported" << std::endl;
-
-    // Load pommel horses
-    models.pommel_horse = importer.loadFiles("models/PommelHorse", vaos.import_vao);
-    std::cout << "PommelHorse imported" << std::endl;
-    
-    models.pommel_horse2 = importer.loadFiles("models/PommelHorse2", vaos.import_vao);
-    std::cout << "PommelHorse2 imported" << std::endl;
-
-    // Create floor
-    models.floor_texture = GetTexture("./textures/hull_texture.png");
-    models.floor = GetTexturedRectangle(vaos.texture_vao, glm::vec3(-25.0, -25.0, 0.0), 50.0, 50.0, 20.0, false);
-
-    // Create skybox
-    models.skybox = GetCube(vaos.skybox_vao);
+    // Every row of the default material table is the importer's default material
+    MaterialTableEntry default_entry = {};
+    default_entry.ambient = default_entry.diffuse = default_entry.specular = glm::vec4(1.0);
+    default_entry.texture_index = 99;
+    std::vector<MaterialTableEntry> default_table(MAX_TABLE_MATERIALS, default_entry);
+    glGenBuffers(1, &models.default_material_table);
+    glBindBuffer(GL_UNIFORM_BUFFER, models.default_material_table);
+    glBufferData(GL_UNIFORM_BUFFER, default_table.size() * sizeof(MaterialTableEntry), default_table.data(), GL_STATIC_DRAW);
+    glBindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_TABLE_BINDING, models.default_material_table);
+    
+    // Queue the models and textures: they are read and decoded on the loader's
+    // threads while this thread creates the OpenGL objects
+    loader.LoadModel("models/baseModel", vaos.import_vao, &models.baseModel);
+    loader.LoadModel("models/tumbling_floor", vaos.import_vao, &models.tumbling_floor, &models.tumbling_floor_textures);
+    loader.LoadModel("models/VaultTable", vaos.import_vao, &models.vault_table, &models.vault_table_textures);
+    loader.LoadModel("models/ComplexBuilding", vaos.import_vao, &models.LouGrossBuilding, &models.building_textures);
+    loader.LoadModel("models/HighBar", vaos.import_vao, &models.high_bar);
+    loader.LoadModel("models/PommelHorse", vaos.import_vao, &models.pommel_horse);
+    loader.LoadModel("models/PommelHorse2", vaos.import_vao, &models.pommel_horse2);
+    loader.LoadTexture("./textures/hull_texture.png", false, &models.floor_texture);
     
     // Load skybox textures
     std::vector<std::string> skybox_faces = {
@@ -97,8 +90,42 @@ GameModels loadModels(RenderingVAOs& vaos, ImportOBJ& importer) {
         "./textures/Storforsen/posz.jpg",  // front
         "./textures/Storforsen/negz.jpg"   // back
     };
-    models.skybox_texture = GetCubeMap(skybox_faces, false);
+    loader.LoadCubeMap(skybox_faces, false, &models.skybox_texture);
+
+    // Create floor
+    models.floor = models.assets.AddMesh("floor", 0, GetTexturedRectangle(vaos.texture_vao, glm::vec3(-25.0, -25.0, 0.0), 50.0, 50.0, 20.0, false));
+    // Nothing lies under the floor, so it is left out of the shadow map
+    models.floor->SetCastsShadows(false);
+
+    // Create skybox
+    models.skybox = models.assets.AddMesh("skybox", 0, GetCube(vaos.skybox_vao));
+
+    // Create the outlines for the bounds overlay
+    models.bounds_box = models.assets.AddMesh("bounds box", 0, GetWireBox(vaos.basic_vao));
+    models.bounds_sphere = models.assets.AddMesh("bounds sphere", 0, GetWireSphere(vaos.basic_vao));
+
+    loader.Finish();
+
+    // Models without textures get an empty array (texture 0)
+    TextureHandle* texture_arrays[] = {&models.tumbling_floor_textures, &models.vault_table_textures, &models.building_textures};
+    for (TextureHandle* textures : texture_arrays) {
+        if (!*textures) {
+            *textures = std::make_shared<RegisteredTexture>();
+            (*textures)->target = GL_TEXTURE_2D_ARRAY;
+        }
+    }
+    std::cout << "Tumbling floor texture array: " << models.tumbling_floor_textures->id << " ("
+              << models.assets.MeshTexturePaths("models/tumbling_floor").size() << " layers)" << std::endl;
+    std::cout << "Vault table texture array: " << models.vault_table_textures->id << " ("
+              << models.assets.MeshTexturePaths("models/VaultTable").size() << " layers)" << std::endl;
+    std::cout << "Lou Gross Building texture array: " << models.building_textures->id << " ("
+              << models.assets.MeshTexturePaths("models/ComplexBuilding").size() << " layers)" << std::endl;
     std::cout << "Skybox cube and textures loaded" << std::endl;
+
+    double load_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Models loaded in " << load_ms << " ms (" << loader.ThreadCount() << " loader threads)" << std::endl;
+    models.assets.PrintSummary();
+    PrintTextureCacheStats("Texture cache", models.assets.TextureStats());
     
     return models;
 }
@@ -116,217 +143,435 @@ void setupShaders(Shader* shader_program, Font& arial_font, const RenderingVAOs&
     std::cout << "Font initialized" << std::endl;
 }
 
-void setupLighting(Shader* shader_program, const glm::vec3& light_color, 
-                  const glm::vec4& light_direction, const Camera& camera) {
-    // Directional light setup
-    shader_program->setVec4("directional_light.ambient", glm::vec4(0.5f * light_color, 1.0));
-    shader_program->setVec4("directional_light.diffuse", glm::vec4(light_color, 1.0f));
-    shader_program->setVec4("directional_light.specular", glm::vec4(0.5f * light_color, 1.0f));
-    shader_program->setVec4("directional_light.direction", light_direction);
-    shader_program->setBool("directional_light.on", true);
+void setupLighting(FrameUniforms& frame_uniforms) {
+    // Spotlight colors (the spotlight follows the camera, see updateFrameUniforms)
+    SpotLightBlock& spot_light = frame_uniforms.lighting.spot_light;
+    spot_light.ambient = glm::vec4(0.05f, 0.05f, 0.05f, 1.0f);
+    spot_light.diffuse = glm::vec4(2.0f, 1.9f, 1.6f, 1.0f); // Warm light
+    spot_light.specular = glm::vec4(2.0f, 2.0f, 2.0f, 1.0f);
 
-    shader_program->setVec4("view_position", glm::vec4(camera.Position, 1.0));
+    // Spotlight properties
+    spot_light.cut_off = glm::cos(glm::radians(10.0f));
+    spot_light.outer_cut_off = glm::cos(glm::radians(15.0f));
+    spot_light.constant = 1.0f;
+    spot_light.linear = 0.09f;
+    spot_light.quadratic = 0.032f;
+}
 
-    // Spotlight setup 
-    shader_program->setVec4("spot_light.position", glm::vec4(camera.Position, 1.0f));
-    shader_program->setVec4("spot_light.direction", glm::vec4(camera.Front, 0.0f));
+void updateFrameUniforms(FrameUniforms& frame_uniforms, const Camera& camera,
+                         unsigned int scr_width, unsigned int scr_height,
+                         const glm::vec3& light_color, const glm::vec4& light_direction,
+                         const glm::mat4& light_space_matrix) {
+    // Create a non-const copy of the camera to call GetViewMatrix()
+    Camera camera_copy = camera;
+    CameraBlock& camera_block = frame_uniforms.camera;
+    camera_block.projection = getProjectionMatrix(scr_width, scr_height);
+    camera_block.view = camera_copy.GetViewMatrix();
+    camera_block.light_space_matrix = light_space_matrix;
+    camera_block.view_position = glm::vec4(camera.Position, 1.0);
 
-    // Light colors
-    shader_program->setVec4("spot_light.ambient", glm::vec4(0.05f, 0.05f, 0.05f, 1.0f));  
-    shader_program->setVec4("spot_light.diffuse", glm::vec4(2.0f, 1.9f, 1.6f, 1.0f)); // Warm light
-    shader_program->setVec4("spot_light.specular", glm::vec4(2.0f, 2.0f, 2.0f, 1.0f));
+    // Directional light (point_light_on toggles it)
+    DirectionalLightBlock& directional_light = frame_uniforms.lighting.directional_light;
+    directional_light.direction = light_direction;
+    directional_light.ambient = glm::vec4(0.5f * light_color, 1.0);
+    directional_light.diffuse = glm::vec4(light_color, 1.0f);
+    directional_light.specular = glm::vec4(0.5f * light_color, 1.0f);
+    directional_light.on = point_light_on;
 
-    // Spotlight properties
-    shader_program->setFloat("spot_light.cutOff", glm::cos(glm::radians(10.0f)));
-    shader_program->setFloat("spot_light.outerCutOff", glm::cos(glm::radians(15.0f)));
-    shader_program->setBool("spot_light.on", true);
+    // The spotlight serves as a flashlight that moves with the camera
+    SpotLightBlock& spot_light = frame_uniforms.lighting.spot_light;
+    spot_light.position = glm::vec4(camera.Position, 1.0f);
+    spot_light.direction = glm::vec4(camera.Front, 0.0f);
+    spot_light.on = spotlight_on;
 
-    shader_program->setFloat("spot_light.constant", 1.0f);
-    shader_program->setFloat("spot_light.linear", 0.09f);
-    shader_program->setFloat("spot_light.quadratic", 0.032f);
+    frame_uniforms.Upload();
 }
 
-void renderScene(Shader* shader_program, 
-                GameModels& models, 
-                Avatar& baseAvatar,
-                AvatarHighBar* high_bar_avatar,
-                const Camera& camera,
-                const glm::vec3& light_color,
-                const glm::vec4& light_direction,
-                bool is_depth_pass) {
-    
-    shader_program->use();
-    
-    // Update view matrix based on camera
-    // Create a non-const copy of the camera to call GetViewMatrix()
-    Camera camera_copy = camera;
-    glm::mat4 view = camera_copy.GetViewMatrix();
-    shader_program->setMat4("view", view);
-    shader_program->setVec4("view_position", glm::vec4(camera.Position, 1.0));
-    
-    // Update spotlight position and direction
-    shader_program->setVec4("spot_light.position", glm::vec4(camera.Position, 1.0f));
-    shader_program->setVec4("spot_light.direction", glm::vec4(camera.Front, 0.0f));
-    
-    // Ensure spotlight state is correctly set every frame
-    shader_program->setBool("spot_light.on", spotlight_on);
-    
-    // Update directional light and ensure its state is correctly set every frame
-    shader_program->setVec4("directional_light.ambient", glm::vec4(0.5f * light_color, 1.0));
-    shader_program->setVec4("directional_light.diffuse", glm::vec4(light_color, 1.0f));
-    shader_program->setVec4("directional_light.specular", glm::vec4(0.5f * light_color, 1.0f));
-    shader_program->setVec4("directional_light.direction", light_direction);
-    shader_program->setBool("directional_light.on", point_light_on); // Using existing point_light_on toggle
-    
-    // Draw base avatar
-    baseAvatar.Draw(shader_program, false);
-    
-    // Draw floor
+// Outlines the world space bounding box (yellow) and bounding sphere (cyan) of a shape drawn
+// with the given transform (model * local), using the BASIC program (which must be in use)
+static void drawBounds(Shader* basic_program, GameModels& models, BasicShape& shape, const glm::mat4& transform) {
+    BoundingBox box = shape.GetWorldBounds(transform);
+    BoundingSphere sphere = shape.GetWorldSphere(transform);
     glm::mat4 identity(1.0);
-    glm::mat4 model = glm::rotate(identity, glm::radians(-90.0f), glm::vec3(1.0, 0.0, 0.0));
-    
-    shader_program->setInt("shader_state", TEXTURED);
-    shader_program->setMat4("model", model);
-    
-    glm::mat4 floor_local(1.0);
-    floor_local = glm::translate(floor_local, glm::vec3(0.0, 0.0, -0.01));
-    shader_program->setMat4("local", floor_local);
-    
-    // Add condition for floor texture
-    if (!is_depth_pass) {
-        glActiveTexture(GL_TEXTURE0);
-        shader_program->setInt("textures[0]", 0);
-        glBindTexture(GL_TEXTURE_2D, models.floor_texture);
+    basic_program->setInt("shader_state", BASIC);
+    basic_program->setMat4("model", identity);
+
+    glm::mat4 box_local = glm::translate(identity, box.min);
+    box_local = glm::scale(box_local, box.max - box.min);
+    basic_program->setMat4("local", box_local);
+    basic_program->setVec4("color", glm::vec4(1.0f, 1.0f, 0.0f, 1.0f));
+    models.bounds_box->DrawEBO();
+
+    glm::mat4 sphere_local = glm::translate(identity, sphere.center);
+    sphere_local = glm::scale(sphere_local, glm::vec3(sphere.radius));
+    basic_program->setMat4("local", sphere_local);
+    basic_program->setVec4("color", glm::vec4(0.0f, 1.0f, 1.0f, 1.0f));
+    models.bounds_sphere->DrawEBO();
+}
+
+// Placement of the scene's objects relative to their parent nodes (see buildSceneGraph)
+static SceneTransform makeTransform(glm::vec3 translation, glm::vec3 rotation = glm::vec3(0.0),
+                                    glm::vec3 scale = glm::vec3(1.0)) {
+    SceneTransform transform;
+    transform.translation = translation;
+    transform.rotation = rotation;
+    transform.scale = scale;
+    return transform;
+}
+
+static SceneTransform floorGroupTransform() {
+    return makeTransform(glm::vec3(0.0), glm::vec3(-90.0, 0.0, 0.0));
+}
+
+static SceneTransform floorTransform() {
+    return makeTransform(glm::vec3(0.0, 0.0, -0.01));
+}
+
+static SceneTransform tumblingFloorTransform() {
+    return makeTransform(glm::vec3(0.0, 0.4, 0.0));
+}
+
+static SceneTransform vaultTableTransform() {
+    return makeTransform(glm::vec3(8.0, 0.0, 0.0));
+}
+
+static SceneTransform buildingTransform() {
+    return makeTransform(glm::vec3(0.0, 0.0, 0.0), glm::vec3(0.0), glm::vec3(2, 2, 2));
+}
+
+static SceneTransform highBarTransform() {
+    return makeTransform(glm::vec3(-10.0, 0.0, 0.0), glm::vec3(0.0), glm::vec3(1.3f, 1.3f, 1.3f));
+}
+
+static SceneTransform pommelHorseTransform() {
+    return makeTransform(glm::vec3(-5.0, 0.0, -10.0), glm::vec3(0.0, 180.0, 0.0));
+}
+
+static SceneTransform pommelHorse2Transform() {
+    return makeTransform(glm::vec3(27.0, 0.0, -10.0), glm::vec3(0.0, 180.0, 0.0));
+}
+
+// Returns the placement of the crowd's gymnast i: rows facing the apparatus
+static SceneTransform gymnastTransform(int i) {
+    int column = i % CROWD_ROW_LENGTH;
+    int row = i / CROWD_ROW_LENGTH;
+    glm::vec3 position(-23.4f + column * 1.2f, 0.4f, -1.0f + row * 1.0f);
+    // Turn each gymnast a little so the rows do not look stamped
+    glm::vec3 rotation(0.0f, 180.0f + (float)((i * 37) % 61 - 30), 0.0f);
+    return makeTransform(position, rotation, glm::vec3(0.5f));
+}
+
+// Leotard colors of the crowd's gymnasts
+static const glm::vec4 CROWD_PALETTE[] = {
+    glm::vec4(1.0f, 0.35f, 0.35f, 1.0f),
+    glm::vec4(0.35f, 0.55f, 1.0f, 1.0f),
+    glm::vec4(0.4f, 1.0f, 0.45f, 1.0f),
+    glm::vec4(1.0f, 0.85f, 0.3f, 1.0f),
+    glm::vec4(0.85f, 0.45f, 1.0f, 1.0f),
+};
+
+// Returns every object of the scene drawn on its own, shared by renderScene and
+// collectShadowCasters
+static std::vector<SceneObject> sceneObjects(GameModels& models, Avatar& baseAvatar, AvatarHighBar* high_bar_avatar) {
+    std::vector<SceneObject> objects = {
+        {baseAvatar.GetBody().get(), models.scene_nodes.base_avatar, baseAvatar.GetShaderState(),
+         GL_TEXTURE_2D, 0, 0},
+        {high_bar_avatar->GetBody().get(), models.scene_nodes.high_bar_avatar, high_bar_avatar->GetShaderState(),
+         GL_TEXTURE_2D, 0, 0},
+    };
+    for (const SceneObject& object : models.static_objects) {
+        if (!static_batching_enabled || !models.static_batch.Contains(object.shape)) {
+            objects.push_back(object);
+        }
     }
-    models.floor.Draw();
-    // After rendering each textured object:
-    if (!is_depth_pass) {
-        glActiveTexture(GL_TEXTURE0);
+    if (crowd_enabled) {
+        objects.insert(objects.end(), models.crowd_objects.begin(), models.crowd_objects.end());
     }
-    
-    // Draw tumbling floor
-    shader_program->setInt("shader_state", IMPORTED_TEXTURED);
-    glm::mat4 tumbling_floor_local(1.0);
-    tumbling_floor_local = glm::translate(tumbling_floor_local, glm::vec3(0.0, 0.4, 0.0));
-    shader_program->setMat4("model", identity);
-    shader_program->setMat4("local", tumbling_floor_local);
-    
-    // Add condition for tumbling floor texture
+    return objects;
+}
+
+// Returns the draw of an object with the program (textures are left out of the depth pass).
+// The object is drawn with its node's world matrix as the model matrix, and an identity local.
+static DrawItem makeDrawItem(const SceneObject& object, const glm::mat4& world, Shader* program, bool is_depth_pass) {
+    DrawItem item;
+    item.shape = object.shape;
+    item.program = program;
+    item.model = world;
+    item.object_type = object.object_type;
+    item.tint = object.tint;
     if (!is_depth_pass) {
-        glActiveTexture(GL_TEXTURE0);
-        shader_program->setInt("textures[0]", 0);
-        glBindTexture(GL_TEXTURE_2D, models.tumbling_floor_texture);
+        item.texture_target = object.texture_target;
+        item.texture = object.texture;
+        item.texture_unit = object.texture_unit;
     }
-    models.tumbling_floor.Draw();
-    // After rendering each textured object:
-    if (!is_depth_pass) {
-        glActiveTexture(GL_TEXTURE0);
+    item.key = RenderQueue::MakeKey(is_depth_pass ? DEPTH_PASS : COLOR_PASS, program->ID, item.texture,
+                                    object.shape->GetVBO());
+    return item;
+}
+
+// Counts an object as visible or culled by the pass; only visible objects are drawn
+static bool isVisible(CullingView& culling, BasicShape& shape, const glm::mat4& transform) {
+    if (culling.enabled && !(culling.frustum.Intersects(shape.GetWorldSphere(transform)) &&
+                             culling.frustum.Intersects(shape.GetWorldBounds(transform)))) {
+        culling.culled++;
+        return false;
     }
-    
-    // Draw vault table
-    shader_program->setInt("shader_state", IMPORTED_TEXTURED);
-    glm::mat4 vault_table_local(1.0);
-    vault_table_local = glm::translate(vault_table_local, glm::vec3(8.0, 0.0, 0.0));
-    shader_program->setMat4("model", identity);
-    shader_program->setMat4("local", vault_table_local);
-    
-    // When binding textures, add a condition:
-    if (!is_depth_pass) {
-        // For the vault table
-        for (int i = 0; i < models.vault_table_textures.size(); i++) {
-            glActiveTexture(GL_TEXTURE0 + i);
-            std::string texture_string = "textures[" + std::to_string(i) + "]";
-            shader_program->setInt(texture_string, i);
-            glBindTexture(GL_TEXTURE_2D, models.vault_table_textures[i]);
+    culling.visible++;
+    return true;
+}
+
+glm::mat4 getProjectionMatrix(unsigned int scr_width, unsigned int scr_height) {
+    return glm::perspective(glm::radians(CAMERA_FOV_DEGREES), (float)scr_width / (float)scr_height,
+                            CAMERA_NEAR_PLANE, CAMERA_FAR_PLANE);
+}
+
+CullingView makeCullingView(const Camera& camera, unsigned int scr_width, unsigned int scr_height) {
+    // Create a non-const copy of the camera to call GetViewMatrix()
+    Camera camera_copy = camera;
+    CullingView culling;
+    culling.frustum = Frustum(getProjectionMatrix(scr_width, scr_height) * camera_copy.GetViewMatrix());
+    return culling;
+}
+
+CullingView makeShadowCullingView(const glm::mat4& light_space_matrix) {
+    CullingView culling;
+    culling.frustum = Frustum(light_space_matrix);
+    return culling;
+}
+
+LODView makeLODView(const Camera& camera, unsigned int scr_height, float max_pixel_error) {
+    LODView view;
+    view.camera_position = camera.Position;
+    view.pixels_per_unit = scr_height / (2.0f * glm::tan(glm::radians(CAMERA_FOV_DEGREES) / 2.0f));
+    view.max_pixel_error = max_pixel_error;
+    view.enabled = lods_enabled;
+    return view;
+}
+
+ScenePrograms makeScenePrograms(Shader* program) {
+    ScenePrograms programs;
+    for (int type = 0; type < OBJECT_TYPE_COUNT; type++) {
+        programs.programs[type] = program;
+    }
+    return programs;
+}
+
+ScenePrograms makeScenePrograms(ShaderPermutations& permutations, ShaderVariantKey key) {
+    ScenePrograms programs;
+    for (int type = 0; type < OBJECT_TYPE_COUNT; type++) {
+        key.object_type = (ObjectType)type;
+        programs.programs[type] = permutations.Get(key);
+    }
+    return programs;
+}
+
+void prepareScenePrograms(ScenePrograms& programs, int post_process_selection) {
+    for (int type = 0; type < OBJECT_TYPE_COUNT; type++) {
+        Shader* program = programs.programs[type];
+        program->use();
+        program->setInt("post_process_selection", post_process_selection);
+        program->setInt("shape_texture", SHAPE_TEXTURE_UNIT);
+        program->setInt("shadow_map", SHADOW_MAP_UNIT);
+        program->setInt("material_textures", MATERIAL_TEXTURES_UNIT);
+    }
+}
+
+void buildSceneGraph(GameModels& models, Avatar& baseAvatar, AvatarHighBar* high_bar_avatar) {
+    SceneGraph& graph = models.scene_graph;
+    SceneNodes& nodes = models.scene_nodes;
+    graph.Clear();
+    nodes.base_avatar = graph.AddNode(-1, baseAvatar.LocalTransform());
+    nodes.high_bar_avatar = graph.AddNode(-1, high_bar_avatar->LocalTransform());
+    nodes.floor_group = graph.AddNode(-1, floorGroupTransform());
+    nodes.floor = graph.AddNode(nodes.floor_group, floorTransform());
+    nodes.tumbling_floor = graph.AddNode(-1, tumblingFloorTransform());
+    nodes.vault_table = graph.AddNode(-1, vaultTableTransform());
+    nodes.building = graph.AddNode(-1, buildingTransform());
+    nodes.high_bar = graph.AddNode(-1, highBarTransform());
+    nodes.pommel_horse = graph.AddNode(-1, pommelHorseTransform());
+    nodes.pommel_horse2 = graph.AddNode(-1, pommelHorse2Transform());
+    // The gymnasts of the crowd stress mode are the avatars' model, each with a leotard color
+    nodes.crowd = graph.AddNode(-1, SceneTransform());
+    models.crowd_objects.clear();
+    for (int i = 0; i < CROWD_GYMNASTS; i++) {
+        int node = graph.AddNode(nodes.crowd, gymnastTransform(i));
+        if (i == 0) {
+            nodes.first_gymnast = node;
         }
+        models.crowd_objects.push_back({baseAvatar.GetBody().get(), node, baseAvatar.GetShaderState(),
+                                        GL_TEXTURE_2D, 0, 0, CROWD_PALETTE[(i * 7) % 5]});
     }
-    models.vault_table.Draw();
-    if (!is_depth_pass) {
-        glActiveTexture(GL_TEXTURE0); // Reset active texture
+    graph.Update();
+    std::cout << "Scene graph built with " << graph.NodeCount() << " nodes" << std::endl;
+}
+
+void updateSceneGraph(GameModels& models, Avatar& baseAvatar, AvatarHighBar* high_bar_avatar) {
+    SceneGraph& graph = models.scene_graph;
+    graph.SetLocal(models.scene_nodes.base_avatar, baseAvatar.LocalTransform());
+    graph.SetLocal(models.scene_nodes.high_bar_avatar, high_bar_avatar->LocalTransform());
+    graph.Update();
+}
+
+void buildStaticBatch(GameModels& models) {
+    const SceneNodes& nodes = models.scene_nodes;
+    models.static_objects = {
+        {models.floor.get(), nodes.floor, TEXTURED,
+         GL_TEXTURE_2D, models.floor_texture->id, SHAPE_TEXTURE_UNIT},
+        {models.tumbling_floor.get(), nodes.tumbling_floor, IMPORTED_TEXTURED,
+         GL_TEXTURE_2D_ARRAY, models.tumbling_floor_textures->id, MATERIAL_TEXTURES_UNIT},
+        {models.vault_table.get(), nodes.vault_table, IMPORTED_TEXTURED,
+         GL_TEXTURE_2D_ARRAY, models.vault_table_textures->id, MATERIAL_TEXTURES_UNIT},
+        {models.LouGrossBuilding.get(), nodes.building, IMPORTED_TEXTURED,
+         GL_TEXTURE_2D_ARRAY, models.building_textures->id, MATERIAL_TEXTURES_UNIT},
+        {models.high_bar.get(), nodes.high_bar, IMPORTED_BASIC, GL_TEXTURE_2D, 0, 0},
+        {models.pommel_horse.get(), nodes.pommel_horse, IMPORTED_BASIC, GL_TEXTURE_2D, 0, 0},
+        {models.pommel_horse2.get(), nodes.pommel_horse2, IMPORTED_BASIC, GL_TEXTURE_2D, 0, 0},
+    };
+
+    std::vector<StaticMesh> meshes;
+    for (const SceneObject& object : models.static_objects) {
+        StaticMesh mesh;
+        mesh.shape = object.shape;
+        mesh.transform = models.scene_graph.World(object.node);
+        mesh.object_type = object.object_type;
+        mesh.texture_target = object.texture_target;
+        mesh.texture = object.texture;
+        mesh.texture_unit = object.texture_unit;
+        meshes.push_back(mesh);
     }
-    // After rendering each textured object:
-    if (!is_depth_pass) {
-        glActiveTexture(GL_TEXTURE0);
+    auto start = std::chrono::steady_clock::now();
+    models.static_batch.Build(meshes);
+    double build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    std::cout << "Static batch built in " << build_ms << " ms" << std::endl;
+}
+
+void renderStaticBatch(ScenePrograms& programs, GameModels& models, LODView& lod_view,
+                       CullingView& culling, bool is_depth_pass, bool casters_only) {
+    StaticBatch& batch = models.static_batch;
+    if (!static_batching_enabled) {
+        return;
     }
+
+    // Cull the meshes once; each group only lists its visible ones in its multi-draw
+    std::vector<char>& visible = models.static_visible;
+    const std::vector<StaticBatchMesh>& meshes = batch.Meshes();
+    visible.assign(meshes.size(), 0);
+    for (size_t i = 0; i < meshes.size(); i++) {
+        if (casters_only && !meshes[i].shape->CastsShadows()) {
+            continue;
+        }
+        visible[i] = isVisible(culling, *meshes[i].shape, meshes[i].transform);
+    }
+
+    // The vertices are already in world space
+    glm::mat4 identity(1.0);
+    const std::vector<StaticBatchGroup>& groups = batch.Groups();
+    for (size_t i = 0; i < groups.size(); i++) {
+        const StaticBatchGroup& group = groups[i];
+        Shader* program = programs.programs[std::max(0, std::min(group.object_type, OBJECT_TYPE_COUNT - 1))];
+        program->use();
+        program->setBool("instanced", false);
+        program->setMat4("model", identity);
+        program->setMat4("local", identity);
+        program->setInt("shader_state", group.object_type);
+        if (!is_depth_pass && group.texture != 0) {
+            GLState::ActiveTexture(GL_TEXTURE0 + group.texture_unit);
+            GLState::BindTexture(group.texture_target, group.texture);
+        }
+        batch.DrawGroup((int)i, visible, lod_view);
+    }
+    GLState::ActiveTexture(GL_TEXTURE0);
+}
+
+void renderScene(ScenePrograms& programs, 
+                GameModels& models, 
+                Avatar& baseAvatar,
+                AvatarHighBar* high_bar_avatar,
+                RenderQueue& queue,
+                LODView& lod_view,
+                CullingView& culling,
+                bool is_depth_pass) {
     
-    // Draw Lou Gross Building
-    shader_program->setInt("shader_state", IMPORTED_TEXTURED);
-    glm::mat4 building_local(1.0);
-    building_local = glm::translate(building_local, glm::vec3(0.0, 0.0, 0.0));
-    building_local = glm::scale(building_local, glm::vec3(2, 2, 2));
-    shader_program->setMat4("model", identity);
-    shader_program->setMat4("local", building_local);
-    
-    // Bind building textures
-    if (!is_depth_pass) {
-        for (int i = 0; i < models.building_textures.size(); i++) {
-            glActiveTexture(GL_TEXTURE0 + i);
-            std::string texture_string = "textures[" + std::to_string(i) + "]";
-            shader_program->setInt(texture_string, i);
-            glBindTexture(GL_TEXTURE_2D, models.building_textures[i]);
+    // The camera and lights come from the frame's uniform blocks (see updateFrameUniforms)
+
+    // Each visible object submits a draw with the program of its type; the queue sorts them
+    // so objects that share a program and textures are drawn together
+    queue.Clear();
+    for (const SceneObject& object : sceneObjects(models, baseAvatar, high_bar_avatar)) {
+        const glm::mat4& world = models.scene_graph.World(object.node);
+        if (isVisible(culling, *object.shape, world)) {
+            Shader* program = programs.programs[std::max(0, std::min(object.object_type, OBJECT_TYPE_COUNT - 1))];
+            queue.Submit(makeDrawItem(object, world, program, is_depth_pass));
         }
     }
-    models.LouGrossBuilding.Draw();
-    if (!is_depth_pass) {
-        glActiveTexture(GL_TEXTURE0); // Reset active texture
+    queue.Execute(lod_view, instancing_enabled);
+
+    // The objects that never move are drawn from the static batch
+    renderStaticBatch(programs, models, lod_view, culling, is_depth_pass, false);
+
+    // The bounds overlay is only drawn by the camera pass
+    if (bounds_visible && !is_depth_pass) {
+        Shader* basic_program = programs.programs[BASIC];
+        basic_program->use();
+        for (const DrawItem& item : queue.Items()) {
+            drawBounds(basic_program, models, *item.shape, item.model * item.local);
+        }
+        if (static_batching_enabled) {
+            for (const StaticBatchMesh& mesh : models.static_batch.Meshes()) {
+                drawBounds(basic_program, models, *mesh.shape, mesh.transform);
+            }
+        }
     }
-    // After rendering each textured object:
-    if (!is_depth_pass) {
-        glActiveTexture(GL_TEXTURE0);
+}
+
+std::vector<ShadowCaster> collectShadowCasters(GameModels& models,
+                                               Avatar& baseAvatar,
+                                               AvatarHighBar* high_bar_avatar,
+                                               CullingView& light_culling) {
+    std::vector<ShadowCaster> casters;
+    glm::mat4 identity(1.0);
+    for (const SceneObject& object : sceneObjects(models, baseAvatar, high_bar_avatar)) {
+        const glm::mat4& world = models.scene_graph.World(object.node);
+        if (object.shape->CastsShadows() && isVisible(light_culling, *object.shape, world)) {
+            casters.push_back({object.shape, world, identity});
+        }
     }
-    
-    // Draw high bar
-    shader_program->setInt("shader_state", IMPORTED_BASIC);
-    glm::mat4 high_bar_local(1.0);
-    high_bar_local = glm::translate(high_bar_local, glm::vec3(-10.0, 0.0, 0.0));
-    high_bar_local = glm::scale(high_bar_local, glm::vec3(1.3f, 1.3f, 1.3f));
-    shader_program->setMat4("model", identity);
-    shader_program->setMat4("local", high_bar_local);
-    models.high_bar.Draw();
-    
-    // Draw first pommel horse
-    shader_program->setInt("shader_state", IMPORTED_BASIC);
-    glm::mat4 pommel_horse_local(1.0);
-    pommel_horse_local = glm::translate(pommel_horse_local, glm::vec3(-5.0, 0.0, -10.0));
-    pommel_horse_local = glm::rotate(pommel_horse_local, glm::radians(180.0f), glm::vec3(0.0, 1.0, 0.0));
-    shader_program->setMat4("model", identity);
-    shader_program->setMat4("local", pommel_horse_local);
-    models.pommel_horse.Draw();
-    
-    // Draw second pommel horse
-    shader_program->setInt("shader_state", IMPORTED_BASIC);
-    glm::mat4 pommel_horse2_local(1.0);
-    pommel_horse2_local = glm::translate(pommel_horse2_local, glm::vec3(27.0, 0.0, -10.0));
-    pommel_horse2_local = glm::rotate(pommel_horse2_local, glm::radians(180.0f), glm::vec3(0.0, 1.0, 0.0));
-    shader_program->setMat4("model", identity);
-    shader_program->setMat4("local", pommel_horse2_local);
-    models.pommel_horse2.Draw();
-    
-    // Draw high bar avatar
-    high_bar_avatar->Draw(shader_program, false);
+    return casters;
+}
+
+void renderShadowCasters(Shader* depth_shader, const std::vector<ShadowCaster>& casters,
+                         RenderQueue& queue, LODView& lod_view) {
+    queue.Clear();
+    for (const ShadowCaster& caster : casters) {
+        DrawItem item;
+        item.shape = caster.shape;
+        item.program = depth_shader;
+        item.model = caster.model;
+        item.local = caster.local;
+        item.key = RenderQueue::MakeKey(DEPTH_PASS, depth_shader->ID, 0, caster.shape->GetVBO());
+        queue.Submit(item);
+    }
+    queue.Execute(lod_view, instancing_enabled);
 }
 
 
 void renderHUDBackground(Shader* shader_program, float x1, float y1, float x2, float y2, glm::vec4 color) {
-    // Save current OpenGL state
-    GLboolean depth_test_enabled;
-    glGetBooleanv(GL_DEPTH_TEST, &depth_test_enabled);
+    // Save current OpenGL state (answered by GLState, so the pipeline is not stalled)
+    bool depth_test_enabled = GLState::IsEnabled(GL_DEPTH_TEST);
     
     // Set up blending for transparency
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    GLState::Enable(GL_BLEND);
+    GLState::BlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
     
     // Disable depth testing temporarily
-    glDisable(GL_DEPTH_TEST);
+    GLState::Disable(GL_DEPTH_TEST);
     
     // Use the shader
     shader_program->use();
     
-    // Set up simple orthographic view
+    // The font program draws through the screen camera block (see SetupFontShader)
     glm::mat4 identity(1.0f);
     shader_program->setMat4("model", identity);
-    shader_program->setMat4("view", identity);
-    shader_program->setMat4("projection", glm::ortho(-1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f));
     
     // Set color - make sure to set both uniforms
     shader_program->setVec4("color", color);
@@ -338,7 +583,7 @@ void renderHUDBackground(Shader* shader_program, float x1, float y1, float x2, f
     glGenVertexArrays(1, &VAO);
     glGenBuffers(1, &VBO);
     
-    glBindVertexArray(VAO);
+    GLState::BindVertexArray(VAO);
     glBindBuffer(GL_ARRAY_BUFFER, VBO);
     
     // Define the rectangle vertices
@@ -357,17 +602,20 @@ void renderHUDBackground(Shader* shader_program, float x1, float y1, float x2, f
     glDrawArrays(GL_TRIANGLE_FAN, 0, 4);
     
     // Clean up
-    glBindVertexArray(0);
-    glDeleteVertexArrays(1, &VAO);
+    GLState::BindVertexArray(0);
+    GLState::DeleteVertexArrays(1, &VAO);
     glDeleteBuffers(1, &VBO);
     
     // Restore previous state
     if (depth_test_enabled) {
-        glEnable(GL_DEPTH_TEST);
+        GLState::Enable(GL_DEPTH_TEST);
     }
 }
 
-void renderText(Shader* font_program, Font& arial_font, const Camera& camera) {
+void renderText(Shader* font_program, Font& arial_font, const Camera& camera,
+                const LODView& camera_lods, const LODView& shadow_lods, const CullingView& culling,
+                const CullingView& shadow_culling, float shadow_milliseconds,
+                float scene_milliseconds) {
     // If HUD is toggled off, don't render any text
     if (!hud_visible) {
         return;
@@ -381,6 +629,9 @@ void renderText(Shader* font_program, Font& arial_font, const Camera& camera) {
     
     // Background for light direction info
     renderHUDBackground(font_program, -0.15f, 0.50f, 0.4f, 0.70f, accentColor);
+
+    // Background for the triangle and object counts
+    renderHUDBackground(font_program, -0.15f, -0.42f, 0.4f, 0.50f, bgColor);
     
     // Background for HUD toggle hint
     renderHUDBackground(font_program, -0.99f, -0.99f, -0.65f, -0.90f, bgColor);
@@ -412,64 +663,103 @@ void renderText(Shader* font_program, Font& arial_font, const Camera& camera) {
     
     arial_font.DrawText(light_string, glm::vec2(-0.1, 0.55), *font_program);
 
+    // Triangles drawn this frame out of the full-detail count ('O' toggles the levels of detail)
+    std::string triangle_string = "Tris " + std::to_string(camera_lods.triangles) + " / " +
+                                  std::to_string(camera_lods.full_triangles);
+    std::string shadow_string = "Shadow " + std::to_string(shadow_lods.triangles) + " / " +
+                                std::to_string(shadow_lods.full_triangles);
+    arial_font.DrawText(triangle_string, glm::vec2(-0.1, 0.42), *font_program);
+    arial_font.DrawText(shadow_string, glm::vec2(-0.1, 0.32), *font_program);
+
+    // Objects inside and outside the camera's frustum
+    std::string culling_string = "Visible " + std::to_string(culling.visible) + " culled " +
+                                 std::to_string(culling.culled);
+    arial_font.DrawText(culling_string, glm::vec2(-0.1, 0.22), *font_program);
+
+    // Draws and GPU time of the shadow pass ('K' switches between the caster list and the full scene)
+    std::string shadow_ms = std::to_string(shadow_milliseconds);
+    std::string shadow_pass_string = "Shadow draws " + std::to_string(shadow_culling.visible) + " culled " +
+                                     std::to_string(shadow_culling.culled) + " " +
+                                     shadow_ms.substr(0, shadow_ms.find(".") + 3) + " ms";
+    arial_font.DrawText(shadow_pass_string, glm::vec2(-0.1, 0.12), *font_program);
+
+    // Uniform updates of this frame's shadow and camera passes
+    UniformStats uniform_stats = Shader::GetUniformStats();
+    std::string uniform_string = "Uniforms " + std::to_string(uniform_stats.uploads) + " skipped " +
+                                 std::to_string(uniform_stats.skipped);
+    arial_font.DrawText(uniform_string, glm::vec2(-0.1, 0.02), *font_program);
+
+    // GPU time of the camera pass ('U' switches between the variants and the ubershader)
+    std::string scene_ms = std::to_string(scene_milliseconds);
+    std::string scene_string = "Scene " + scene_ms.substr(0, scene_ms.find(".") + 3) + " ms " +
+                               (shader_permutations_enabled ? "variants" : "ubershader");
+    arial_font.DrawText(scene_string, glm::vec2(-0.1, -0.08), *font_program);
+
+    // Draw calls, instanced draws, and state changes of the frame's render queues (shadow and camera passes)
+    RenderQueueStats queue_stats = RenderQueue::GetFrameStats();
+    std::string queue_string = "Draws " + std::to_string(queue_stats.draw_calls) + " inst " +
+                               std::to_string(queue_stats.instances) + " changes " +
+                               std::to_string(queue_stats.program_changes + queue_stats.texture_changes);
+    arial_font.DrawText(queue_string, glm::vec2(-0.1, -0.18), *font_program);
+
+    // GL calls GLState dropped so far this frame because the state was already set
+    GLStateStats state_stats = GLState::GetFrameStats();
+    std::string state_string = "GL calls " + std::to_string(state_stats.issued) + " elided " +
+                               std::to_string(state_stats.elided);
+    arial_font.DrawText(state_string, glm::vec2(-0.1, -0.28), *font_program);
+
+    // Multi-draws of the static batch and the meshes they drew ('T' toggles the batch)
+    StaticBatchStats batch_stats = StaticBatch::GetFrameStats();
+    std::string batch_string = std::string("Static ") + (static_batching_enabled ? std::to_string(batch_stats.multi_draws) +
+                               " draws " + std::to_string(batch_stats.meshes) + " meshes" : "off");
+    arial_font.DrawText(batch_string, glm::vec2(-0.1, -0.38), *font_program);
+
     // Add a directive about toggling the HUD
     arial_font.DrawText("Press 'H' to toggle HUD", glm::vec2(-0.95, -0.95), *font_program);
 }
 
-void renderSkybox(Shader* skybox_shader, GameModels& models, const Camera& camera, unsigned int scr_width, unsigned int scr_height) {
+void renderSkybox(Shader* skybox_shader, GameModels& models) {
     if (skybox_shader == nullptr) {
         std::cerr << "Skybox shader is null!" << std::endl;
         return;
     }
 
     // Save the current depth function
-    GLint currentDepthFunc;
-    glGetIntegerv(GL_DEPTH_FUNC, &currentDepthFunc);
+    GLenum currentDepthFunc = GLState::GetDepthFunc();
     
     // Change depth function so depth test passes when values are equal to depth buffer's content
-    glDepthFunc(GL_LEQUAL);
+    GLState::DepthFunc(GL_LEQUAL);
     
     skybox_shader->use();
     
-    // Create a view matrix that removes the translation (only rotation)
-    // ensuring the skybox is always centered at the camera position
-    Camera camera_copy = camera;
-    glm::mat4 view = glm::mat4(glm::mat3(camera_copy.GetViewMatrix())); // Remove translation
-    skybox_shader->setMat4("view", view);
-    
-    // Set projection matrix
-    glm::mat4 projection = glm::perspective(glm::radians(45.0f), (float)scr_width / (float)scr_height, 0.1f, 100.0f);
-    skybox_shader->setMat4("projection", projection);
+    // The camera comes from the FrameCamera block; skyboxVertex.glsl drops the view's
+    // translation so the skybox is always centered at the camera position
     
     // Bind the cubemap texture
     skybox_shader->setInt("skybox", 0);
-    glActiveTexture(GL_TEXTURE0);
-    glBindTexture(GL_TEXTURE_CUBE_MAP, models.skybox_texture);
+    GLState::ActiveTexture(GL_TEXTURE0);
+    GLState::BindTexture(GL_TEXTURE_CUBE_MAP, models.skybox_texture->id);
     
     // Render the cube
-    models.skybox.Draw();
+    models.skybox->Draw();
     
     // Reset to the original depth function
-    glDepthFunc(currentDepthFunc);
+    GLState::DepthFunc(currentDepthFunc);
 }
 
 void cleanupResources(RenderingVAOs& vaos, GameModels& models) {
     // Cleanup VAOs
-    glDeleteVertexArrays(1, &(vaos.basic_vao.id));
-    glDeleteVertexArrays(1, &(vaos.import_vao.id));
-    glDeleteVertexArrays(1, &(vaos.texture_vao.id));
-    glDeleteVertexArrays(1, &(vaos.skybox_vao.id));
-    
-    // Cleanup models
-    models.baseModel.DeallocateShape();
-    models.LouGrossBuilding.DeallocateShape();
-    models.tumbling_floor.DeallocateShape();
-    models.vault_table.DeallocateShape();
-    models.high_bar.DeallocateShape();
-    models.pommel_horse.DeallocateShape();
-    models.pommel_horse2.DeallocateShape();
-    models.floor.DeallocateShape();
-    models.skybox.DeallocateShape();
+    GLState::DeleteVertexArrays(1, &(vaos.basic_vao.id));
+    GLState::DeleteVertexArrays(1, &(vaos.import_vao.id));
+    GLState::DeleteVertexArrays(1, &(vaos.texture_vao.id));
+    GLState::DeleteVertexArrays(1, &(vaos.skybox_vao.id));
+    
+    // Cleanup models and textures (each is freed once, however many handles share it)
+    models.static_batch.DeallocateBatch();
+    models.assets.Clear();
+    glDeleteBuffers(1, &models.default_material_table);
+    // Textures loaded outside the registry (such as the font's)
+    ClearTextureCache();
     
     std::cout << "All resources cleaned up successfully" << std::endl;
 }
\ No newline at end of file
@@ -15,58 +15,245 @@
 #include "../classes/camera.hpp"
 #include "../classes/Font.hpp"
 #include "../classes/import_object.hpp"
+#include "../classes/asset_registry.hpp"
+#include "../classes/frame_uniforms.hpp"
+#include "../classes/shader_permutations.hpp"
+#include "../classes/static_batch.hpp"
+#include "../classes/scene_graph.hpp"
+#include "../classes/render_queue.hpp"
 
-// Structure to hold all VAO objects
+//Command line flag that makes imported models use the compact vertex layout
+const std::string COMPACT_VERTICES_FLAG = "--compact-vertices";
+//Command line flag that adds the frame's counters to the console's frame line (every 100 frames)
+const std::string FRAME_STATS_FLAG = "--frame-stats";
+
+//Projection of the camera (see getProjectionMatrix)
+const float CAMERA_FOV_DEGREES = 45.0f;
+const float CAMERA_NEAR_PLANE = 0.1f;
+const float CAMERA_FAR_PLANE = 100.0f;
+
+//Largest on-screen error (in pixels) of the levels of detail drawn by the camera pass
+const float LOD_PIXEL_ERROR = 1.0f;
+//Largest error of the levels drawn into the shadow map.  They are still chosen from the
+// camera's viewpoint (where the shadows are seen), but the filtered shadow edges hide more.
+const float SHADOW_LOD_PIXEL_ERROR = 4.0f;
+
+//Texture units of the scene programs' samplers (see prepareScenePrograms): a shape's texture,
+// the shadow map, and an imported model's texture array
+const int SHAPE_TEXTURE_UNIT = 0;
+const int SHADOW_MAP_UNIT = 1;
+const int MATERIAL_TEXTURES_UNIT = 2;
+
+//Gymnasts of the crowd stress mode ('N'), placed in rows of CROWD_ROW_LENGTH in front of the
+// apparatus.  Every gymnast is an instance of the avatars' model.
+const int CROWD_GYMNASTS = 1000;
+const int CROWD_ROW_LENGTH = 40;
+
+//Frustum culling for one pass of renderScene, and the number of objects it drew and skipped
+struct CullingView {
+    Frustum frustum;
+    //When false, every object is drawn
+    bool enabled = true;
+    int visible = 0;
+    int culled = 0;
+};
+
+//An object drawn into the shadow map, with the matrices renderScene draws it with
+struct ShadowCaster {
+    BasicShape* shape;
+    glm::mat4 model;
+    glm::mat4 local;
+};
+
+//An object of the scene: its shape and scene graph node, its ObjectType, the texture the
+// camera pass binds for it (0 for none), and the tint of its materials when it is instanced
+struct SceneObject {
+    BasicShape* shape;
+    int node;
+    int object_type;
+    GLenum texture_target;
+    unsigned int texture;
+    int texture_unit;
+    glm::vec4 tint = glm::vec4(1.0);
+};
+
+//Programs a pass of renderScene draws each object type with (indexed by ObjectType)
+struct ScenePrograms {
+    Shader* programs[OBJECT_TYPE_COUNT];
+};
+
+// Structure to hold all VAO objects (the vertex layouts; every shape configures its own
+// vertex array from one of them when it is created)
 struct RenderingVAOs {
     VAOStruct basic_vao;
     VAOStruct texture_vao;
     VAOStruct import_vao;
     VAOStruct skybox_vao;
+    //True when import_vao uses the compact vertex layout (CompactVertex)
+    bool compact_vertices = false;
 };
 
-// Structure to hold all model objects
+//Nodes of the scene graph built by buildSceneGraph (-1 until it is built)
+struct SceneNodes {
+    int base_avatar = -1;
+    int high_bar_avatar = -1;
+    //Turns the floor's rectangle (drawn in its xy plane) to lie flat; the floor is its child
+    int floor_group = -1;
+    int floor = -1;
+    int tumbling_floor = -1;
+    int vault_table = -1;
+    int building = -1;
+    int high_bar = -1;
+    int pommel_horse = -1;
+    int pommel_horse2 = -1;
+    //Parent of the crowd's gymnasts, which follow it one after the other from first_gymnast
+    int crowd = -1;
+    int first_gymnast = -1;
+};
+
+// Structure to hold all model objects (handles to the meshes and textures in assets)
 struct GameModels {
-    BasicShape baseModel;
-    BasicShape tumbling_floor;
-    BasicShape vault_table;
-    BasicShape high_bar;
-    BasicShape pommel_horse;
-    BasicShape pommel_horse2;
-    BasicShape LouGrossBuilding;
-    BasicShape floor;
-    BasicShape skybox;
+    // Owns every mesh and texture below
+    AssetRegistry assets;
+
+    MeshHandle baseModel;
+    MeshHandle tumbling_floor;
+    MeshHandle vault_table;
+    MeshHandle high_bar;
+    MeshHandle pommel_horse;
+    MeshHandle pommel_horse2;
+    MeshHandle LouGrossBuilding;
+    MeshHandle floor;
+    MeshHandle skybox;
     
     // Textures
-    unsigned int floor_texture;
-    unsigned int tumbling_floor_texture;
-    unsigned int skybox_texture;
-    std::vector<unsigned int> vault_table_textures;
-    std::vector<unsigned int> building_textures;
+    TextureHandle floor_texture;
+    TextureHandle skybox_texture;
+    // Texture arrays of the imported models (one layer per map_Kd entry)
+    TextureHandle tumbling_floor_textures;
+    TextureHandle vault_table_textures;
+    TextureHandle building_textures;
+
+    // Outlines used to show bounding boxes and spheres (see bounds_visible)
+    MeshHandle bounds_box;
+    MeshHandle bounds_sphere;
+
+    //Material table bound when no model has bound its own (keeps the uniform block backed)
+    unsigned int default_material_table = 0;
+
+    //The objects that never move (filled by buildStaticBatch), and the same objects merged in
+    // world space.  static_visible holds the batch's culling results of the pass being drawn.
+    std::vector<SceneObject> static_objects;
+    StaticBatch static_batch;
+    std::vector<char> static_visible;
+
+    //Placement of every object of the scene (see buildSceneGraph)
+    SceneGraph scene_graph;
+    SceneNodes scene_nodes;
+    //Gymnasts of the crowd stress mode (filled by buildSceneGraph)
+    std::vector<SceneObject> crowd_objects;
 };
 
 // Setup and initialization functions
-RenderingVAOs setupVAOs();
-GameModels loadModels(RenderingVAOs& vaos, ImportOBJ& importer);
+//Creates the VAOs (imported models use the compact vertex layout if compact_vertices is true)
+RenderingVAOs setupVAOs(bool compact_vertices = false);
+//Loads every model and texture of the scene using the given number of loader threads
+// (0 loads everything serially on the calling thread)
+GameModels loadModels(RenderingVAOs& vaos, int loader_threads);
 void setupShaders(Shader* shader_program, Font& arial_font, const RenderingVAOs& vaos);
-void setupLighting(Shader* shader_program, const glm::vec3& light_color, const glm::vec4& light_direction, const Camera& camera);
+//Sets the lighting values that do not change from frame to frame (the spotlight's colors,
+// cutoff angles, and attenuation)
+void setupLighting(FrameUniforms& frame_uniforms);
+//Fills in and uploads the frame's camera and lighting blocks.  Called once per frame,
+// before the shadow pass, since every program reads them.
+void updateFrameUniforms(FrameUniforms& frame_uniforms, const Camera& camera,
+                         unsigned int scr_width, unsigned int scr_height,
+                         const glm::vec3& light_color, const glm::vec4& light_direction,
+                         const glm::mat4& light_space_matrix);
 
 // Rendering functions
-void renderScene(Shader* shader_program, 
+//Returns the camera's projection matrix for a viewport of the given size
+glm::mat4 getProjectionMatrix(unsigned int scr_width, unsigned int scr_height);
+
+//Returns a culling view that skips objects outside the camera's frustum
+CullingView makeCullingView(const Camera& camera, unsigned int scr_width, unsigned int scr_height);
+
+//Returns a culling view that skips objects outside the light's orthographic frustum
+// (light_space_matrix is lightProjection * lightView)
+CullingView makeShadowCullingView(const glm::mat4& light_space_matrix);
+
+//Returns a view that picks levels of detail for the camera (45 degree field of view) drawing to a
+// viewport scr_height pixels high.  Levels of detail are only used while lods_enabled is set.
+LODView makeLODView(const Camera& camera, unsigned int scr_height, float max_pixel_error);
+
+//Returns programs that draw every object type with the same program (the scene's ubershader,
+// which branches on shader_state, or the depth shader)
+ScenePrograms makeScenePrograms(Shader* program);
+
+//Returns the variant of each object type compiled for the key's lights, shadows, and effect
+// (the key's object_type is ignored)
+ScenePrograms makeScenePrograms(ShaderPermutations& permutations, ShaderVariantKey key);
+
+//Sets the uniforms shared by the camera pass's programs: the texture units of the samplers
+// and the post-processing effect (variants have it compiled in and ignore it)
+void prepareScenePrograms(ScenePrograms& programs, int post_process_selection);
+
+//Builds models.scene_graph: a node for each avatar, each object that never moves, and each
+// gymnast of the crowd (below a crowd node, listed in models.crowd_objects), and computes
+// their world matrices
+void buildSceneGraph(GameModels& models, Avatar& baseAvatar, AvatarHighBar* high_bar_avatar);
+
+//Copies the avatars' placement into their nodes and updates the scene graph's world matrices
+// (only the nodes that changed are recomputed).  Called once per frame, after the avatars
+// handled their input and before the shadow and camera passes read the matrices.
+void updateSceneGraph(GameModels& models, Avatar& baseAvatar, AvatarHighBar* high_bar_avatar);
+
+//Fills models.static_objects with the objects that never move (the floor, tumbling floor,
+// vault table, building, high bar, and pommel horses) and builds models.static_batch from
+// them, placed by their scene graph nodes (so buildSceneGraph must be called first)
+void buildStaticBatch(GameModels& models);
+
+//Draws the static batch with one glMultiDrawElements call per group (nothing while
+// static_batching_enabled is off).  Meshes outside culling's frustum are left out of the
+// multi-draws and counted by it; with casters_only set, so are the meshes that cast no shadows.
+void renderStaticBatch(ScenePrograms& programs, GameModels& models, LODView& lod_view,
+                       CullingView& culling, bool is_depth_pass, bool casters_only);
+
+//Submits the objects inside culling's frustum to queue (at their scene graph world matrix,
+// with the program of their type and the levels of detail of lod_view) and executes it, then
+// draws the static batch.  The camera pass also outlines the bounds while bounds_visible is set.
+void renderScene(ScenePrograms& programs, 
                 GameModels& models, 
                 Avatar& baseAvatar,
                 AvatarHighBar* high_bar_avatar,
-                const Camera& camera,
-                const glm::vec3& light_color,
-                const glm::vec4& light_direction,
+                RenderQueue& queue,
+                LODView& lod_view,
+                CullingView& culling,
                 bool is_depth_pass);
 
-// Render the skybox using a specific shader
-void renderSkybox(Shader* skybox_shader, GameModels& models, const Camera& camera, unsigned int scr_width, unsigned int scr_height);
+//Returns the objects that cast shadows (see BasicShape::CastsShadows) and are inside
+// light_culling's frustum, which counts the casters kept and culled
+std::vector<ShadowCaster> collectShadowCasters(GameModels& models,
+                                               Avatar& baseAvatar,
+                                               AvatarHighBar* high_bar_avatar,
+                                               CullingView& light_culling);
+
+//Draws the casters into the bound depth map through queue, setting only their matrices
+void renderShadowCasters(Shader* depth_shader, const std::vector<ShadowCaster>& casters,
+                         RenderQueue& queue, LODView& lod_view);
+
+// Render the skybox using a specific shader (with the camera of the frame's uniform blocks)
+void renderSkybox(Shader* skybox_shader, GameModels& models);
 
 void renderHUDBackground(Shader* shader_program, float x1, float y1, float x2, float y2, glm::vec4 color);
 
-// Updated to use Shader pointer instead of reference
-void renderText(Shader* font_program, Font& arial_font, const Camera& camera);
+//Draws the HUD (while hud_visible is set): the camera position, the light direction, and the
+// frame's counters (triangles, culling, pass times, uniform uploads, draws, GL state changes,
+// and static batch draws)
+void renderText(Shader* font_program, Font& arial_font, const Camera& camera,
+                const LODView& camera_lods, const LODView& shadow_lods, const CullingView& culling,
+                const CullingView& shadow_culling, float shadow_milliseconds,
+                float scene_milliseconds);
 
 // Cleanup functions
 void cleanupResources(RenderingVAOs& vaos, GameModels& models);